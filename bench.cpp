@@ -0,0 +1,576 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+#include <iostream>
+
+#include "pystring.h"
+#include "pystring_fnmatch.h"
+#include "pystring_interner.h"
+#include "pystring_normcache.h"
+#include "pystring_pathref.h"
+#include "pystring_pathtable.h"
+#include "pystring_pathtrie.h"
+#include "pystring_utf8.h"
+#include "unittest.h"
+
+PYSTRING_BENCH_APP(PyStringBenchmarks)
+
+namespace
+{
+    // Width used by the padding functions: twice the input, so there is always work to do
+    int padwidth(const PYSTRINGBench & bench)
+    {
+        return (int) bench.input.size() * 2;
+    }
+
+    std::string identity_table()
+    {
+        std::string table(256, '\0');
+        for(int i = 0; i < 256; ++i) table[i] = (char) i;
+        table['/'] = '\\';
+        return table;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// pystring
+
+PYSTRING_ADD_BENCH(pystring, capitalize)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::capitalize(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, casefold)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::casefold(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, center)
+{
+    int width = padwidth(bench);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::center(bench.input, width)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, count)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::count(bench.input, bench.needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, endswith)
+{
+    std::string suffix = pystring::slice(bench.input, -8);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::endswith(bench.input, suffix)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, expandtabs)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::expandtabs(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, find)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::find(bench.input, bench.needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, icount)
+{
+    std::string needle = pystring::upper(bench.needle);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::icount(bench.input, needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, iequals)
+{
+    std::string other = pystring::upper(bench.input);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::iequals(bench.input, other)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, ifind)
+{
+    std::string needle = pystring::upper(bench.needle);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::ifind(bench.input, needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, index)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::index(bench.input, bench.needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, isalnum)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::isalnum(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, isalpha)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::isalpha(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, isdigit)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::isdigit(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, islower)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::islower(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, isspace)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::isspace(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, istitle)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::istitle(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, isupper)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::isupper(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, join)
+{
+    std::vector< std::string > words = pystring::split(bench.input, bench.needle);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::join(bench.needle, words)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, ljust)
+{
+    int width = padwidth(bench);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::ljust(bench.input, width)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, lower)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::lower(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, lstrip)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::lstrip(bench.input, "abc/")); }
+}
+
+PYSTRING_ADD_BENCH(pystring, mul)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::mul(bench.input, 3)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, partition)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::partition(bench.input, bench.needle, result); PYSTRING_BENCH_KEEP(result); }
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_BENCH(pystring, partition_view)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::partition_view(bench.input, bench.needle)); }
+}
+#endif
+
+PYSTRING_ADD_BENCH(pystring, removeprefix)
+{
+    std::string prefix = pystring::slice(bench.input, 0, 8);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::removeprefix(bench.input, prefix)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, removesuffix)
+{
+    std::string suffix = pystring::slice(bench.input, -8);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::removesuffix(bench.input, suffix)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, replace)
+{
+    // Same length replacement, so the in place std::string::replace does not go quadratic
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::replace(bench.input, bench.needle, "\\")); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rfind)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::rfind(bench.input, bench.needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rindex)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::rindex(bench.input, bench.needle)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rjust)
+{
+    int width = padwidth(bench);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::rjust(bench.input, width)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rpartition)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::rpartition(bench.input, bench.needle, result); PYSTRING_BENCH_KEEP(result); }
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_BENCH(pystring, rpartition_view)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::rpartition_view(bench.input, bench.needle)); }
+}
+#endif
+
+PYSTRING_ADD_BENCH(pystring, rsplit)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::rsplit(bench.input, result, bench.needle, 2); PYSTRING_BENCH_KEEP(result); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rsplit_whitespace)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::rsplit(bench.input, result, "", 2); PYSTRING_BENCH_KEEP(result); }
+}
+
+PYSTRING_ADD_BENCH(pystring, rstrip)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::rstrip(bench.input, "abc/")); }
+}
+
+PYSTRING_ADD_BENCH(pystring, split)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::split(bench.input, result, bench.needle); PYSTRING_BENCH_KEEP(result); }
+}
+
+PYSTRING_ADD_BENCH(pystring, split_whitespace)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::split(bench.input, result); PYSTRING_BENCH_KEEP(result); }
+}
+
+PYSTRING_ADD_BENCH(pystring, splitlines)
+{
+    std::vector< std::string > result;
+    PYSTRING_BENCH_LOOP { pystring::splitlines(bench.input, result); PYSTRING_BENCH_KEEP(result); }
+}
+
+PYSTRING_ADD_BENCH(pystring, startswith)
+{
+    std::string prefix = pystring::slice(bench.input, 0, 8);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::startswith(bench.input, prefix)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, strip)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::strip(bench.input, "abc/")); }
+}
+
+PYSTRING_ADD_BENCH(pystring, swapcase)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::swapcase(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, title)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::title(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, translate)
+{
+    std::string table = identity_table();
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::translate(bench.input, table)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, translate_delete)
+{
+    std::string table = identity_table();
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::translate(bench.input, table, "./")); }
+}
+
+PYSTRING_ADD_BENCH(pystring, upper)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::upper(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, zfill)
+{
+    int width = padwidth(bench);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::zfill(bench.input, width)); }
+}
+
+PYSTRING_ADD_BENCH(pystring, slice)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::slice(bench.input, 1, -1)); }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// pystring::Interner
+
+PYSTRING_ADD_BENCH(pystring_interner, intern)
+{
+    // Every call in the loop finds the string already interned
+    pystring::Interner interner;
+    interner.intern(bench.input);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(interner.intern(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_interner, split)
+{
+    pystring::Interner interner;
+    std::vector< pystring::Interner::Id > result;
+    pystring::split(interner, bench.input, result, bench.needle);
+    PYSTRING_BENCH_LOOP { pystring::split(interner, bench.input, result, bench.needle); PYSTRING_BENCH_KEEP(result); }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// pystring::os::path
+
+PYSTRING_ADD_BENCH(pystring_os_path, abspath_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::abspath_posix(bench.input, "/net/cwd")); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, abspath_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::abspath_nt(bench.input, "c:\\net\\cwd")); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, basename_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::basename_posix(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, basename_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::basename_nt(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, commonpath_posix)
+{
+    std::vector< std::string > paths(2, bench.input);
+    paths[1] += "/other";
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::commonpath_posix(paths)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, commonprefix)
+{
+    std::vector< std::string > paths(3, bench.input);
+    if (!bench.input.empty()) paths[1].back() = '\0';
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::commonprefix(paths)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, dirname_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::dirname_posix(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, dirname_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::dirname_nt(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, isabs_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::isabs_posix(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, isabs_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::isabs_nt(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::join_posix(bench.input, "file.exr")); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::join_nt(bench.input, "file.exr")); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_posix_vector)
+{
+    std::vector< std::string > comps = pystring::split(bench.input, bench.needle);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::join_posix(comps)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_nt_vector)
+{
+    std::vector< std::string > comps = pystring::split(bench.input, bench.needle);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::join_nt(comps)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_posix_variadic)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::join_posix(bench.input, "seq", "shot", "file.exr")); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, join_append_posix)
+{
+    std::string result;
+    PYSTRING_BENCH_LOOP
+    {
+        result.clear();
+        pystring::os::path::join_append_posix(result, bench.input, "seq", "shot", "file.exr");
+        PYSTRING_BENCH_KEEP(result);
+    }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, normpath_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::normpath_posix(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, normpath_nt)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::normpath_nt(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, normcache_normpath)
+{
+    // Every call in the loop is a hit
+    pystring::os::path::NormCache cache;
+    cache.normpath(bench.input);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(cache.normpath(bench.input)); }
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_BENCH(pystring_os_path, pathtable_lower_bound)
+{
+    // 100000 sorted paths; a binary search over the blocks, then one block decoded
+    std::vector< std::string > paths;
+    for(int i = 0; i < 100000; ++i) paths.push_back("/show/seq" + std::to_string(i % 100) + "/shot" + std::to_string(i) + "/v001.exr");
+    pystring::os::path::PathTable table(paths);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(table.lower_bound(bench.input)); }
+}
+#endif
+
+PYSTRING_ADD_BENCH(pystring_os_path, pathtrie_longest_prefix)
+{
+    // 10000 registered roots; the lookup only follows the components of the input
+    pystring::os::path::PathTrie trie = pystring::os::path::PathTrie::posix();
+    for(int i = 0; i < 10000; ++i) trie.insert("/show/seq" + std::to_string(i % 100) + "/shot" + std::to_string(i));
+    trie.insert("/show");
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(trie.longest_prefix(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, relpath_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::relpath_posix(bench.input, "/show/seq/shot/task", "/net/cwd")); }
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_BENCH(pystring_os_path, pathref_posix)
+{
+    // Parse once, then the queries the split based code would each re-split for
+    PYSTRING_BENCH_LOOP
+    {
+        pystring::os::path::PathRef path = pystring::os::path::PathRef::posix(bench.input);
+        PYSTRING_BENCH_KEEP(path.name());
+        PYSTRING_BENCH_KEEP(path.stem());
+        PYSTRING_BENCH_KEEP(path.suffix());
+        PYSTRING_BENCH_KEEP(path.parent());
+    }
+}
+#endif
+
+PYSTRING_ADD_BENCH(pystring_os_path, split_posix)
+{
+    std::string head, tail;
+    PYSTRING_BENCH_LOOP { pystring::os::path::split_posix(head, tail, bench.input); PYSTRING_BENCH_KEEP(tail); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, split_nt)
+{
+    std::string head, tail;
+    PYSTRING_BENCH_LOOP { pystring::os::path::split_nt(head, tail, bench.input); PYSTRING_BENCH_KEEP(tail); }
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_BENCH(pystring_os_path, split_view_posix)
+{
+    std::string_view head, tail;
+    PYSTRING_BENCH_LOOP { pystring::os::path::split_view_posix(head, tail, bench.input); PYSTRING_BENCH_KEEP(tail); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, basename_view_posix)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::os::path::basename_view_posix(bench.input)); }
+}
+#endif
+
+PYSTRING_ADD_BENCH(pystring_os_path, splitdrive_posix)
+{
+    std::string drive, path;
+    PYSTRING_BENCH_LOOP { pystring::os::path::splitdrive_posix(drive, path, bench.input); PYSTRING_BENCH_KEEP(path); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, splitdrive_nt)
+{
+    std::string drive, path;
+    PYSTRING_BENCH_LOOP { pystring::os::path::splitdrive_nt(drive, path, bench.input); PYSTRING_BENCH_KEEP(path); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, splitext_posix)
+{
+    std::string root, ext;
+    PYSTRING_BENCH_LOOP { pystring::os::path::splitext_posix(root, ext, bench.input); PYSTRING_BENCH_KEEP(ext); }
+}
+
+PYSTRING_ADD_BENCH(pystring_os_path, splitext_nt)
+{
+    std::string root, ext;
+    PYSTRING_BENCH_LOOP { pystring::os::path::splitext_nt(root, ext, bench.input); PYSTRING_BENCH_KEEP(ext); }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// pystring::fnmatch
+
+PYSTRING_ADD_BENCH(pystring_fnmatch, fnmatchcase)
+{
+    // The pattern is compiled by the first call only
+    const std::string pattern = "*.exr";
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::fnmatch::fnmatchcase(bench.input, pattern)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_fnmatch, pattern_segments)
+{
+    // Literal segments searched for between stars, then a set at the end
+    pystring::fnmatch::Pattern pattern("*/*a*/*[0-9]");
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pattern.match(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_fnmatch, pattern_normcase)
+{
+    pystring::fnmatch::Pattern pattern("*/SHOT/*.EXR", true);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pattern.match(bench.input)); }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+// pystring::utf8
+
+PYSTRING_ADD_BENCH(pystring_utf8, isvalid)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::utf8::isvalid(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_utf8, len)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::utf8::len(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_utf8, ljust)
+{
+    int width = padwidth(bench);
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::utf8::ljust(bench.input, width)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_utf8, lower)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::utf8::lower(bench.input)); }
+}
+
+PYSTRING_ADD_BENCH(pystring_utf8, upper)
+{
+    PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::utf8::upper(bench.input)); }
+}
@@ -4,12 +4,15 @@
 
 
 #include "pystring.h"
+#include "pystring_simd.h"
+#include "pystring_stats.h"
 
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <utility>
 
 namespace pystring
 {
@@ -57,29 +60,41 @@ const std::string colon = ":";
 	namespace {
 
 		//////////////////////////////////////////////////////////////////////////////////////////////
-		/// why doesn't the std::reverse work?
+		/// Store word n of a split. The string already in that slot is reused, so splitting into
+		/// the same container again only allocates when a word outgrows it.
 		///
-		void reverse_strings( std::vector< std::string > & result)
+		void set_word( std::vector< std::string > & result, std::string::size_type n,
+		               const std::string & str, std::string::size_type pos, std::string::size_type len )
 		{
-			for (std::vector< std::string >::size_type i = 0; i < result.size() / 2; i++ )
-			{
-				std::swap(result[i], result[result.size() - 1 - i]);
-			}
+			if ( n < result.size() ) result[n].assign( str, pos, len );
+			else result.push_back( str.substr( pos, len ) );
+		}
+
+#ifdef PYSTRING_HAVE_CXX17
+		void set_word( std::vector< std::string_view > & result, std::string::size_type n,
+		               std::string_view str, std::string::size_type pos, std::string::size_type len )
+		{
+			if ( n < result.size() ) result[n] = str.substr( pos, len );
+			else result.push_back( str.substr( pos, len ) );
 		}
+#endif
 
 		//////////////////////////////////////////////////////////////////////////////////////////////
 		///
 		///
-		void split_whitespace( const std::string & str, std::vector< std::string > & result, int maxsplit )
+		template < class String, class Words >
+		void split_whitespace( const String & str, Words & result, int maxsplit )
 		{
-			std::string::size_type i, j, len = str.size();
+			const simd::Kernels & kernels = simd::kernels();
+			const char * p = str.data();
+			std::string::size_type i, j, len = str.size(), n = 0;
 			for (i = j = 0; i < len; )
 			{
 
-				while ( i < len && ::isspace( str[i] ) ) i++;
+				i += kernels.span( p + i, len - i, simd::SPACE, true );
 				j = i;
 
-				while ( i < len && ! ::isspace( str[i]) ) i++;
+				i += kernels.span( p + i, len - i, simd::SPACE, false );
 
 
 
@@ -87,52 +102,116 @@ const std::string colon = ":";
 				{
 					if ( maxsplit-- <= 0 ) break;
 
-					result.push_back( str.substr( j, i - j ));
+					set_word( result, n++, str, j, i - j );
 
-					while ( i < len && ::isspace( str[i])) i++;
+					i += kernels.span( p + i, len - i, simd::SPACE, true );
 					j = i;
 				}
 			}
 			if (j < len)
 			{
-				result.push_back( str.substr( j, len - j ));
+				set_word( result, n++, str, j, len - j );
 			}
+			result.resize( n );
 		}
 
-
 		//////////////////////////////////////////////////////////////////////////////////////////////
 		///
 		///
-		void rsplit_whitespace( const std::string & str, std::vector< std::string > & result, int maxsplit )
+		template < class String, class Words >
+		void split_generic( const String & str, Words & result, const String & sep, int maxsplit )
 		{
-			std::string::size_type len = str.size();
-			std::string::size_type i, j;
-			for (i = j = len; i > 0; )
+			if ( maxsplit < 0 ) maxsplit = MAX_32BIT_INT;//result.max_size();
+
+			if ( sep.size() == 0 )
 			{
+				split_whitespace( str, result, maxsplit );
+				return;
+			}
 
-				while ( i > 0 && ::isspace( str[i - 1] ) ) i--;
-				j = i;
+			const simd::Kernels & kernels = simd::kernels();
+			std::string::size_type i, j, len = str.size(), n = sep.size(), k = 0;
+
+			for ( j = 0; ; j = i + n )
+			{
+				i = j + kernels.find( str.data() + j, len - j, sep.data(), n );
+				if ( i == len ) break;
+				if ( maxsplit-- <= 0 ) break;
 
-				while ( i > 0 && ! ::isspace( str[i - 1]) ) i--;
+				set_word( result, k++, str, j, i - j );
+			}
 
+			set_word( result, k++, str, j, len - j );
+			result.resize( k );
+		}
 
 
-				if (j > i)
-				{
-					if ( maxsplit-- <= 0 ) break;
+		//////////////////////////////////////////////////////////////////////////////////////////////
+		/// The rsplits find their words from the end. A first pass only counts the splits, so the
+		/// second can store the words from the last slot down and they end up in order without
+		/// being reversed.
+		///
+		template < class String, class Words >
+		void rsplit_whitespace( const String & str, Words & result, int maxsplit )
+		{
+			const simd::Kernels & kernels = simd::kernels();
+			const char * p = str.data();
+			std::string::size_type len = str.size(), i, j, words;
+
+			for ( i = len, words = 0; ; ++words )
+			{
+				i = kernels.rspan( p, i, simd::SPACE, true );
+				if ( i == 0 || words == (std::string::size_type) maxsplit ) break;
+				i = kernels.rspan( p, i, simd::SPACE, false );
+			}
 
-					result.push_back( str.substr( i, j - i ));
+			// Whatever is left before the last word split off, leading whitespace included
+			std::string::size_type n = words + ( i > 0 ? 1 : 0 );
+			result.resize( n );
+			if ( i > 0 ) set_word( result, 0, str, 0, i );
 
-					while ( i > 0 && ::isspace( str[i - 1])) i--;
-					j = i;
-				}
+			for ( i = len; words > 0; --words )
+			{
+				j = kernels.rspan( p, i, simd::SPACE, true );
+				i = kernels.rspan( p, j, simd::SPACE, false );
+				set_word( result, --n, str, i, j - i );
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////
+		///
+		///
+		template < class String, class Words >
+		void rsplit_generic( const String & str, Words & result, const String & sep, int maxsplit )
+		{
+			if ( maxsplit < 0 )
+			{
+				split_generic( str, result, sep, maxsplit );
+				return;
+			}
+
+			if ( sep.size() == 0 )
+			{
+				rsplit_whitespace( str, result, maxsplit );
+				return;
+			}
+
+			const simd::Kernels & kernels = simd::kernels();
+			std::string::size_type i, j, len = str.size(), n = sep.size(), splits;
+
+			for ( j = len, splits = 0; splits < (std::string::size_type) maxsplit; ++splits, j = i )
+			{
+				i = kernels.rfind( str.data(), j, sep.data(), n );
+				if ( i == j ) break;
 			}
-			if (j > 0)
+
+			result.resize( splits + 1 );
+			for ( j = len; splits > 0; --splits, j = i )
 			{
-				result.push_back( str.substr( 0, j ));
+				i = kernels.rfind( str.data(), j, sep.data(), n );
+				set_word( result, splits, str, i + n, j - i - n );
 			}
-			//std::reverse( result, result.begin(), result.end() );
-			reverse_strings( result );
+			set_word( result, 0, str, 0, j );
 		}
 
 	} //anonymous namespace
@@ -143,80 +222,42 @@ const std::string colon = ":";
     ///
     void split( const std::string & str, std::vector< std::string > & result, const std::string & sep, int maxsplit )
     {
-        result.clear();
-
-        if ( maxsplit < 0 ) maxsplit = MAX_32BIT_INT;//result.max_size();
-
-
-        if ( sep.size() == 0 )
-        {
-            split_whitespace( str, result, maxsplit );
-            return;
-        }
-
-        std::string::size_type i,j, len = str.size(), n = sep.size();
-
-        i = j = 0;
-
-        while ( i+n <= len )
-        {
-            if ( str[i] == sep[0] && str.substr( i, n ) == sep )
-            {
-                if ( maxsplit-- <= 0 ) break;
-
-                result.push_back( str.substr( j, i - j ) );
-                i = j = i + n;
-            }
-            else
-            {
-                i++;
-            }
-        }
+        PYSTRING_STATS_SCOPE( "split", str );
+        split_generic( str, result, sep, maxsplit );
+        PYSTRING_STATS_RESULT( result );
+    }
 
-        result.push_back( str.substr( j, len-j ) );
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void split( std::string_view str, std::vector< std::string_view > & result, std::string_view sep, int maxsplit )
+    {
+        PYSTRING_STATS_SCOPE( "split", str );
+        split_generic( str, result, sep, maxsplit );
     }
+#endif
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
     void rsplit( const std::string & str, std::vector< std::string > & result, const std::string & sep, int maxsplit )
     {
-        if ( maxsplit < 0 )
-        {
-            split( str, result, sep, maxsplit );
-            return;
-        }
-
-        result.clear();
-
-        if ( sep.size() == 0 )
-        {
-            rsplit_whitespace( str, result, maxsplit );
-            return;
-        }
-
-        Py_ssize_t i,j, len = (Py_ssize_t) str.size(), n = (Py_ssize_t) sep.size();
-
-        i = j = len;
-
-        while ( i >= n )
-        {
-            if ( str[i - 1] == sep[n - 1] && str.substr( i - n, n ) == sep )
-            {
-                if ( maxsplit-- <= 0 ) break;
-
-                result.push_back( str.substr( i, j - i ) );
-                i = j = i - n;
-            }
-            else
-            {
-                i--;
-            }
-        }
+        PYSTRING_STATS_SCOPE( "rsplit", str );
+        rsplit_generic( str, result, sep, maxsplit );
+        PYSTRING_STATS_RESULT( result );
+    }
 
-        result.push_back( str.substr( 0, j ) );
-        reverse_strings( result );
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void rsplit( std::string_view str, std::vector< std::string_view > & result, std::string_view sep, int maxsplit )
+    {
+        PYSTRING_STATS_SCOPE( "rsplit", str );
+        rsplit_generic( str, result, sep, maxsplit );
     }
+#endif
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -300,6 +341,7 @@ const std::string colon = ":";
     ///
     void partition( const std::string & str, const std::string & sep, std::vector< std::string > & result )
     {
+        PYSTRING_STATS_SCOPE( "partition", str );
         result.resize(3);
         int index = find( str, sep );
         if ( index < 0 )
@@ -314,6 +356,7 @@ const std::string colon = ":";
             result[1] = sep;
             result[2] = str.substr( index + sep.size(), str.size() );
         }
+        PYSTRING_STATS_RESULT( result );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -321,6 +364,7 @@ const std::string colon = ":";
     ///
     void rpartition( const std::string & str, const std::string & sep, std::vector< std::string > & result )
     {
+        PYSTRING_STATS_SCOPE( "rpartition", str );
         result.resize(3);
         int index = rfind( str, sep );
         if ( index < 0 )
@@ -335,14 +379,59 @@ const std::string colon = ":";
             result[1] = sep;
             result[2] = str.substr( index + sep.size(), str.size() );
         }
+        PYSTRING_STATS_RESULT( result );
+    }
+
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    Partition partition_view( std::string_view str, std::string_view sep )
+    {
+        PYSTRING_STATS_SCOPE( "partition_view", str );
+        std::string_view::size_type index = 0;
+        if ( sep.size() > str.size() )
+        {
+            index = str.size();
+        }
+        else if ( !sep.empty() )
+        {
+            index = simd::kernels().find( str.data(), str.size(), sep.data(), sep.size() );
+        }
+
+        // Not found leaves empty views at the end of str, so all three still point into it
+        if ( index == str.size() && !sep.empty() ) return { str, str.substr( index ), str.substr( index ) };
+        return { str.substr( 0, index ), str.substr( index, sep.size() ), str.substr( index + sep.size() ) };
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    Partition rpartition_view( std::string_view str, std::string_view sep )
+    {
+        PYSTRING_STATS_SCOPE( "rpartition_view", str );
+        std::string_view::size_type index = str.size();
+        if ( sep.size() > str.size() )
+        {
+            return { str.substr( 0, 0 ), str.substr( 0, 0 ), str };
+        }
+        else if ( !sep.empty() )
+        {
+            index = simd::kernels().rfind( str.data(), str.size(), sep.data(), sep.size() );
+            if ( index == str.size() ) return { str.substr( 0, 0 ), str.substr( 0, 0 ), str };
+        }
+
+        return { str.substr( 0, index ), str.substr( index, sep.size() ), str.substr( index + sep.size() ) };
     }
+#endif
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
     std::string strip( const std::string & str, const std::string & chars )
     {
-        return do_strip( str, BOTHSTRIP, chars );
+        PYSTRING_STATS_SCOPE( "strip", str );
+        return PYSTRING_STATS_RETURN( do_strip( str, BOTHSTRIP, chars ) );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -350,7 +439,8 @@ const std::string colon = ":";
     ///
     std::string lstrip( const std::string & str, const std::string & chars )
     {
-        return do_strip( str, LEFTSTRIP, chars );
+        PYSTRING_STATS_SCOPE( "lstrip", str );
+        return PYSTRING_STATS_RETURN( do_strip( str, LEFTSTRIP, chars ) );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -358,7 +448,8 @@ const std::string colon = ":";
     ///
     std::string rstrip( const std::string & str, const std::string & chars )
     {
-        return do_strip( str, RIGHTSTRIP, chars );
+        PYSTRING_STATS_SCOPE( "rstrip", str );
+        return PYSTRING_STATS_RETURN( do_strip( str, RIGHTSTRIP, chars ) );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -366,10 +457,11 @@ const std::string colon = ":";
     ///
     std::string join( const std::string & str, const std::vector< std::string > & seq )
     {
+        PYSTRING_STATS_SCOPE( "join", seq );
         std::vector< std::string >::size_type seqlen = seq.size(), i;
 
-        if ( seqlen == 0 ) return empty_string;
-        if ( seqlen == 1 ) return seq[0];
+        if ( seqlen == 0 ) return PYSTRING_STATS_RETURN( empty_string );
+        if ( seqlen == 1 ) return PYSTRING_STATS_RETURN( seq[0] );
 
         std::string result( seq[0] );
 
@@ -379,7 +471,7 @@ const std::string colon = ":";
 
         }
 
-
+        PYSTRING_STATS_RESULT( result );
         return result;
     }
 
@@ -397,7 +489,7 @@ const std::string colon = ":";
         
         int _string_tailmatch(const std::string & self, const std::string & substr,
                               Py_ssize_t start, Py_ssize_t end,
-                              int direction)
+                              int direction, bool ignore_case = false)
         {
             Py_ssize_t len = (Py_ssize_t) self.size();
             Py_ssize_t slen = (Py_ssize_t) substr.size();
@@ -419,7 +511,11 @@ const std::string colon = ":";
                     start = end - slen;
             }
             if (end-start >= slen)
+            {
+                if (ignore_case)
+                    return simd::kernels().imismatch(str+start, sub, (size_t) slen) == (size_t) slen;
                 return (!std::memcmp(str+start, sub, slen));
+            }
             
             return 0;
         }
@@ -427,6 +523,7 @@ const std::string colon = ":";
     
     bool endswith( const std::string & str, const std::string & suffix, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "endswith", str );
         int result = _string_tailmatch(str, suffix,
                                        (Py_ssize_t) start, (Py_ssize_t) end, +1);
         //if (result == -1) // TODO: Error condition
@@ -437,6 +534,7 @@ const std::string colon = ":";
     
     bool startswith( const std::string & str, const std::string & prefix, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "startswith", str );
         int result = _string_tailmatch(str, prefix,
                                        (Py_ssize_t) start, (Py_ssize_t) end, -1);
         //if (result == -1) // TODO: Error condition
@@ -444,13 +542,33 @@ const std::string colon = ":";
         return static_cast<bool>(result);
     }
 
+    bool iendswith( const std::string & str, const std::string & suffix, int start, int end )
+    {
+        PYSTRING_STATS_SCOPE( "iendswith", str );
+        return _string_tailmatch(str, suffix, (Py_ssize_t) start, (Py_ssize_t) end, +1, true) != 0;
+    }
+
+    bool istartswith( const std::string & str, const std::string & prefix, int start, int end )
+    {
+        PYSTRING_STATS_SCOPE( "istartswith", str );
+        return _string_tailmatch(str, prefix, (Py_ssize_t) start, (Py_ssize_t) end, -1, true) != 0;
+    }
+
+    bool iequals( const std::string & str, const std::string & other )
+    {
+        PYSTRING_STATS_SCOPE( "iequals", str );
+        std::string::size_type len = str.size();
+        return len == other.size() && simd::kernels().imismatch( str.data(), other.data(), len ) == len;
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
 
     bool isalnum( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "isalnum", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
 
 
@@ -459,11 +577,7 @@ const std::string colon = ":";
             return ::isalnum( str[0] );
         }
 
-        for ( i = 0; i < len; ++i )
-        {
-            if ( !::isalnum( str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::ALNUM, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -471,15 +585,12 @@ const std::string colon = ":";
     ///
     bool isalpha( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "isalpha", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
         if( len == 1 ) return ::isalpha( (int) str[0] );
 
-        for ( i = 0; i < len; ++i )
-        {
-           if ( !::isalpha( (int) str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::ALPHA, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -487,15 +598,12 @@ const std::string colon = ":";
     ///
     bool isdigit( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "isdigit", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
         if( len == 1 ) return ::isdigit( str[0] );
 
-        for ( i = 0; i < len; ++i )
-        {
-           if ( ! ::isdigit( str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::DIGIT, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -503,15 +611,12 @@ const std::string colon = ":";
     ///
     bool islower( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "islower", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
         if( len == 1 ) return ::islower( str[0] );
 
-        for ( i = 0; i < len; ++i )
-        {
-           if ( !::islower( str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::LOWER, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -519,15 +624,12 @@ const std::string colon = ":";
     ///
     bool isspace( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "isspace", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
         if( len == 1 ) return ::isspace( str[0] );
 
-        for ( i = 0; i < len; ++i )
-        {
-           if ( !::isspace( str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::SPACE, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -535,6 +637,7 @@ const std::string colon = ":";
     ///
     bool istitle( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "istitle", str );
         std::string::size_type len = str.size(), i;
 
         if ( len == 0 ) return false;
@@ -579,15 +682,12 @@ const std::string colon = ":";
     ///
     bool isupper( const std::string & str )
     {
-        std::string::size_type len = str.size(), i;
+        PYSTRING_STATS_SCOPE( "isupper", str );
+        std::string::size_type len = str.size();
         if ( len == 0 ) return false;
         if( len == 1 ) return ::isupper( str[0] );
 
-        for ( i = 0; i < len; ++i )
-        {
-           if ( !::isupper( str[i] ) ) return false;
-        }
-        return true;
+        return simd::kernels().span( str.data(), len, simd::UPPER, true ) == len;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -595,6 +695,7 @@ const std::string colon = ":";
     ///
     std::string capitalize( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "capitalize", str );
         std::string s( str );
         std::string::size_type len = s.size(), i;
 
@@ -608,22 +709,33 @@ const std::string colon = ":";
             if (::isupper(s[i])) s[i] = (char) ::tolower( s[i] );
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
-    std::string lower( const std::string & str )
+    std::string casefold( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "casefold", str );
         std::string s( str );
-        std::string::size_type len = s.size(), i;
+        simd::kernels().lower( &s[0], s.size() );
 
-        for ( i = 0; i < len; ++i )
-        {
-            if ( ::isupper( s[i] ) ) s[i] = (char) ::tolower( s[i] );
-        }
+        PYSTRING_STATS_RESULT( s );
+        return s;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::string lower( const std::string & str )
+    {
+        PYSTRING_STATS_SCOPE( "lower", str );
+        std::string s( str );
+        simd::kernels().lower( &s[0], s.size() );
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
@@ -632,14 +744,11 @@ const std::string colon = ":";
     ///
     std::string upper( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "upper", str );
         std::string s( str ) ;
-        std::string::size_type len = s.size(), i;
-
-        for ( i = 0; i < len; ++i )
-        {
-            if ( ::islower( s[i] ) ) s[i] = (char) ::toupper( s[i] );
-        }
+        simd::kernels().upper( &s[0], s.size() );
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
@@ -648,6 +757,7 @@ const std::string colon = ":";
     ///
     std::string swapcase( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "swapcase", str );
         std::string s( str );
         std::string::size_type len = s.size(), i;
 
@@ -657,6 +767,7 @@ const std::string colon = ":";
             else if (::isupper( s[i] ) ) s[i] = (char) ::tolower( s[i] );
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
@@ -665,6 +776,7 @@ const std::string colon = ":";
     ///
     std::string title( const std::string & str )
     {
+        PYSTRING_STATS_SCOPE( "title", str );
         std::string s( str );
         std::string::size_type len = s.size(), i;
         bool previous_is_cased = false;
@@ -694,6 +806,7 @@ const std::string colon = ":";
             }
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
@@ -702,13 +815,14 @@ const std::string colon = ":";
     ///
     std::string translate( const std::string & str, const std::string & table, const std::string & deletechars )
     {
+        PYSTRING_STATS_SCOPE( "translate", str );
         std::string s;
         std::string::size_type len = str.size(), dellen = deletechars.size();
 
         if ( table.size() != 256 )
         {
             // TODO : raise exception instead
-            return str;
+            return PYSTRING_STATS_RETURN( str );
         }
 
         //if nothing is deleted, use faster code
@@ -719,6 +833,7 @@ const std::string colon = ":";
             {
                 s[i] = table[ s[i] ];
             }
+            PYSTRING_STATS_RESULT( s );
             return s;
         }
 
@@ -742,6 +857,7 @@ const std::string colon = ":";
             }
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
 
     }
@@ -752,11 +868,12 @@ const std::string colon = ":";
     ///
     std::string zfill( const std::string & str, int width )
     {
+        PYSTRING_STATS_SCOPE( "zfill", str );
         int len = (int)str.size();
 
         if ( len >= width )
         {
-            return str;
+            return PYSTRING_STATS_RETURN( str );
         }
 
         std::string s( str );
@@ -772,6 +889,7 @@ const std::string colon = ":";
             s[fill] = '0';
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
 
     }
@@ -781,9 +899,10 @@ const std::string colon = ":";
     ///
     std::string ljust( const std::string & str, int width )
     {
+        PYSTRING_STATS_SCOPE( "ljust", str );
         std::string::size_type len = str.size();
-        if ( (( int ) len ) >= width ) return str;
-        return str + std::string( width - len, ' ' );
+        if ( (( int ) len ) >= width ) return PYSTRING_STATS_RETURN( str );
+        return PYSTRING_STATS_RETURN( str + std::string( width - len, ' ' ) );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -791,9 +910,10 @@ const std::string colon = ":";
     ///
     std::string rjust( const std::string & str, int width )
     {
+        PYSTRING_STATS_SCOPE( "rjust", str );
         std::string::size_type len = str.size();
-        if ( (( int ) len ) >= width ) return str;
-        return std::string( width - len, ' ' ) + str;
+        if ( (( int ) len ) >= width ) return PYSTRING_STATS_RETURN( str );
+        return PYSTRING_STATS_RETURN( std::string( width - len, ' ' ) + str );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -801,15 +921,16 @@ const std::string colon = ":";
     ///
     std::string center( const std::string & str, int width )
     {
+        PYSTRING_STATS_SCOPE( "center", str );
         int len = (int) str.size();
         int marg, left;
 
-        if ( len >= width ) return str;
+        if ( len >= width ) return PYSTRING_STATS_RETURN( str );
 
         marg = width - len;
         left = marg / 2 + (marg & width & 1);
 
-        return std::string( left, ' ' ) + str + std::string( marg - left, ' ' );
+        return PYSTRING_STATS_RETURN( std::string( left, ' ' ) + str + std::string( marg - left, ' ' ) );
 
     }
 
@@ -818,9 +939,10 @@ const std::string colon = ":";
     ///
     std::string slice( const std::string & str, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "slice", str );
         ADJUST_INDICES(start, end, (int) str.size());
-        if ( start >= end ) return empty_string;
-        return str.substr( start, end - start );
+        if ( start >= end ) return PYSTRING_STATS_RETURN( empty_string );
+        return PYSTRING_STATS_RETURN( str.substr( start, end - start ) );
     }
     
     
@@ -829,19 +951,18 @@ const std::string colon = ":";
     ///
     int find( const std::string & str, const std::string & sub, int start, int end  )
     {
+        PYSTRING_STATS_SCOPE( "find", str );
         ADJUST_INDICES(start, end, (int) str.size());
         
-        std::string::size_type result = str.find( sub, start );
+        // The whole match has to fit in [start, end)
+        if( end - start < (int) sub.size() ) return -1;
+        if( sub.empty() ) return start;
         
-        // If we cannot find the string, or if the end-point of our found substring is past
-        // the allowed end limit, return that it can't be found.
-        if( result == std::string::npos || 
-           (result + sub.size() > (std::string::size_type)end) )
-        {
-            return -1;
-        }
+        std::string::size_type n = (std::string::size_type) (end - start);
+        std::string::size_type result = simd::kernels().find( str.data() + start, n, sub.data(), sub.size() );
+        if( result == n ) return -1;
         
-        return (int) result;
+        return start + (int) result;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -849,24 +970,72 @@ const std::string colon = ":";
     ///
     int index( const std::string & str, const std::string & sub, int start, int end  )
     {
+        PYSTRING_STATS_SCOPE( "index", str );
         return find( str, sub, start, end );
     }
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    int ifind( const std::string & str, const std::string & sub, int start, int end )
+    {
+        PYSTRING_STATS_SCOPE( "ifind", str );
+        ADJUST_INDICES(start, end, (int) str.size());
+
+        if( end - start < (int) sub.size() ) return -1;
+        if( sub.empty() ) return start;
+
+        std::string::size_type n = (std::string::size_type) (end - start);
+        std::string::size_type result = simd::kernels().ifind( str.data() + start, n, sub.data(), sub.size() );
+        if( result == n ) return -1;
+
+        return start + (int) result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    int icount( const std::string & str, const std::string & substr, int start, int end )
+    {
+        PYSTRING_STATS_SCOPE( "icount", str );
+        ADJUST_INDICES(start, end, (int) str.size());
+
+        if( end - start < (int) substr.size() ) return 0;
+        if( substr.empty() ) return end - start + 1;
+
+        const simd::Kernels & k = simd::kernels();
+        std::string::size_type cursor = (std::string::size_type) start, stop = (std::string::size_type) end;
+        int nummatches = 0;
+
+        while ( stop - cursor >= substr.size() )
+        {
+            std::string::size_type result = k.ifind( str.data() + cursor, stop - cursor, substr.data(), substr.size() );
+            if ( result == stop - cursor ) break;
+
+            cursor += result + substr.size();
+            nummatches += 1;
+        }
+
+        return nummatches;
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
     int rfind( const std::string & str, const std::string & sub, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "rfind", str );
         ADJUST_INDICES(start, end, (int) str.size());
-        
-        std::string::size_type result = str.rfind( sub, end );
-        
-        if( result == std::string::npos || 
-            result < (std::string::size_type)start  || 
-           (result + sub.size() > (std::string::size_type)end))
-            return -1;
-        
-        return (int)result;
+
+        // The whole match has to fit in [start, end)
+        if( end - start < (int) sub.size() ) return -1;
+        if( sub.empty() ) return end;
+
+        std::string::size_type n = (std::string::size_type) (end - start);
+        std::string::size_type result = simd::kernels().rfind( str.data() + start, n, sub.data(), sub.size() );
+        if( result == n ) return -1;
+
+        return start + (int) result;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -874,6 +1043,7 @@ const std::string colon = ":";
     ///
     int rindex( const std::string & str, const std::string & sub, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "rindex", str );
         return rfind( str, sub, start, end );
     }
 
@@ -882,6 +1052,7 @@ const std::string colon = ":";
     ///
     std::string expandtabs( const std::string & str, int tabsize )
     {
+        PYSTRING_STATS_SCOPE( "expandtabs", str );
         std::string s( str );
 
         std::string::size_type len = str.size(), i = 0;
@@ -919,6 +1090,7 @@ const std::string colon = ":";
             }
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
     }
 
@@ -927,6 +1099,7 @@ const std::string colon = ":";
     ///
     int count( const std::string & str, const std::string & substr, int start, int end )
     {
+        PYSTRING_STATS_SCOPE( "count", str );
         int nummatches = 0;
         int cursor = start;
 
@@ -951,6 +1124,7 @@ const std::string colon = ":";
     
     std::string replace( const std::string & str, const std::string & oldstr, const std::string & newstr, int count )
     {
+        PYSTRING_STATS_SCOPE( "replace", str );
         int sofar = 0;
         int cursor = 0;
         std::string s( str );
@@ -981,6 +1155,7 @@ const std::string colon = ":";
             ++sofar;
         }
 
+        PYSTRING_STATS_RESULT( s );
         return s;
 
     }
@@ -991,6 +1166,7 @@ const std::string colon = ":";
     ///
     void splitlines(  const std::string & str, std::vector< std::string > & result, bool keepends )
     {
+        PYSTRING_STATS_SCOPE( "splitlines", str );
         result.clear();
         std::string::size_type len = str.size(), i, j, eol;
 
@@ -1024,6 +1200,7 @@ const std::string colon = ":";
             result.push_back( str.substr( j, len - j ) );
         }
 
+        PYSTRING_STATS_RESULT( result );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -1031,16 +1208,18 @@ const std::string colon = ":";
     ///
     std::string mul( const std::string & str, int n )
     {
+        PYSTRING_STATS_SCOPE( "mul", str );
+
         // Early exits
-        if (n <= 0) return empty_string;
-        if (n == 1) return str;
+        if (n <= 0) return PYSTRING_STATS_RETURN( empty_string );
+        if (n == 1) return PYSTRING_STATS_RETURN( str );
         
         std::ostringstream os;
         for(int i=0; i<n; ++i)
         {
             os << str;
         }
-        return os.str();
+        return PYSTRING_STATS_RETURN( os.str() );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -1048,12 +1227,13 @@ const std::string colon = ":";
     ///
     std::string removeprefix( const std::string & str, const std::string & prefix )
     {
+        PYSTRING_STATS_SCOPE( "removeprefix", str );
         if (pystring::startswith(str, prefix))
         {
-            return str.substr(prefix.length());
+            return PYSTRING_STATS_RETURN( str.substr(prefix.length()) );
         }
 
-        return str;
+        return PYSTRING_STATS_RETURN( str );
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////
@@ -1061,12 +1241,13 @@ const std::string colon = ":";
     ///
     std::string removesuffix( const std::string & str, const std::string & suffix )
     {
+        PYSTRING_STATS_SCOPE( "removesuffix", str );
         if (pystring::endswith(str, suffix))
         {
-            return str.substr(0, str.length() - suffix.length());
+            return PYSTRING_STATS_RETURN( str.substr(0, str.length() - suffix.length()) );
         }
 
-        return str;
+        return PYSTRING_STATS_RETURN( str );
     }
 
 
@@ -1081,30 +1262,80 @@ namespace path
     /// These functions are C++ ports of the python2.6 versions of os.path,
     /// and come from genericpath.py, ntpath.py, posixpath.py
 
-    /// Split a pathname into drive and path specifiers.
-    /// Returns drivespec, pathspec. Either part may be empty.
-    void splitdrive_nt(std::string & drivespec, std::string & pathspec,
-                       const std::string & p)
+    namespace
     {
-        if (p.size() >= 2 && p[1] == ':')
+        // The parts of a path are found as offsets, shared by the std::string and the
+        // std::string_view versions, so that neither copies anything while looking.
+
+        std::size_t drive_nt(const char * p, std::size_t n)
         {
-            std::string path = p; // In case drivespec == p
-            drivespec = pystring::slice(path, 0, 2);
-            pathspec = pystring::slice(path, 2);
+            return n >= 2 && p[1] == ':' ? 2 : 0;
         }
-        else
+
+        // split() leaves path[0, head) in head and path[tail, n) in tail. One backward scan
+        // finds the last separator after the drive, then the run of separators before it,
+        // which is only stripped from head if something other than the drive is left.
+        void split_offsets(const char * p, std::size_t n, bool nt, std::size_t & head, std::size_t & tail)
+        {
+            std::size_t d = nt ? drive_nt(p, n) : 0, i = n;
+            while(i > d && p[i - 1] != '/' && !(nt && p[i - 1] == '\\')) --i;
+            tail = i;
+            while(i > d && (p[i - 1] == '/' || (nt && p[i - 1] == '\\'))) --i;
+            head = i > d ? i : tail;
+        }
+
+        // splitext() splits path at the returned offset: the last dot of the last component,
+        // unless only dots come before it in that component.
+        std::size_t splitext_offset(const char * p, std::size_t n, bool nt)
+        {
+            std::size_t i = n, dot = n;
+            while(i > 0 && p[i - 1] != '/' && !(nt && p[i - 1] == '\\'))
+            {
+                --i;
+                if(p[i] == '.' && dot == n) dot = i;
+            }
+            for(; i < dot; ++i)
+            {
+                if(p[i] != '.') return dot;
+            }
+            return n;
+        }
+
+        // Assign path[0, a) to first and path[b, n) to second. Either may be path itself.
+        void assign_parts(std::string & first, std::string & second, const std::string & path,
+                          std::size_t a, std::size_t b)
         {
-            drivespec = empty_string;
-            pathspec = p;
+            if(&second == &path)
+            {
+                first.assign(path, 0, a);
+                second.erase(0, b);
+            }
+            else
+            {
+                second.assign(path, b, std::string::npos);
+                first.assign(path, 0, a);
+            }
         }
     }
 
+    /// Split a pathname into drive and path specifiers.
+    /// Returns drivespec, pathspec. Either part may be empty.
+    void splitdrive_nt(std::string & drivespec, std::string & pathspec,
+                       const std::string & p)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.splitdrive_nt", p );
+        std::size_t d = drive_nt(p.data(), p.size());
+        assign_parts(drivespec, pathspec, p, d, d);
+        PYSTRING_STATS_RESULT( drivespec, pathspec );
+    }
+
     // On Posix, drive is always empty
     void splitdrive_posix(std::string & drivespec, std::string & pathspec,
                           const std::string & path)
     {
-        drivespec = empty_string;
-        pathspec = path;
+        PYSTRING_STATS_SCOPE( "os.path.splitdrive_posix", path );
+        assign_parts(drivespec, pathspec, path, 0, 0);
+        PYSTRING_STATS_RESULT( drivespec, pathspec );
     }
 
     void splitdrive(std::string & drivespec, std::string & pathspec,
@@ -1117,30 +1348,58 @@ namespace path
 #endif
     }
 
-    //////////////////////////////////////////////////////////////////////////////////////////////
-    ///
-    ///
-
-    // Test whether a path is absolute
-    // In windows, if the character to the right of the colon
-    // is a forward or backslash it's absolute.
-    bool isabs_nt(const std::string & path)
+#ifdef PYSTRING_HAVE_CXX17
+    void splitdrive_view_nt(std::string_view & drivespec, std::string_view & pathspec, std::string_view path)
     {
-        std::string drivespec, pathspec;
-        splitdrive_nt(drivespec, pathspec, path);
-        if(pathspec.empty()) return false;
-        return ((pathspec[0] == '/') || (pathspec[0] == '\\'));
+        PYSTRING_STATS_SCOPE( "os.path.splitdrive_view_nt", path );
+        std::size_t d = drive_nt(path.data(), path.size());
+        drivespec = path.substr(0, d);
+        pathspec = path.substr(d);
     }
 
-    bool isabs_posix(const std::string & s)
+    void splitdrive_view_posix(std::string_view & drivespec, std::string_view & pathspec, std::string_view path)
     {
-        return pystring::startswith(s, forward_slash);
+        PYSTRING_STATS_SCOPE( "os.path.splitdrive_view_posix", path );
+        drivespec = path.substr(0, 0);
+        pathspec = path;
     }
 
-    bool isabs(const std::string & path)
+    void splitdrive_view(std::string_view & drivespec, std::string_view & pathspec, std::string_view path)
     {
 #ifdef WINDOWS
-        return isabs_nt(path);
+        return splitdrive_view_nt(drivespec, pathspec, path);
+#else
+        return splitdrive_view_posix(drivespec, pathspec, path);
+#endif
+    }
+#endif
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+
+    // Test whether a path is absolute
+    // In windows, if the character to the right of the colon
+    // is a forward or backslash it's absolute.
+    bool isabs_nt(const std::string & path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.isabs_nt", path );
+        // Look at the first character after the drive, as splitdrive_nt would split it
+        std::string::size_type start = (path.size() >= 2 && path[1] == ':') ? 2 : 0;
+        if(path.size() <= start) return false;
+        return ((path[start] == '/') || (path[start] == '\\'));
+    }
+
+    bool isabs_posix(const std::string & s)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.isabs_posix", s );
+        return pystring::startswith(s, forward_slash);
+    }
+
+    bool isabs(const std::string & path)
+    {
+#ifdef WINDOWS
+        return isabs_nt(path);
 #else
         return isabs_posix(path);
 #endif
@@ -1153,16 +1412,18 @@ namespace path
     
     std::string abspath_nt(const std::string & path, const std::string & cwd)
     {
+        PYSTRING_STATS_SCOPE( "os.path.abspath_nt", path );
         std::string p = path;
         if(!isabs_nt(p)) p = join_nt(cwd, p);
-        return normpath_nt(p);
+        return PYSTRING_STATS_RETURN( normpath_nt(std::move(p)) );
     }
     
     std::string abspath_posix(const std::string & path, const std::string & cwd)
     {
+        PYSTRING_STATS_SCOPE( "os.path.abspath_posix", path );
         std::string p = path;
         if(!isabs_posix(p)) p = join_posix(cwd, p);
-        return normpath_posix(p);
+        return PYSTRING_STATS_RETURN( normpath_posix(std::move(p)) );
     }
     
     std::string abspath(const std::string & path, const std::string & cwd)
@@ -1179,102 +1440,184 @@ namespace path
     ///
     ///
 
-    std::string join_nt(const std::vector< std::string > & paths)
+    namespace
     {
-        if(paths.empty()) return empty_string;
-        if(paths.size() == 1) return paths[0];
-        
-        std::string path = paths[0];
-        
-        for(unsigned int i=1; i<paths.size(); ++i)
+        // The components of a vector, seen as JoinParts
+        struct StringParts
         {
-            std::string b = paths[i];
-            
-            bool b_nts = false;
-            if(path.empty())
+            const std::vector< std::string > & paths;
+            JoinPart operator[](std::size_t i) const { return JoinPart(paths[i]); }
+        };
+
+        // The components of a join, as the input counted by PYSTRING_STATS_SCOPE
+        struct JoinInput
+        {
+            JoinInput(const JoinPart * p, std::size_t n) : parts(p), count(n) {}
+
+            const JoinPart * parts;
+            std::size_t count;
+            std::size_t size() const
             {
-                b_nts = true;
+                std::size_t size = 0;
+                for(std::size_t i = 0; i < count; ++i) size += parts[i].size;
+                return size;
             }
-            else if(isabs_nt(b))
+        };
+
+        bool isabs_part_nt(const JoinPart & b)
+        {
+            std::size_t start = (b.size >= 2 && b.data[1] == ':') ? 2 : 0;
+            return b.size > start && (b.data[start] == '/' || b.data[start] == '\\');
+        }
+
+        // Append the join of parts[0, count) to result. A component with both a drive and a
+        // root starts over whatever comes before it, so the join starts at the last of them,
+        // and result is grown once to the size of what is left plus a separator per part.
+        template< class Parts >
+        void join_nt_parts(std::string & result, const Parts & parts, std::size_t count)
+        {
+            if(count == 0) return;
+
+            std::size_t k = count - 1;
+            while(k > 0 && !(parts[k].size >= 2 && parts[k].data[1] == ':' && isabs_part_nt(parts[k]))) --k;
+
+            std::size_t start = result.size(), bound = 0;
+            for(std::size_t i = k; i < count; ++i) bound += parts[i].size + 1;
+            result.reserve(start + bound);
+            result.append(parts[k].data, parts[k].size);
+
+            for(std::size_t i = k + 1; i < count; ++i)
             {
-                // This probably wipes out path so far.  However, it's more
-                // complicated if path begins with a drive letter:
-                //     1. join('c:', '/a') == 'c:/a'
-                //     2. join('c:/', '/a') == 'c:/a'
-                // But
-                //     3. join('c:/a', '/b') == '/b'
-                //     4. join('c:', 'd:/') = 'd:/'
-                //     5. join('c:/', 'd:/') = 'd:/'
-                
-
-                if ((path.size() >= 2 && path[1] != ':') || (b.size() >= 2 && b[1] == ':'))
-                {
-                    // Path doesnt start with a drive letter
-                    b_nts = true;
-                }
-                // Else path has a drive letter, and b doesn't but is absolute.
-                else if((path.size()>3) || 
-                        ((path.size()==3) && !pystring::endswith(path, forward_slash) && !pystring::endswith(path, double_back_slash)))
+                JoinPart b = parts[i];
+                const char * path = result.data() + start;
+                std::size_t n = result.size() - start;
+
+                bool b_nts = false;
+                if(n == 0)
                 {
                     b_nts = true;
                 }
-            }
-            
-            if(b_nts)
-            {
-                path = b;
-            }
-            else
-            {
-                // Join, and ensure there's a separator.
-                // assert len(path) > 0
-                if( pystring::endswith(path, forward_slash) || pystring::endswith(path, double_back_slash))
+                else if(isabs_part_nt(b))
                 {
-                    if(pystring::startswith(b,forward_slash) || pystring::startswith(b,double_back_slash))
+                    // This probably wipes out path so far.  However, it's more
+                    // complicated if path begins with a drive letter:
+                    //     1. join('c:', '/a') == 'c:/a'
+                    //     2. join('c:/', '/a') == 'c:/a'
+                    // But
+                    //     3. join('c:/a', '/b') == '/b'
+                    //     4. join('c:', 'd:/') = 'd:/'
+                    //     5. join('c:/', 'd:/') = 'd:/'
+                    if((n >= 2 && path[1] != ':') || (b.size >= 2 && b.data[1] == ':'))
                     {
-                        path += pystring::slice(b, 1);
+                        // Path doesnt start with a drive letter
+                        b_nts = true;
                     }
-                    else
+                    // Else path has a drive letter, and b doesn't but is absolute.
+                    else if(n > 3 || (n == 3 && path[2] != '/' && path[2] != '\\'))
                     {
-                        path += b;
+                        b_nts = true;
                     }
                 }
-                else if(pystring::endswith(path, colon))
+
+                bool b_sep = b.size > 0 && (b.data[0] == '/' || b.data[0] == '\\');
+                if(b_nts)
                 {
-                    path += b;
+                    result.resize(start);
+                    result.append(b.data, b.size);
                 }
-                else if(!b.empty())
+                else if(path[n - 1] == '/' || path[n - 1] == '\\')
                 {
-                    if(pystring::startswith(b, forward_slash) || pystring::startswith(b,double_back_slash))
-                    {
-                        path += b;
-                    }
-                    else
-                    {
-                        path += double_back_slash + b;
-                    }
+                    // Join, and ensure there's a separator.
+                    result.append(b.data + (b_sep ? 1 : 0), b.size - (b_sep ? 1 : 0));
+                }
+                else if(path[n - 1] == ':' || b_sep)
+                {
+                    result.append(b.data, b.size);
                 }
                 else
                 {
-                    // path is not empty and does not end with a backslash,
-                    // but b is empty; since, e.g., split('a/') produces
-                    // ('a', ''), it's best if join() adds a backslash in
-                    // this case.
-                    path += double_back_slash;
+                    // If b is empty, since, e.g., split('a/') produces ('a', ''),
+                    // it's best if join() adds a backslash in this case.
+                    result += '\\';
+                    result.append(b.data, b.size);
                 }
             }
         }
-        
+
+        // Append the join of parts[0, count) to result, which starts at the last absolute
+        // component. result is grown once, to exactly the size of the join.
+        template< class Parts >
+        void join_posix_parts(std::string & result, const Parts & parts, std::size_t count)
+        {
+            if(count == 0) return;
+
+            std::size_t k = count - 1;
+            while(k > 0 && !(parts[k].size > 0 && parts[k].data[0] == '/')) --k;
+
+            // A '/' goes before a component unless the path so far is empty or ends with one
+            std::size_t size = 0;
+            bool sep = true;
+            for(std::size_t i = k; i < count; ++i)
+            {
+                JoinPart b = parts[i];
+                size += b.size + (sep ? 0 : 1);
+                sep = b.size > 0 ? b.data[b.size - 1] == '/' : true;
+            }
+            result.reserve(result.size() + size);
+
+            sep = true;
+            for(std::size_t i = k; i < count; ++i)
+            {
+                JoinPart b = parts[i];
+                if(!sep) result += '/';
+                result.append(b.data, b.size);
+                sep = b.size > 0 ? b.data[b.size - 1] == '/' : true;
+            }
+        }
+    }
+
+    void join_append_nt(std::string & result, const JoinPart * parts, std::size_t count)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.join_append_nt", JoinInput(parts, count) );
+        join_nt_parts(result, parts, count);
+        PYSTRING_STATS_RESULT( result );
+    }
+
+    void join_append_posix(std::string & result, const JoinPart * parts, std::size_t count)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.join_append_posix", JoinInput(parts, count) );
+        join_posix_parts(result, parts, count);
+        PYSTRING_STATS_RESULT( result );
+    }
+
+    void join_append(std::string & result, const JoinPart * parts, std::size_t count)
+    {
+#ifdef WINDOWS
+        join_append_nt(result, parts, count);
+#else
+        join_append_posix(result, parts, count);
+#endif
+    }
+
+    std::string join_nt(const std::vector< std::string > & paths)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.join_nt", paths );
+        std::string path;
+        StringParts parts = { paths };
+        join_nt_parts(path, parts, paths.size());
+        PYSTRING_STATS_RESULT( path );
         return path;
     }
     
     // Join two or more pathname components, inserting double_back_slash as needed.
     std::string join_nt(const std::string & a, const std::string & b)
     {
-        std::vector< std::string > paths(2);
-        paths[0] = a;
-        paths[1] = b;
-        return join_nt(paths);
+        JoinPart parts[2] = { a, b };
+        PYSTRING_STATS_SCOPE( "os.path.join_nt", JoinInput(parts, 2) );
+        std::string path;
+        join_nt_parts(path, parts, 2);
+        PYSTRING_STATS_RESULT( path );
+        return path;
     }
 
     // Join pathnames.
@@ -1285,37 +1628,22 @@ namespace path
 
     std::string join_posix(const std::vector< std::string > & paths)
     {
-        if(paths.empty()) return empty_string;
-        if(paths.size() == 1) return paths[0];
-        
-        std::string path = paths[0];
-        
-        for(unsigned int i=1; i<paths.size(); ++i)
-        {
-            std::string b = paths[i];
-            if(pystring::startswith(b, forward_slash))
-            {
-                path = b;
-            }
-            else if(path.empty() || pystring::endswith(path, forward_slash))
-            {
-                path += b;
-            }
-            else
-            {
-                path += forward_slash + b;
-            }
-        }
-        
+        PYSTRING_STATS_SCOPE( "os.path.join_posix", paths );
+        std::string path;
+        StringParts parts = { paths };
+        join_posix_parts(path, parts, paths.size());
+        PYSTRING_STATS_RESULT( path );
         return path;
     }
 
     std::string join_posix(const std::string & a, const std::string & b)
     {
-        std::vector< std::string > paths(2);
-        paths[0] = a;
-        paths[1] = b;
-        return join_posix(paths);
+        JoinPart parts[2] = { a, b };
+        PYSTRING_STATS_SCOPE( "os.path.join_posix", JoinInput(parts, 2) );
+        std::string path;
+        join_posix_parts(path, parts, 2);
+        PYSTRING_STATS_RESULT( path );
+        return path;
     }
     
     std::string join(const std::string & path1, const std::string & path2)
@@ -1348,31 +1676,11 @@ namespace path
 
     void split_nt(std::string & head, std::string & tail, const std::string & path)
     {
-        std::string d, p;
-        splitdrive_nt(d, p, path);
-        
-        // set i to index beyond p's last slash
-        int i = (int)p.size();
-
-        // walk back to find the index of the first slash from the end       
-        while(i>0 && (p[i-1] != '\\') && (p[i-1] != '/'))
-        {
-            i = i - 1;
-        }
-
-        head = pystring::slice(p,0,i);
-        tail = pystring::slice(p,i); // now tail has no slashes
-        
-        // remove trailing slashes from head, unless it's all slashes
-        std::string head2 = head;
-        while(!head2.empty() && ((pystring::slice(head2,-1) == forward_slash) ||
-                                 (pystring::slice(head2,-1) == double_back_slash)))
-        {
-            head2 = pystring::slice(head2,0,-1);
-        }
-        
-        if(!head2.empty()) head = head2;
-        head = d + head;
+        PYSTRING_STATS_SCOPE( "os.path.split_nt", path );
+        std::size_t h, t;
+        split_offsets(path.data(), path.size(), true, h, t);
+        assign_parts(head, tail, path, h, t);
+        PYSTRING_STATS_RESULT( head, tail );
     }
 
 
@@ -1383,15 +1691,11 @@ namespace path
 
     void split_posix(std::string & head, std::string & tail, const std::string & p)
     {
-        int i = pystring::rfind(p, forward_slash) + 1;
-        
-        head = pystring::slice(p,0,i);
-        tail = pystring::slice(p,i);
-        
-        if(!head.empty() && (head != pystring::mul(forward_slash, (int) head.size())))
-        {
-            head = pystring::rstrip(head, forward_slash);
-        }
+        PYSTRING_STATS_SCOPE( "os.path.split_posix", p );
+        std::size_t h, t;
+        split_offsets(p.data(), p.size(), false, h, t);
+        assign_parts(head, tail, p, h, t);
+        PYSTRING_STATS_RESULT( head, tail );
     }
 
     void split(std::string & head, std::string & tail, const std::string & path)
@@ -1403,6 +1707,35 @@ namespace path
 #endif
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    void split_view_nt(std::string_view & head, std::string_view & tail, std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.split_view_nt", path );
+        std::size_t h, t;
+        split_offsets(path.data(), path.size(), true, h, t);
+        head = path.substr(0, h);
+        tail = path.substr(t);
+    }
+
+    void split_view_posix(std::string_view & head, std::string_view & tail, std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.split_view_posix", path );
+        std::size_t h, t;
+        split_offsets(path.data(), path.size(), false, h, t);
+        head = path.substr(0, h);
+        tail = path.substr(t);
+    }
+
+    void split_view(std::string_view & head, std::string_view & tail, std::string_view path)
+    {
+#ifdef WINDOWS
+        return split_view_nt(head, tail, path);
+#else
+        return split_view_posix(head, tail, path);
+#endif
+    }
+#endif
+
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
@@ -1410,16 +1743,18 @@ namespace path
 
     std::string basename_nt(const std::string & path)
     {
-        std::string head, tail;
-        split_nt(head, tail, path);
-        return tail;
+        PYSTRING_STATS_SCOPE( "os.path.basename_nt", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), true, head, tail);
+        return PYSTRING_STATS_RETURN( path.substr(tail) );
     }
 
     std::string basename_posix(const std::string & path)
     {
-        std::string head, tail;
-        split_posix(head, tail, path);
-        return tail;
+        PYSTRING_STATS_SCOPE( "os.path.basename_posix", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), false, head, tail);
+        return PYSTRING_STATS_RETURN( path.substr(tail) );
     }
 
     std::string basename(const std::string & path)
@@ -1433,16 +1768,18 @@ namespace path
 
     std::string dirname_nt(const std::string & path)
     {
-        std::string head, tail;
-        split_nt(head, tail, path);
-        return head;
+        PYSTRING_STATS_SCOPE( "os.path.dirname_nt", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), true, head, tail);
+        return PYSTRING_STATS_RETURN( path.substr(0, head) );
     }
     
     std::string dirname_posix(const std::string & path)
     {
-        std::string head, tail;
-        split_posix(head, tail, path);
-        return head;
+        PYSTRING_STATS_SCOPE( "os.path.dirname_posix", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), false, head, tail);
+        return PYSTRING_STATS_RETURN( path.substr(0, head) );
     }
     
     std::string dirname(const std::string & path)
@@ -1454,89 +1791,184 @@ namespace path
 #endif
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view basename_view_nt(std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.basename_view_nt", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), true, head, tail);
+        return path.substr(tail);
+    }
+
+    std::string_view basename_view_posix(std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.basename_view_posix", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), false, head, tail);
+        return path.substr(tail);
+    }
+
+    std::string_view basename_view(std::string_view path)
+    {
+#ifdef WINDOWS
+        return basename_view_nt(path);
+#else
+        return basename_view_posix(path);
+#endif
+    }
+
+    std::string_view dirname_view_nt(std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.dirname_view_nt", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), true, head, tail);
+        return path.substr(0, head);
+    }
+
+    std::string_view dirname_view_posix(std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.dirname_view_posix", path );
+        std::size_t head, tail;
+        split_offsets(path.data(), path.size(), false, head, tail);
+        return path.substr(0, head);
+    }
+
+    std::string_view dirname_view(std::string_view path)
+    {
+#ifdef WINDOWS
+        return dirname_view_nt(path);
+#else
+        return dirname_view_posix(path);
+#endif
+    }
+#endif
+
 
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
 
-    // Normalize a path, e.g. A//B, A/./B and A/foo/../B all become A\B.
-    std::string normpath_nt(const std::string & p)
+    namespace
     {
-        std::string path = p;
-        path = pystring::replace(path, forward_slash,double_back_slash);
-        
-        std::string prefix;
-        splitdrive_nt(prefix, path, path);
-        
-        // We need to be careful here. If the prefix is empty, and the path starts
-        // with a backslash, it could either be an absolute path on the current
-        // drive (\dir1\dir2\file) or a UNC filename (\\server\mount\dir1\file). It
-        // is therefore imperative NOT to collapse multiple backslashes blindly in
-        // that case.
-        // The code below preserves multiple backslashes when there is no drive
-        // letter. This means that the invalid filename \\\a\b is preserved
-        // unchanged, where a\\\b is normalised to a\b. It's not clear that there
-        // is any better behaviour for such edge cases.
-        
-        if(prefix.empty())
-        {
-            // No drive letter - preserve initial backslashes
-            while(pystring::slice(path,0,1) == double_back_slash)
-            {
-                prefix = prefix + double_back_slash;
-                path = pystring::slice(path,1);
-            }
-        }
-        else
-        {
-            // We have a drive letter - collapse initial backslashes
-            if(pystring::startswith(path, double_back_slash))
-            {
-                prefix = prefix + double_back_slash;
-                path = pystring::lstrip(path, double_back_slash);
-            }
-        }
-        
-        std::vector<std::string> comps;
-        pystring::split(path, comps, double_back_slash);
-        
-        int i = 0;
-        
-        while(i<(int)comps.size())
+        // Copy the components of the path src[i, n) to dst[root, ...), dropping empty and "."
+        // components and collapsing "..", and return the length of dst. dst[0, root) already
+        // holds the drive and leading separators, and anchored says whether they end in a
+        // separator, above which ".." is dropped too. dst may be src itself: the output never
+        // gets ahead of the read position. Kept components are counted rather than stacked, as
+        // ".." can only be kept in front of all the others; dropping the last one scans dst
+        // back to its separator.
+        std::size_t normalize_components(char * dst, std::size_t root, bool anchored,
+                                         const char * src, std::size_t i, std::size_t n, bool nt)
         {
-            if(comps[i].empty() || comps[i] == dot)
-            {
-                comps.erase(comps.begin()+i);
-            }
-            else if(comps[i] == double_dot)
+            const simd::Kernels & kernels = simd::kernels();
+            const char sep = nt ? '\\' : '/';
+
+            std::size_t w = root, kept = 0, parents = 0;
+            while(i < n)
             {
-                if(i>0 && comps[i-1] != double_dot)
+                // Components are usually short, so look at a few bytes before calling the
+                // kernels. nt paths may mix slashes and backslashes.
+                std::size_t j = i, stop = std::min(n, i + 16);
+                while(j < stop && src[j] != '/' && src[j] != sep) ++j;
+                if(j == stop && j < n)
+                {
+                    j += kernels.find_byte(src + j, n - j, '/');
+                    if(nt) j = stop + kernels.find_byte(src + stop, j - stop, '\\');
+                }
+
+                std::size_t len = j - i;
+                bool up = len == 2 && src[i] == '.' && src[i + 1] == '.';
+
+                if(len == 0 || (len == 1 && src[i] == '.'))
                 {
-                    comps.erase(comps.begin()+i-1, comps.begin()+i+1);
-                    i -= 1;
+                    // Empty or current directory
                 }
-                else if(i == 0 && pystring::endswith(prefix, double_back_slash))
+                else if(up && kept > parents)
                 {
-                    comps.erase(comps.begin()+i);
+                    while(w > root && dst[w - 1] != sep) --w;
+                    if(w > root) --w;
+                    --kept;
+                }
+                else if(up && anchored)
+                {
+                    // Nothing above the root
                 }
                 else
                 {
-                    i += 1;
+                    if(kept > 0) dst[w++] = sep;
+                    std::memmove(dst + w, src + i, len);
+                    w += len;
+                    ++kept;
+                    if(up) ++parents;
                 }
+                i = j + 1;
+            }
+            return w;
+        }
+
+        std::size_t normalize_nt(char * dst, const char * src, std::size_t n)
+        {
+            std::size_t i = 0, root = 0;
+            if(n >= 2 && src[1] == ':')
+            {
+                // We have a drive letter - collapse initial backslashes
+                dst[0] = src[0] == '/' ? '\\' : src[0];
+                dst[1] = ':';
+                i = root = 2;
+                if(i < n && (src[i] == '\\' || src[i] == '/')) dst[root++] = '\\';
+                while(i < n && (src[i] == '\\' || src[i] == '/')) ++i;
             }
             else
             {
-                i += 1;
+                // We need to be careful here. If there is no drive letter and the path
+                // starts with a backslash, it could either be an absolute path on the
+                // current drive (\dir1\dir2\file) or a UNC filename
+                // (\\server\mount\dir1\file). It is therefore imperative NOT to collapse
+                // multiple backslashes blindly in that case. This means that the invalid
+                // filename \\\a\b is preserved unchanged, where a\\\b is normalised to
+                // a\b. It's not clear that there is any better behaviour for such edge
+                // cases.
+                while(i < n && (src[i] == '\\' || src[i] == '/')) dst[root++] = '\\', ++i;
             }
+            return normalize_components(dst, root, root > 0 && dst[root - 1] == '\\', src, i, n, true);
         }
-        
-        // If the path is now empty, substitute '.'
-        if(prefix.empty() && comps.empty())
+
+        std::size_t normalize_posix(char * dst, const char * src, std::size_t n)
         {
-            comps.push_back(dot);
+            // POSIX allows one or two initial slashes, but treats three or more
+            // as single slash.
+            std::size_t i = 0;
+            while(i < n && src[i] == '/') ++i;
+            std::size_t root = i == 2 ? 2 : std::min< std::size_t >(i, 1);
+            std::fill(dst, dst + root, '/');
+            return normalize_components(dst, root, root > 0, src, i, n, false);
         }
-        
-        return prefix + pystring::join(double_back_slash, comps);
+    }
+
+    // Normalize a path, e.g. A//B, A/./B and A/foo/../B all become A\B.
+    std::string normpath_nt(const std::string & p)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.normpath_nt", p );
+        if(p.empty()) return PYSTRING_STATS_RETURN( dot );
+
+        std::string path(p.size(), '\0');
+        std::size_t len = normalize_nt(&path[0], p.data(), p.size());
+        if(len == 0) path = dot;
+        else path.resize(len);
+
+        PYSTRING_STATS_RESULT( path );
+        return path;
+    }
+
+    std::string normpath_nt(std::string && p)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.normpath_nt", p );
+        std::size_t len = p.empty() ? 0 : normalize_nt(&p[0], p.data(), p.size());
+        if(len == 0) p = dot;
+        else p.resize(len);
+
+        PYSTRING_STATS_RESULT( p );
+        return std::move(p);
     }
 
     // Normalize a path, e.g. A//B, A/./B and A/foo/../B all become A/B.
@@ -1546,47 +1978,28 @@ namespace path
 
     std::string normpath_posix(const std::string & p)
     {
-        if(p.empty()) return dot;
-        
-        std::string path = p;
-        
-        int initial_slashes = pystring::startswith(path, forward_slash) ? 1 : 0;
-        
-        // POSIX allows one or two initial slashes, but treats three or more
-        // as single slash.
-        
-        if (initial_slashes && pystring::startswith(path, double_forward_slash)
-            && !pystring::startswith(path, triple_forward_slash))
-            initial_slashes = 2;
-        
-        std::vector<std::string> comps, new_comps;
-        pystring::split(path, comps, forward_slash);
-        
-        for(unsigned int i=0; i<comps.size(); ++i)
-        {
-            std::string comp = comps[i];
-            if(comp.empty() || comp == dot)
-                continue;
-            
-            if( (comp != double_dot) || ((initial_slashes == 0) && new_comps.empty()) ||
-                (!new_comps.empty() && new_comps[new_comps.size()-1] == double_dot))
-            {
-                new_comps.push_back(comp);
-            }
-            else if (!new_comps.empty())
-            {
-                new_comps.pop_back();
-            }
-        }
-        
-        path = pystring::join(forward_slash, new_comps);
-        
-        if (initial_slashes > 0)
-            path = pystring::mul(forward_slash, initial_slashes) + path;
-        
-        if(path.empty()) return dot;
+        PYSTRING_STATS_SCOPE( "os.path.normpath_posix", p );
+        if(p.empty()) return PYSTRING_STATS_RETURN( dot );
+
+        std::string path(p.size(), '\0');
+        std::size_t len = normalize_posix(&path[0], p.data(), p.size());
+        if(len == 0) path = dot;
+        else path.resize(len);
+
+        PYSTRING_STATS_RESULT( path );
         return path;
     }
+
+    std::string normpath_posix(std::string && p)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.normpath_posix", p );
+        std::size_t len = p.empty() ? 0 : normalize_posix(&p[0], p.data(), p.size());
+        if(len == 0) p = dot;
+        else p.resize(len);
+
+        PYSTRING_STATS_RESULT( p );
+        return std::move(p);
+    }
     
     std::string normpath(const std::string & path)
     {
@@ -1597,61 +2010,281 @@ namespace path
 #endif
     }
 
+    std::string normpath(std::string && path)
+    {
+#ifdef WINDOWS
+        return normpath_nt(std::move(path));
+#else
+        return normpath_posix(std::move(path));
+#endif
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     ///
     ///
 
-    // Split the extension from a pathname.
-    // Extension is everything from the last dot to the end, ignoring
-    // leading dots.  Returns "(root, ext)"; ext may be empty.
-    // It is always true that root + ext == p
-
-    void splitext_generic(std::string & root, std::string & ext,
-                          const std::string & p,
-                          const std::string & sep,
-                          const std::string & altsep,
-                          const std::string & extsep)
+    namespace
     {
-        int sepIndex = pystring::rfind(p, sep);
-        if(!altsep.empty())
+        inline bool is_sep(char c, bool nt)
+        {
+            return c == '/' || (nt && c == '\\');
+        }
+
+        bool same_names(const char * a, const char * b, std::size_t n, bool nt)
+        {
+            return (nt ? simd::kernels().imismatch(a, b, n) : simd::kernels().mismatch(a, b, n)) == n;
+        }
+
+        // Steps through the names of path[start, n), leaving out empty ones and ".", the way
+        // python's commonpath() and relpath() filter the result of split(sep). Nothing is
+        // copied: next() gives the offsets of each name.
+        struct Names
+        {
+            Names(const std::string & path, std::size_t start, bool is_nt) :
+                p(path.data()), n(path.size()), i(start), nt(is_nt) {}
+
+            bool next(std::size_t & begin, std::size_t & end)
+            {
+                for(;;)
+                {
+                    while(i < n && is_sep(p[i], nt)) ++i;
+                    if(i == n) return false;
+                    begin = i;
+                    if(nt)
+                    {
+                        while(i < n && !is_sep(p[i], true)) ++i;
+                    }
+                    else
+                    {
+                        const void * sep = std::memchr(p + i, '/', n - i);
+                        i = sep ? (std::size_t) ((const char *) sep - p) : n;
+                    }
+                    end = i;
+                    if(end - begin != 1 || p[begin] != '.') return true;
+                }
+            }
+
+            const char * p;
+            std::size_t n, i;
+            bool nt;
+        };
+
+        // The length of the drive of path, and of its root after it: the first separator, or
+        // on nt without a drive all the leading ones, which normpath_nt() keeps for UNC paths
+        std::size_t anchor_of(const std::string & path, bool nt, std::size_t & drive)
+        {
+            drive = nt ? drive_nt(path.data(), path.size()) : 0;
+            std::size_t i = drive;
+            while(i < path.size() && is_sep(path[i], nt) && (i == drive || (nt && drive == 0))) ++i;
+            return i - drive;
+        }
+
+        // Make path absolute against cwd and normalize it, into a buffer of the caller
+        void absolute(std::string & result, const std::string & path, const std::string & cwd, bool nt)
         {
-            int altsepIndex = pystring::rfind(p, altsep);
-            sepIndex = std::max(sepIndex, altsepIndex);
+            result.clear();
+            if(nt ? isabs_nt(path) : isabs_posix(path)) result.append(path);
+            else if(nt) join_append_nt(result, cwd, path);
+            else join_append_posix(result, cwd, path);
+
+            if(result.empty()) return;
+            result.resize(nt ? normalize_nt(&result[0], result.data(), result.size())
+                             : normalize_posix(&result[0], result.data(), result.size()));
+        }
+
+        std::string relpath_generic(const std::string & path, const std::string & start, const std::string & cwd, bool nt)
+        {
+            if(path.empty()) return empty_string;
+
+            // Both are normalized in scratch buffers of the thread, which keep their memory
+            thread_local std::string to, from;
+            absolute(to, path, cwd, nt);
+            absolute(from, start, cwd, nt);
+
+            // On nt they must be on the same drive, or the same UNC share
+            std::size_t drive, from_drive;
+            std::size_t root = anchor_of(to, nt, drive), from_root = anchor_of(from, nt, from_drive);
+            if(drive != from_drive || !same_names(to.data(), from.data(), drive, true) || (nt && root != from_root))
+            {
+                return empty_string;
+            }
+
+            // Skip the names they have in common, then count the names of start left over
+            Names t(to, drive, nt), f(from, drive, nt);
+            std::size_t tb = 0, te = 0, fb = 0, fe = 0;
+            bool more_to, more_from;
+            for(;;)
+            {
+                more_to = t.next(tb, te);
+                more_from = f.next(fb, fe);
+                if(!more_to || !more_from || te - tb != fe - fb || !same_names(to.data() + tb, from.data() + fb, te - tb, nt))
+                {
+                    break;
+                }
+            }
+
+            std::size_t parents = more_from ? 1 : 0;
+            while(f.next(fb, fe)) ++parents;
+
+            // A normalized path has one separator between names and none at the end, so the
+            // rest of it is the rest of the result as it is
+            std::size_t rest = more_to ? to.size() - tb : 0;
+            if(parents == 0 && rest == 0) return dot;
+
+            char sep = nt ? '\\' : '/';
+            std::string result;
+            result.reserve(parents * 3 + rest);
+            for(std::size_t i = 0; i < parents; ++i)
+            {
+                if(i > 0) result += sep;
+                result += "..";
+            }
+            if(rest > 0)
+            {
+                if(parents > 0) result += sep;
+                result.append(to, tb, rest);
+            }
+            return result;
         }
 
-        int dotIndex = pystring::rfind(p, extsep);
-        if(dotIndex > sepIndex)
+        std::string commonpath_generic(const std::vector< std::string > & paths, bool nt)
         {
-            // Skip all leading dots
-            int filenameIndex = sepIndex + 1;
+            if(paths.empty()) return empty_string;
 
-            while(filenameIndex < dotIndex)
+            const std::string & first = paths[0];
+            std::size_t drive, root = anchor_of(first, nt, drive);
+
+            // The common names of all paths are the fewest any path has in common with the first
+            std::size_t common = first.size();
+            for(std::size_t i = 1; i < paths.size(); ++i)
             {
-                if(pystring::slice(p,filenameIndex) != extsep)
+                const std::string & p = paths[i];
+                std::size_t d;
+                if(anchor_of(p, nt, d) != root) return empty_string;
+                if(d != drive || !same_names(first.data(), p.data(), d, true)) return empty_string;
+
+                Names a(first, drive, nt), b(p, d, nt);
+                std::size_t ab, ae, bb, be, k = 0;
+                while(k < common && a.next(ab, ae) && b.next(bb, be) &&
+                      ae - ab == be - bb && same_names(first.data() + ab, p.data() + bb, ae - ab, nt))
                 {
-                    root = pystring::slice(p, 0, dotIndex);
-                    ext = pystring::slice(p, dotIndex);
-                    return;
+                    ++k;
                 }
+                common = k;
+            }
 
-                filenameIndex += 1;
+            // Size the result, then write it: the drive and root of the first path and its
+            // first common names
+            char sep = nt ? '\\' : '/';
+            std::size_t size = drive + root, b, e;
+            Names names(first, drive, nt);
+            for(std::size_t k = 0; k < common && names.next(b, e); ++k) size += e - b + (k > 0 ? 1 : 0);
+
+            std::string result;
+            result.reserve(size);
+            result.append(first, 0, drive);
+            result.append(root, sep);
+            names = Names(first, drive, nt);
+            for(std::size_t k = 0; k < common && names.next(b, e); ++k)
+            {
+                if(k > 0) result += sep;
+                result.append(first, b, e - b);
             }
+            return result;
+        }
+    }
+
+    std::string relpath_nt(const std::string & path, const std::string & start, const std::string & cwd)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.relpath_nt", path );
+        return PYSTRING_STATS_RETURN( relpath_generic(path, start, cwd, true) );
+    }
+
+    std::string relpath_posix(const std::string & path, const std::string & start, const std::string & cwd)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.relpath_posix", path );
+        return PYSTRING_STATS_RETURN( relpath_generic(path, start, cwd, false) );
+    }
+
+    std::string relpath(const std::string & path, const std::string & start, const std::string & cwd)
+    {
+#ifdef WINDOWS
+        return relpath_nt(path, start, cwd);
+#else
+        return relpath_posix(path, start, cwd);
+#endif
+    }
+
+    std::string commonpath_nt(const std::vector< std::string > & paths)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.commonpath_nt", paths );
+        return PYSTRING_STATS_RETURN( commonpath_generic(paths, true) );
+    }
+
+    std::string commonpath_posix(const std::vector< std::string > & paths)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.commonpath_posix", paths );
+        return PYSTRING_STATS_RETURN( commonpath_generic(paths, false) );
+    }
+
+    std::string commonpath(const std::vector< std::string > & paths)
+    {
+#ifdef WINDOWS
+        return commonpath_nt(paths);
+#else
+        return commonpath_posix(paths);
+#endif
+    }
+
+    // The prefix shared by all the paths is the shortest prefix the first one shares with any
+    std::string commonprefix_posix(const std::vector< std::string > & paths)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.commonprefix", paths );
+        if(paths.empty()) return PYSTRING_STATS_RETURN( empty_string );
+
+        const std::string & first = paths[0];
+        std::size_t n = first.size();
+        for(std::size_t i = 1; i < paths.size() && n > 0; ++i)
+        {
+            n = simd::kernels().mismatch(first.data(), paths[i].data(), std::min(n, paths[i].size()));
         }
+        return PYSTRING_STATS_RETURN( first.substr(0, n) );
+    }
 
-        root = p;
-        ext = empty_string;
+    // commonprefix() does not look at separators, so it is the same everywhere
+    std::string commonprefix_nt(const std::vector< std::string > & paths)
+    {
+        return commonprefix_posix(paths);
     }
 
+    std::string commonprefix(const std::vector< std::string > & paths)
+    {
+        return commonprefix_posix(paths);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+
+    // Split the extension from a pathname.
+    // Extension is everything from the last dot to the end, ignoring
+    // leading dots.  Returns "(root, ext)"; ext may be empty.
+    // It is always true that root + ext == p
+
     void splitext_nt(std::string & root, std::string & ext, const std::string & path)
     {
-        return splitext_generic(root, ext, path,
-                                double_back_slash, forward_slash, dot);
+        PYSTRING_STATS_SCOPE( "os.path.splitext_nt", path );
+        std::size_t dot = splitext_offset(path.data(), path.size(), true);
+        assign_parts(root, ext, path, dot, dot);
+        PYSTRING_STATS_RESULT( root, ext );
     }
 
     void splitext_posix(std::string & root, std::string & ext, const std::string & path)
     {
-        return splitext_generic(root, ext, path,
-                                forward_slash, empty_string, dot);
+        PYSTRING_STATS_SCOPE( "os.path.splitext_posix", path );
+        std::size_t dot = splitext_offset(path.data(), path.size(), false);
+        assign_parts(root, ext, path, dot, dot);
+        PYSTRING_STATS_RESULT( root, ext );
     }
 
     void splitext(std::string & root, std::string & ext, const std::string & path)
@@ -1663,6 +2296,33 @@ namespace path
 #endif
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    void splitext_view_nt(std::string_view & root, std::string_view & ext, std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.splitext_view_nt", path );
+        std::size_t dot = splitext_offset(path.data(), path.size(), true);
+        root = path.substr(0, dot);
+        ext = path.substr(dot);
+    }
+
+    void splitext_view_posix(std::string_view & root, std::string_view & ext, std::string_view path)
+    {
+        PYSTRING_STATS_SCOPE( "os.path.splitext_view_posix", path );
+        std::size_t dot = splitext_offset(path.data(), path.size(), false);
+        root = path.substr(0, dot);
+        ext = path.substr(dot);
+    }
+
+    void splitext_view(std::string_view & root, std::string_view & ext, std::string_view path)
+    {
+#ifdef WINDOWS
+        return splitext_view_nt(root, ext, path);
+#else
+        return splitext_view_posix(root, ext, path);
+#endif
+    }
+#endif
+
 } // namespace path
 } // namespace os
 
@@ -9,6 +9,13 @@
 #include <string>
 #include <vector>
 
+// The string_view based interfaces need C++17. They are compiled in when the
+// compiler provides it; everything else still builds as C++11.
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define PYSTRING_HAVE_CXX17
+#include <string_view>
+#endif
+
 namespace pystring
 {
 
@@ -34,6 +41,12 @@ namespace pystring
     ///
     std::string capitalize( const std::string & str );
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a casefolded copy of the string, for caseless matching. On bytes this is the
+    /// same as lower(); pystring::utf8::casefold also folds the rest of Unicode.
+    ///
+    std::string casefold( const std::string & str );
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Return centered in a string of length width. Padding is done using spaces.
     ///
@@ -69,6 +82,16 @@ namespace pystring
     ///
     int index( const std::string & str, const std::string & sub, int start = 0, int end = MAX_32BIT_INT  );
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Case insensitive versions of count, endswith, find and startswith, and of str ==
+    /// other. Case is folded on the fly, ASCII letters only, without copying either string.
+    ///
+    int icount( const std::string & str, const std::string & substr, int start = 0, int end = MAX_32BIT_INT);
+    bool iendswith( const std::string & str, const std::string & suffix, int start = 0, int end = MAX_32BIT_INT );
+    bool iequals( const std::string & str, const std::string & other );
+    int ifind( const std::string & str, const std::string & sub, int start = 0, int end = MAX_32BIT_INT  );
+    bool istartswith( const std::string & str, const std::string & prefix, int start = 0, int end = MAX_32BIT_INT );
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Return true if all characters in the string are alphanumeric and there is at least one
     /// character, false otherwise.
@@ -157,6 +180,25 @@ namespace pystring
         return result;
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief The three parts of a string split by partition_view() or rpartition_view(). They
+    /// are views into the string, so they stay valid only as long as its buffer, and can be
+    /// unpacked with a structured binding: auto [key, eq, value] = partition_view( line, "=" );
+    ///
+    struct Partition
+    {
+        std::string_view head;
+        std::string_view sep;
+        std::string_view tail;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as partition(), without copying or allocating anything.
+    ///
+    Partition partition_view( std::string_view str, std::string_view sep );
+#endif
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief If str starts with prefix return a copy of the string with prefix at the start
     /// removed otherwise return an unmodified copy of the string.
@@ -208,6 +250,13 @@ namespace pystring
         return result;
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as rpartition(), without copying or allocating anything.
+    ///
+    Partition rpartition_view( std::string_view str, std::string_view sep );
+#endif
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Return a copy of the string with trailing characters removed. If chars is "", whitespace
     /// characters are removed. If not "", the characters in the string will be stripped from the
@@ -218,7 +267,8 @@ namespace pystring
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Fills the "result" list with the words in the string, using sep as the delimiter string.
     /// If maxsplit is > -1, at most maxsplit splits are done. If sep is "",
-    /// any whitespace string is a separator.
+    /// any whitespace string is a separator. The strings already in result are reused, so
+    /// splitting into the same vector again only allocates for words that outgrow them.
     ///
     void split( const std::string & str, std::vector< std::string > & result, const std::string & sep = "", int maxsplit = -1);
     inline std::vector< std::string > split( const std::string & str, const std::string & sep = "", int maxsplit = -1)
@@ -228,12 +278,22 @@ namespace pystring
         return result;
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as split(), but the words are views into str instead of copies, and stay
+    /// valid only as long as the buffer behind str. Splitting into the same result again does
+    /// not allocate once it has grown to the number of words.
+    ///
+    void split( std::string_view str, std::vector< std::string_view > & result, std::string_view sep = std::string_view(), int maxsplit = -1 );
+#endif
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Fills the "result" list with the words in the string, using sep as the delimiter string.
     /// Does a number of splits starting at the end of the string, the result still has the
     /// split strings in their original order.
     /// If maxsplit is > -1, at most maxsplit splits are done. If sep is "",
-    /// any whitespace string is a separator.
+    /// any whitespace string is a separator. As with split(), the strings already in result
+    /// are reused.
     ///
     void rsplit( const std::string & str, std::vector< std::string > & result, const std::string & sep = "", int maxsplit = -1);
     inline std::vector< std::string > rsplit( const std::string & str, const std::string & sep = "", int maxsplit = -1)
@@ -243,6 +303,14 @@ namespace pystring
         return result;
     }
 
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as rsplit(), but the words are views into str instead of copies, like the
+    /// string_view split().
+    ///
+    void rsplit( std::string_view str, std::vector< std::string_view > & result, std::string_view sep = std::string_view(), int maxsplit = -1 );
+#endif
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Return a list of the lines in the string, breaking at line boundaries. Line breaks
     /// are not included in the resulting list unless keepends is given and true.
@@ -389,6 +457,79 @@ namespace path
     std::string join_nt(const std::vector< std::string > & paths);
     std::string join_posix(const std::vector< std::string > & paths);
 
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A component given to join_append() or to join() with more than two components:
+    /// a std::string, a C string or, with C++17, a std::string_view. It only points at the
+    /// characters, which are copied once, straight into the result.
+
+    struct JoinPart
+    {
+        JoinPart(const std::string & str) : data(str.data()), size(str.size()) {}
+        JoinPart(const char * str) : data(str), size(std::char_traits< char >::length(str)) {}
+#ifdef PYSTRING_HAVE_CXX17
+        JoinPart(std::string_view str) : data(str.data()), size(str.size()) {}
+#endif
+
+        const char * data;
+        std::size_t size;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as join(), appending the joined path to result instead of returning it, so
+    /// that a buffer can be reused from one join to the next. Whatever result held before is
+    /// left alone. The components before the last absolute one are skipped without being
+    /// looked at, and result grows at most once.
+
+    void join_append(std::string & result, const JoinPart * parts, std::size_t count);
+    void join_append_nt(std::string & result, const JoinPart * parts, std::size_t count);
+    void join_append_posix(std::string & result, const JoinPart * parts, std::size_t count);
+
+    template< typename... Paths >
+    void join_append(std::string & result, const JoinPart & first, const Paths &... rest)
+    {
+        const JoinPart parts[] = { first, JoinPart(rest)... };
+        join_append(result, parts, 1 + sizeof...(rest));
+    }
+
+    template< typename... Paths >
+    void join_append_nt(std::string & result, const JoinPart & first, const Paths &... rest)
+    {
+        const JoinPart parts[] = { first, JoinPart(rest)... };
+        join_append_nt(result, parts, 1 + sizeof...(rest));
+    }
+
+    template< typename... Paths >
+    void join_append_posix(std::string & result, const JoinPart & first, const Paths &... rest)
+    {
+        const JoinPart parts[] = { first, JoinPart(rest)... };
+        join_append_posix(result, parts, 1 + sizeof...(rest));
+    }
+
+    /// join(a, b, c, ...) of any number of components, without building a vector of them.
+    template< typename A, typename B, typename... Paths >
+    std::string join(const A & a, const B & b, const Paths &... rest)
+    {
+        std::string result;
+        join_append(result, a, b, rest...);
+        return result;
+    }
+
+    template< typename A, typename B, typename... Paths >
+    std::string join_nt(const A & a, const B & b, const Paths &... rest)
+    {
+        std::string result;
+        join_append_nt(result, a, b, rest...);
+        return result;
+    }
+
+    template< typename A, typename B, typename... Paths >
+    std::string join_posix(const A & a, const B & b, const Paths &... rest)
+    {
+        std::string result;
+        join_append_posix(result, a, b, rest...);
+        return result;
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Normalize a pathname. This collapses redundant separators and up-level references
     /// so that A//B, A/B/, A/./B and A/foo/../B all become A/B. It does not normalize the case
@@ -400,6 +541,44 @@ namespace path
     std::string normpath_nt(const std::string & path);
     std::string normpath_posix(const std::string & path);
 
+    /// These normalize a temporary in place, in the buffer it already has.
+    std::string normpath(std::string && path);
+    std::string normpath_nt(std::string && path);
+    std::string normpath_posix(std::string && path);
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a relative filepath to path from the start directory. This is a path
+    /// computation: the filesystem is not accessed to confirm the existence or nature of path
+    /// or start. Both are made absolute against cwd, as abspath() does, and normalized.
+    ///
+    /// NOTE: Where python raises ValueError, for an empty path or, on Windows, for path and
+    /// start on different drives, this returns an empty string.
+
+    std::string relpath(const std::string & path, const std::string & start, const std::string & cwd);
+    std::string relpath_nt(const std::string & path, const std::string & start, const std::string & cwd);
+    std::string relpath_posix(const std::string & path, const std::string & start, const std::string & cwd);
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the longest common sub-path of each pathname in paths. Unlike
+    /// commonprefix(), this returns a valid path: names are only compared whole, and redundant
+    /// separators and "." are left out of the result. On Windows names are compared without
+    /// regard to ascii case, and the result keeps the case of the first path.
+    ///
+    /// NOTE: Where python raises ValueError, for no paths, a mix of absolute and relative
+    /// paths or, on Windows, paths on different drives, this returns an empty string.
+
+    std::string commonpath(const std::vector< std::string > & paths);
+    std::string commonpath_nt(const std::vector< std::string > & paths);
+    std::string commonpath_posix(const std::vector< std::string > & paths);
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the longest string that is a prefix of all strings in paths, compared
+    /// character by character, so it may not be a valid path. Empty if paths is empty.
+
+    std::string commonprefix(const std::vector< std::string > & paths);
+    std::string commonprefix_nt(const std::vector< std::string > & paths);
+    std::string commonprefix_posix(const std::vector< std::string > & paths);
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /// @brief Split the pathname path into a pair, (head, tail) where tail is the last pathname
     /// component and head is everything leading up to that. The tail part will never contain a
@@ -431,6 +610,33 @@ namespace path
     void splitext(std::string & root, std::string & ext, const std::string & path);
     void splitext_nt(std::string & root, std::string & ext, const std::string & path);
     void splitext_posix(std::string & root, std::string & ext, const std::string & path);
+
+#ifdef PYSTRING_HAVE_CXX17
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as basename(), dirname(), split(), splitdrive() and splitext(), returning
+    /// views into path rather than copies. They never allocate, and the views stay valid only
+    /// as long as the buffer of path.
+
+    std::string_view basename_view(std::string_view path);
+    std::string_view basename_view_nt(std::string_view path);
+    std::string_view basename_view_posix(std::string_view path);
+
+    std::string_view dirname_view(std::string_view path);
+    std::string_view dirname_view_nt(std::string_view path);
+    std::string_view dirname_view_posix(std::string_view path);
+
+    void split_view(std::string_view & head, std::string_view & tail, std::string_view path);
+    void split_view_nt(std::string_view & head, std::string_view & tail, std::string_view path);
+    void split_view_posix(std::string_view & head, std::string_view & tail, std::string_view path);
+
+    void splitdrive_view(std::string_view & drivespec, std::string_view & pathspec, std::string_view path);
+    void splitdrive_view_nt(std::string_view & drivespec, std::string_view & pathspec, std::string_view path);
+    void splitdrive_view_posix(std::string_view & drivespec, std::string_view & pathspec, std::string_view path);
+
+    void splitext_view(std::string_view & root, std::string_view & ext, std::string_view path);
+    void splitext_view_nt(std::string_view & root, std::string_view & ext, std::string_view path);
+    void splitext_view_posix(std::string_view & root, std::string_view & ext, std::string_view path);
+#endif
     
     ///
     /// @ }
@@ -0,0 +1,207 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_cachemap.h"
+#include "pystring_fs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+namespace detail
+{
+
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+    }
+
+    template< typename T >
+    struct CacheMap< T >::Shard
+    {
+        struct Value
+        {
+            T value;
+            Clock::time_point stamp;
+            std::size_t slot;
+            bool referenced;
+        };
+
+        typedef std::unordered_map< std::string, Value > Table;
+
+        Shard() : hand( 0 ), hits( 0 ), misses( 0 ), expired( 0 ), evictions( 0 ) {}
+
+        // Entries in CLOCK order, each entry knowing its slot so that it can be erased from
+        // the middle of the ring. Pointers to the elements of an unordered_map stay valid until
+        // the element is erased.
+        void erase( typename Table::iterator it )
+        {
+            std::size_t slot = it->second.slot;
+            ring[slot] = ring.back();
+            ring[slot]->second.slot = slot;
+            ring.pop_back();
+            table.erase( it );
+        }
+
+        std::mutex mutex;
+        Table table;
+        std::vector< typename Table::value_type * > ring;
+        std::size_t hand;
+        unsigned long long hits, misses, expired, evictions;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    template< typename T >
+    CacheMap< T >::CacheMap( double ttl, std::size_t max_entries, unsigned int shards ) :
+        m_shards( shards ? shards : 1 ), m_shard_entries( std::max< std::size_t >( 1, max_entries / ( shards ? shards : 1 ) ) ),
+        m_ttl( ttl )
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i ) m_shards[i] = new Shard();
+    }
+
+    template< typename T >
+    CacheMap< T >::~CacheMap()
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i ) delete m_shards[i];
+    }
+
+    template< typename T >
+    typename CacheMap< T >::Shard & CacheMap< T >::shard( const std::string & key ) const
+    {
+        return *m_shards[std::hash< std::string >()( key ) % m_shards.size()];
+    }
+
+    template< typename T >
+    bool CacheMap< T >::lookup( const std::string & key, T & value )
+    {
+        Shard & shard = this->shard( key );
+        std::lock_guard< std::mutex > lock( shard.mutex );
+        typename Shard::Table::iterator it = shard.table.find( key );
+        if ( it == shard.table.end() )
+        {
+            ++shard.misses;
+            return false;
+        }
+
+        // An expired entry stays where it is until store() refreshes it
+        if ( m_ttl > 0.0 && std::chrono::duration< double >( Clock::now() - it->second.stamp ).count() > m_ttl )
+        {
+            ++shard.expired;
+            ++shard.misses;
+            return false;
+        }
+
+        ++shard.hits;
+        it->second.referenced = true;
+        value = it->second.value;
+        return true;
+    }
+
+    template< typename T >
+    void CacheMap< T >::store( const std::string & key, const T & value )
+    {
+        Shard & shard = this->shard( key );
+        std::lock_guard< std::mutex > lock( shard.mutex );
+
+        typename Shard::Table::iterator it = shard.table.find( key );
+        if ( it != shard.table.end() )
+        {
+            it->second.value = value;
+            it->second.stamp = Clock::now();
+            return;
+        }
+
+        while ( shard.ring.size() >= m_shard_entries )
+        {
+            if ( shard.hand >= shard.ring.size() ) shard.hand = 0;
+            typename Shard::Table::value_type * entry = shard.ring[shard.hand];
+            if ( entry->second.referenced )
+            {
+                entry->second.referenced = false;
+                ++shard.hand;
+                continue;
+            }
+            shard.erase( shard.table.find( entry->first ) );
+            ++shard.evictions;
+        }
+
+        typename Shard::Value entry = { value, Clock::now(), shard.ring.size(), false };
+        shard.ring.push_back( &*shard.table.insert( typename Shard::Table::value_type( key, entry ) ).first );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    template< typename T >
+    void CacheMap< T >::erase( const std::string & key )
+    {
+        Shard & shard = this->shard( key );
+        std::lock_guard< std::mutex > lock( shard.mutex );
+        typename Shard::Table::iterator it = shard.table.find( key );
+        if ( it != shard.table.end() ) shard.erase( it );
+    }
+
+    template< typename T >
+    void CacheMap< T >::erase_if( const std::function< bool ( const std::string & key ) > & predicate )
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i )
+        {
+            Shard & shard = *m_shards[i];
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            for ( typename Shard::Table::iterator it = shard.table.begin(); it != shard.table.end(); )
+            {
+                if ( predicate( it->first ) ) shard.erase( it++ );
+                else ++it;
+            }
+        }
+    }
+
+    template< typename T >
+    CacheStats CacheMap< T >::stats() const
+    {
+        CacheStats total = { 0, 0, 0, 0, 0 };
+        for ( std::size_t i = 0; i < m_shards.size(); ++i )
+        {
+            Shard & shard = *m_shards[i];
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.expired += shard.expired;
+            total.evictions += shard.evictions;
+            total.entries += shard.ring.size();
+        }
+        return total;
+    }
+
+    template< typename T >
+    void CacheMap< T >::clear()
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i )
+        {
+            Shard & shard = *m_shards[i];
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            shard.table.clear();
+            shard.ring.clear();
+            shard.hand = 0;
+            shard.hits = shard.misses = shard.expired = shard.evictions = 0;
+        }
+    }
+
+    template class CacheMap< StatResult >;
+    template class CacheMap< std::string >;
+
+} // namespace detail
+} // namespace path
+} // namespace os
+} // namespace pystring
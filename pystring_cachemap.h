@@ -0,0 +1,74 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_CACHEMAP_H
+#define INCLUDED_PYSTRING_CACHEMAP_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief The counters of StatCache and RealpathCache. An expired entry counts as a miss
+    /// too.
+    ///
+    struct CacheStats
+    {
+        unsigned long long hits, misses, expired, evictions;
+        std::size_t entries;
+    };
+
+    // Implementation details of StatCache and RealpathCache
+    namespace detail
+    {
+        // A bounded map from paths to values, split into shards picked by the hash of the key,
+        // each with its own lock. When a shard is over its share of max_entries, entries are
+        // evicted in CLOCK order, as NormCache evicts them. An entry older than ttl seconds is
+        // a miss until it is stored again; a ttl of 0 keeps entries until they are erased or
+        // evicted. Instantiated for the values of the caches only.
+        template< typename T >
+        class CacheMap
+        {
+        public:
+            CacheMap( double ttl, std::size_t max_entries, unsigned int shards );
+            ~CacheMap();
+
+            bool lookup( const std::string & key, T & value );
+            void store( const std::string & key, const T & value );
+
+            // erase_if() goes through every entry of every shard
+            void erase( const std::string & key );
+            void erase_if( const std::function< bool ( const std::string & key ) > & predicate );
+
+            CacheStats stats() const;
+            void clear();
+
+        private:
+            CacheMap( const CacheMap & );
+            CacheMap & operator=( const CacheMap & );
+
+            struct Shard;
+
+            Shard & shard( const std::string & key ) const;
+
+            std::vector< Shard * > m_shards;
+            std::size_t m_shard_entries;
+            double m_ttl;
+        };
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
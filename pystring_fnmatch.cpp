@@ -0,0 +1,293 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_fnmatch.h"
+#include "pystring_simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace pystring
+{
+namespace fnmatch
+{
+
+    namespace
+    {
+        const std::uint16_t ANY = 256;
+        const std::uint16_t SET = 257;
+
+        // Names matched on one thread; below that, starting a thread costs more than it saves.
+        const std::size_t MIN_BATCH = 16384;
+
+        char fold( char c )
+        {
+            if ( c == '/' ) return '\\';
+            return c >= 'A' && c <= 'Z' ? (char) ( c - 'A' + 'a' ) : c;
+        }
+
+        // The set of "[" pattern[begin, end) "]", cut into ranges the way python's
+        // fnmatch.translate() cuts it: the chunks between the hyphens are separated by ranges,
+        // and a range whose first character comes after its last is dropped with its hyphen.
+        std::bitset< 256 > parse_set( const std::string & pattern, std::size_t begin, std::size_t end )
+        {
+            std::vector< std::string > chunks;
+            std::size_t start = begin;
+            std::size_t k = pattern[begin] == '!' ? begin + 2 : begin + 1;
+            while ( k < end )
+            {
+                k = pattern.find( '-', k );
+                if ( k == std::string::npos || k >= end ) break;
+                chunks.push_back( pattern.substr( start, k - start ) );
+                start = k + 1;
+                k += 3;
+            }
+            if ( start < end ) chunks.push_back( pattern.substr( start, end - start ) );
+            else chunks.back() += '-';
+
+            for ( std::size_t i = chunks.size() - 1; i > 0; --i )
+            {
+                if ( !chunks[i - 1].empty() && (unsigned char) chunks[i - 1].back() > (unsigned char) chunks[i][0] )
+                {
+                    chunks[i - 1].erase( chunks[i - 1].size() - 1 );
+                    chunks[i - 1].append( chunks[i], 1, std::string::npos );
+                    chunks.erase( chunks.begin() + (std::ptrdiff_t) i );
+                }
+            }
+
+            std::bitset< 256 > set;
+            bool negate = !chunks[0].empty() && chunks[0][0] == '!';
+            std::size_t last = chunks.size() - 1;
+            for ( std::size_t i = 0; i <= last; ++i )
+            {
+                const std::string & chunk = chunks[i];
+                std::size_t first = i == 0 ? ( negate ? 1 : 0 ) : 1;
+                std::size_t stop = i < last ? chunk.size() - 1 : chunk.size();
+                for ( std::size_t j = first; j < stop; ++j ) set.set( (unsigned char) chunk[j] );
+
+                if ( i > 0 )
+                {
+                    unsigned int lo = (unsigned char) chunks[i - 1].back(), hi = (unsigned char) chunk[0];
+                    for ( unsigned int c = lo; c <= hi; ++c ) set.set( c );
+                }
+            }
+            return negate ? ~set : set;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    Pattern::Pattern( const std::string & pattern, bool normcase ) : m_pattern( pattern ), m_normcase( normcase ), m_star( false )
+    {
+        std::string pat = pattern;
+        if ( normcase ) std::transform( pat.begin(), pat.end(), pat.begin(), fold );
+
+        Segment segment = { 0, 0, true };
+        m_segments.push_back( segment );
+
+        std::size_t i = 0, n = pat.size();
+        while ( i < n )
+        {
+            char c = pat[i++];
+            if ( c == '*' )
+            {
+                while ( i < n && pat[i] == '*' ) ++i;
+                m_star = true;
+                segment.begin = segment.end = m_tokens.size();
+                m_segments.push_back( segment );
+            }
+            else if ( c == '?' )
+            {
+                add( ANY, c );
+            }
+            else if ( c == '[' )
+            {
+                std::size_t j = i;
+                if ( j < n && pat[j] == '!' ) ++j;
+                if ( j < n && pat[j] == ']' ) ++j;
+                while ( j < n && pat[j] != ']' ) ++j;
+
+                if ( j >= n )
+                {
+                    add( (unsigned char) c, c );
+                }
+                else
+                {
+                    m_sets.push_back( parse_set( pat, i, j ) );
+                    add( (std::uint16_t) ( SET + m_sets.size() - 1 ), c );
+                    i = j + 1;
+                }
+            }
+            else
+            {
+                add( (unsigned char) c, c );
+            }
+        }
+    }
+
+    void Pattern::add( std::uint16_t token, char c )
+    {
+        m_tokens.push_back( token );
+        m_text.push_back( c );
+
+        Segment & segment = m_segments.back();
+        segment.end = m_tokens.size();
+        if ( token >= ANY ) segment.literal = false;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    bool Pattern::match_at( const Segment & segment, const char * s ) const
+    {
+        if ( segment.literal )
+        {
+            return std::memcmp( s, m_text.data() + segment.begin, segment.end - segment.begin ) == 0;
+        }
+
+        for ( std::size_t i = segment.begin; i < segment.end; ++i, ++s )
+        {
+            std::uint16_t token = m_tokens[i];
+            unsigned char c = (unsigned char) *s;
+            if ( token < ANY ? c != token : token > ANY && !m_sets[token - SET].test( c ) ) return false;
+        }
+        return true;
+    }
+
+    std::size_t Pattern::search( const Segment & segment, const char * s, std::size_t n ) const
+    {
+        std::size_t m = segment.end - segment.begin;
+        if ( m > n ) return std::string::npos;
+
+        if ( segment.literal )
+        {
+            std::size_t i = simd::kernels().find( s, n, m_text.data() + segment.begin, m );
+            return i == n ? std::string::npos : i;
+        }
+
+        for ( std::size_t i = 0; i + m <= n; ++i )
+        {
+            if ( match_at( segment, s + i ) ) return i;
+        }
+        return std::string::npos;
+    }
+
+    bool Pattern::match_case( const char * s, std::size_t n ) const
+    {
+        const Segment & first = m_segments.front();
+        std::size_t head = first.end - first.begin;
+        if ( !m_star ) return n == head && match_at( first, s );
+
+        const Segment & last = m_segments.back();
+        std::size_t tail = last.end - last.begin;
+        if ( head + tail > n ) return false;
+        if ( !match_at( first, s ) || !match_at( last, s + n - tail ) ) return false;
+
+        // A star on either side of a segment lets it match anywhere in between, and the
+        // leftmost place leaves the most room to the segments after it.
+        std::size_t pos = head, end = n - tail;
+        for ( std::size_t i = 1; i + 1 < m_segments.size(); ++i )
+        {
+            std::size_t found = search( m_segments[i], s + pos, end - pos );
+            if ( found == std::string::npos ) return false;
+            pos += found + m_segments[i].end - m_segments[i].begin;
+        }
+        return true;
+    }
+
+    bool Pattern::match( const char * s, std::size_t n ) const
+    {
+        if ( !m_normcase ) return match_case( s, n );
+
+        thread_local std::string folded;
+        folded.assign( s, n );
+        std::transform( folded.begin(), folded.end(), folded.begin(), fold );
+        return match_case( folded.data(), n );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    namespace
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        const bool NORMCASE = true;
+#else
+        const bool NORMCASE = false;
+#endif
+
+        const Pattern & compiled( const std::string & pattern, bool normcase )
+        {
+            thread_local Pattern last( "" );
+            if ( last.pattern() != pattern || last.normcase() != normcase ) last = Pattern( pattern, normcase );
+            return last;
+        }
+    }
+
+    bool fnmatch( const std::string & name, const std::string & pattern )
+    {
+        return compiled( pattern, NORMCASE ).match( name );
+    }
+
+    bool fnmatchcase( const std::string & name, const std::string & pattern )
+    {
+        return compiled( pattern, false ).match( name );
+    }
+
+    void filter( const std::vector< std::string > & names, const std::string & pattern,
+                 std::vector< std::string > & result )
+    {
+        result.clear();
+        const Pattern & compiled_pattern = compiled( pattern, NORMCASE );
+        for ( std::size_t i = 0; i < names.size(); ++i )
+        {
+            if ( compiled_pattern.match( names[i] ) ) result.push_back( names[i] );
+        }
+    }
+
+    void filter( const std::vector< std::string > & names, const Pattern & pattern,
+                 std::vector< std::size_t > & result, unsigned int threads )
+    {
+        result.clear();
+        std::size_t n = names.size();
+
+        if ( threads == 0 ) threads = std::max( 1u, std::thread::hardware_concurrency() );
+        threads = (unsigned int) std::min< std::size_t >( threads, ( n + MIN_BATCH - 1 ) / MIN_BATCH );
+
+        if ( threads <= 1 )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( pattern.match( names[i] ) ) result.push_back( i );
+            }
+            return;
+        }
+
+        // Each thread keeps the indices of its own slice, which are then appended in order
+        std::vector< std::vector< std::size_t > > found( threads );
+        auto run = [&]( unsigned int t )
+        {
+            std::size_t begin = n * t / threads, end = n * ( t + 1 ) / threads;
+            for ( std::size_t i = begin; i < end; ++i )
+            {
+                if ( pattern.match( names[i] ) ) found[t].push_back( i );
+            }
+        };
+
+        std::vector< std::thread > workers;
+        for ( unsigned int t = 1; t < threads; ++t ) workers.emplace_back( run, t );
+        run( 0 );
+        for ( std::size_t t = 0; t < workers.size(); ++t ) workers[t].join();
+
+        std::size_t total = 0;
+        for ( std::size_t t = 0; t < found.size(); ++t ) total += found[t].size();
+        result.reserve( total );
+        for ( std::size_t t = 0; t < found.size(); ++t ) result.insert( result.end(), found[t].begin(), found[t].end() );
+    }
+
+} // namespace fnmatch
+} // namespace pystring
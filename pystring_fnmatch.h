@@ -0,0 +1,123 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_FNMATCH_H
+#define INCLUDED_PYSTRING_FNMATCH_H
+
+#include "pystring.h"
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace fnmatch
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup fnmatch pystring::fnmatch
+    /// @{
+    ///
+    /// Unix shell-style wildcards, as python's fnmatch module matches them: "*" matches
+    /// everything, "?" any single character, "[seq]" any character in seq and "[!seq]" any
+    /// character not in seq, where seq may hold ranges such as "a-z". None of them treat "/"
+    /// specially. A "[" without a closing "]" is an ordinary character, and there is no escape
+    /// character: "[*]" matches a literal "*". Characters are bytes.
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A pattern compiled once, to match any number of names.
+    ///
+    /// The pattern is cut at its stars into segments of characters, "?" and sets. A name
+    /// matches when the first segment matches at its start, the last at its end and the ones
+    /// in between in order, each at the first place it is found. Nothing is ever retried, so a
+    /// match takes time linear in the name for literal segments, which are compared with
+    /// memcmp() and searched with the vectorized find of pystring::simd; patterns such as
+    /// "*.exr", "shot_*" or "*/publish/*" come down to a prefix, suffix or substring check.
+    ///
+    /// With normcase, names and pattern are compared as os.path.normcase() leaves them on
+    /// Windows: ASCII letters in lowercase and "/" as "\". A Pattern may be used by any number
+    /// of threads at the same time.
+    ///
+    class Pattern
+    {
+    public:
+        explicit Pattern( const std::string & pattern, bool normcase = false );
+
+        bool match( const char * s, std::size_t n ) const;
+        bool match( const std::string & name ) const { return match( name.data(), name.size() ); }
+#ifdef PYSTRING_HAVE_CXX17
+        bool match( std::string_view name ) const { return match( name.data(), name.size() ); }
+#endif
+
+        const std::string & pattern() const { return m_pattern; }
+        bool normcase() const { return m_normcase; }
+
+    private:
+        struct Segment
+        {
+            std::size_t begin, end;
+            bool literal;
+        };
+
+        void add( std::uint16_t token, char c );
+        bool match_case( const char * s, std::size_t n ) const;
+        bool match_at( const Segment & segment, const char * s ) const;
+        std::size_t search( const Segment & segment, const char * s, std::size_t n ) const;
+
+        std::string m_pattern;
+        bool m_normcase;
+
+        // Each token is a character below 256, ANY for "?" or SET + the index of its set.
+        // m_text holds the character of every token, so literal segments are plain strings.
+        std::vector< std::uint16_t > m_tokens;
+        std::string m_text;
+        std::vector< std::bitset< 256 > > m_sets;
+        std::vector< Segment > m_segments;
+        bool m_star;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if name matches pattern. Both are first normalized with normcase()
+    /// on Windows, and compared as they are elsewhere. The last pattern compiled by the thread
+    /// is kept, so a loop over many names with one pattern compiles it only once.
+    ///
+    bool fnmatch( const std::string & name, const std::string & pattern );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Same as fnmatch(), always case sensitive.
+    ///
+    bool fnmatchcase( const std::string & name, const std::string & pattern );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the names that match pattern, as fnmatch() matches them.
+    ///
+    void filter( const std::vector< std::string > & names, const std::string & pattern,
+                 std::vector< std::string > & result );
+    inline std::vector< std::string > filter( const std::vector< std::string > & names, const std::string & pattern )
+    {
+        std::vector< std::string > result;
+        filter( names, pattern, result );
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Store in result the indices of the names that match a compiled pattern, in
+    /// order. Big lists are split between up to threads threads, 0 meaning one per core; a
+    /// thread is only started for each 16384 names or more.
+    ///
+    void filter( const std::vector< std::string > & names, const Pattern & pattern,
+                 std::vector< std::size_t > & result, unsigned int threads = 0 );
+
+    ///
+    /// @ }
+    ///
+
+} // namespace fnmatch
+} // namespace pystring
+
+#endif
@@ -0,0 +1,506 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_fs.h"
+#include "pystring_fnmatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace pystring
+{
+namespace os
+{
+
+    namespace
+    {
+        // Bytes of directory records read per system call. NFS returns as many entries as
+        // fit, so a bigger buffer means fewer round trips to the server.
+        const std::size_t READ_SIZE = 1 << 16;
+
+        // What each thread reuses from one directory to the next
+        struct Scratch
+        {
+            Scratch() : records( READ_SIZE ) {}
+
+            std::vector< char > records;
+            std::string path;
+            std::vector< std::string > dirnames, filenames, links;
+        };
+
+        bool is_dots( const char * name )
+        {
+            return name[0] == '.' && ( name[1] == 0 || ( name[1] == '.' && name[2] == 0 ) );
+        }
+
+#ifdef _WIN32
+
+        DirEntry::Type stat_type( const std::string & path, bool follow_symlinks )
+        {
+            DWORD attributes = GetFileAttributesA( path.c_str() );
+            if ( attributes == INVALID_FILE_ATTRIBUTES ) return DirEntry::OTHER;
+            if ( !follow_symlinks && ( attributes & FILE_ATTRIBUTE_REPARSE_POINT ) ) return DirEntry::SYMLINK;
+            return attributes & FILE_ATTRIBUTE_DIRECTORY ? DirEntry::DIRECTORY : DirEntry::REGULAR;
+        }
+
+        bool stat_path( const std::string & path, StatResult & result, int )
+        {
+            WIN32_FILE_ATTRIBUTE_DATA data;
+            if ( !GetFileAttributesExA( path.c_str(), GetFileExInfoStandard, &data ) ) return false;
+
+            // FILETIME counts 100ns ticks from 1601
+            ULARGE_INTEGER ticks;
+            ticks.LowPart = data.ftLastWriteTime.dwLowDateTime;
+            ticks.HighPart = data.ftLastWriteTime.dwHighDateTime;
+            result.exists = true;
+            result.type = data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? DirEntry::DIRECTORY : DirEntry::REGULAR;
+            result.size = ( (std::uint64_t) data.nFileSizeHigh << 32 ) | data.nFileSizeLow;
+            result.mtime = (double) ticks.QuadPart * 1e-7 - 11644473600.0;
+            return true;
+        }
+
+        // Calls visit( name, size, type, inode ) for each entry of the directory path
+        template< typename Visit >
+        bool read_directory( const std::string & path, Scratch & scratch, Visit visit )
+        {
+            scratch.path.assign( path );
+            scratch.path.append( "\\*" );
+
+            WIN32_FIND_DATAA data;
+            HANDLE find = FindFirstFileExA( scratch.path.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, 0,
+                                            FIND_FIRST_EX_LARGE_FETCH );
+            if ( find == INVALID_HANDLE_VALUE ) return false;
+
+            do
+            {
+                if ( is_dots( data.cFileName ) ) continue;
+
+                DirEntry::Type type = DirEntry::REGULAR;
+                if ( ( data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ) && data.dwReserved0 == IO_REPARSE_TAG_SYMLINK )
+                {
+                    type = DirEntry::SYMLINK;
+                }
+                else if ( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+                {
+                    type = DirEntry::DIRECTORY;
+                }
+                visit( data.cFileName, std::strlen( data.cFileName ), type, (std::uint64_t) 0 );
+            }
+            while ( FindNextFileA( find, &data ) );
+
+            bool complete = GetLastError() == ERROR_NO_MORE_FILES;
+            FindClose( find );
+            return complete;
+        }
+
+#else
+
+        DirEntry::Type mode_type( mode_t mode )
+        {
+            if ( S_ISREG( mode ) ) return DirEntry::REGULAR;
+            if ( S_ISDIR( mode ) ) return DirEntry::DIRECTORY;
+            if ( S_ISLNK( mode ) ) return DirEntry::SYMLINK;
+            return DirEntry::OTHER;
+        }
+
+        DirEntry::Type stat_type( const std::string & path, bool follow_symlinks )
+        {
+            struct stat st;
+            int status = follow_symlinks ? ::stat( path.c_str(), &st ) : ::lstat( path.c_str(), &st );
+            return status == 0 ? mode_type( st.st_mode ) : DirEntry::OTHER;
+        }
+
+        bool stat_path( const std::string & path, StatResult & result, int fields )
+        {
+#if defined(__linux__) && defined(STATX_TYPE)
+            // statx() only asks for the fields wanted; kernels or sandboxes without it get stat()
+            unsigned int mask = ( fields & StatResult::TYPE ? STATX_TYPE : 0u ) | ( fields & StatResult::SIZE ? STATX_SIZE : 0u ) |
+                                ( fields & StatResult::MTIME ? STATX_MTIME : 0u );
+            struct statx stx;
+            if ( ::statx( AT_FDCWD, path.c_str(), AT_STATX_SYNC_AS_STAT, mask, &stx ) == 0 )
+            {
+                result.exists = true;
+                result.type = mode_type( stx.stx_mode );
+                result.size = stx.stx_size;
+                result.mtime = (double) stx.stx_mtime.tv_sec + (double) stx.stx_mtime.tv_nsec * 1e-9;
+                return true;
+            }
+            if ( errno != ENOSYS && errno != EPERM ) return false;
+#else
+            (void) fields;
+#endif
+
+            struct stat st;
+            if ( ::stat( path.c_str(), &st ) != 0 ) return false;
+            result.exists = true;
+            result.type = mode_type( st.st_mode );
+            result.size = (std::uint64_t) st.st_size;
+#if defined(__APPLE__)
+            result.mtime = (double) st.st_mtimespec.tv_sec + (double) st.st_mtimespec.tv_nsec * 1e-9;
+#else
+            result.mtime = (double) st.st_mtim.tv_sec + (double) st.st_mtim.tv_nsec * 1e-9;
+#endif
+            return true;
+        }
+
+        // The type a directory record reports, or the one lstat() finds when it does not
+        DirEntry::Type record_type( int fd, const char * name, unsigned char type )
+        {
+            switch ( type )
+            {
+                case DT_REG: return DirEntry::REGULAR;
+                case DT_DIR: return DirEntry::DIRECTORY;
+                case DT_LNK: return DirEntry::SYMLINK;
+                case DT_UNKNOWN: break;
+                default: return DirEntry::OTHER;
+            }
+
+            struct stat st;
+            return ::fstatat( fd, name, &st, AT_SYMLINK_NOFOLLOW ) == 0 ? mode_type( st.st_mode ) : DirEntry::OTHER;
+        }
+
+#ifdef __linux__
+
+        // Calls visit( name, size, type, inode ) for each entry of the directory path. The
+        // records getdents64 fills the buffer with are, from their start: the 64 bit inode,
+        // a 64 bit offset, the 16 bit record length, the type byte and the NUL terminated name.
+        template< typename Visit >
+        bool read_directory( const std::string & path, Scratch & scratch, Visit visit )
+        {
+            int fd = ::open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+            if ( fd < 0 ) return false;
+
+            bool complete = true;
+            for ( ;; )
+            {
+                long got = ::syscall( SYS_getdents64, fd, &scratch.records[0], scratch.records.size() );
+                if ( got <= 0 )
+                {
+                    complete = got == 0;
+                    break;
+                }
+
+                for ( long offset = 0; offset < got; )
+                {
+                    const char * record = &scratch.records[(std::size_t) offset];
+                    std::uint64_t inode;
+                    unsigned short length;
+                    std::memcpy( &inode, record, sizeof( inode ) );
+                    std::memcpy( &length, record + 16, sizeof( length ) );
+                    offset += length;
+
+                    const char * name = record + 19;
+                    if ( is_dots( name ) ) continue;
+                    visit( name, std::strlen( name ), record_type( fd, name, (unsigned char) record[18] ), inode );
+                }
+            }
+
+            ::close( fd );
+            return complete;
+        }
+
+#else
+
+        template< typename Visit >
+        bool read_directory( const std::string & path, Scratch &, Visit visit )
+        {
+            DIR * dir = ::opendir( path.c_str() );
+            if ( !dir ) return false;
+
+            while ( struct dirent * entry = ::readdir( dir ) )
+            {
+                if ( is_dots( entry->d_name ) ) continue;
+                DirEntry::Type type = record_type( ::dirfd( dir ), entry->d_name, entry->d_type );
+                visit( entry->d_name, std::strlen( entry->d_name ), type, (std::uint64_t) entry->d_ino );
+            }
+
+            ::closedir( dir );
+            return true;
+        }
+
+#endif
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    bool DirEntry::is_dir( bool follow_symlinks ) const
+    {
+        if ( type != SYMLINK || !follow_symlinks ) return type == DIRECTORY;
+        return stat_type( path, true ) == DIRECTORY;
+    }
+
+    bool DirEntry::is_file( bool follow_symlinks ) const
+    {
+        if ( type != SYMLINK || !follow_symlinks ) return type == REGULAR;
+        return stat_type( path, true ) == REGULAR;
+    }
+
+    bool stat( const std::string & path, StatResult & result, int fields )
+    {
+        StatResult missing = { false, DirEntry::OTHER, 0, 0.0 };
+        result = missing;
+        if ( stat_path( path, result, fields ) ) return true;
+        result = missing;
+        return false;
+    }
+
+    bool scandir( const std::string & path, std::vector< DirEntry > & result )
+    {
+        result.clear();
+        Scratch scratch;
+        bool complete = read_directory( path, scratch,
+            [&]( const char * name, std::size_t size, DirEntry::Type type, std::uint64_t inode )
+            {
+                DirEntry entry;
+                entry.name.assign( name, size );
+                os::path::join_append( entry.path, path, entry.name );
+                entry.type = type;
+                entry.inode = inode;
+                result.push_back( std::move( entry ) );
+            } );
+
+        if ( !complete ) result.clear();
+        return complete;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    namespace
+    {
+        class Walker
+        {
+        public:
+            Walker( const WalkCallback & callback, const WalkOptions & options ) :
+                m_callback( callback ), m_options( options ), m_active( 0 ), m_errors( 0 )
+            {
+#ifdef _WIN32
+                const bool normcase = true;
+#else
+                const bool normcase = false;
+#endif
+                for ( std::size_t i = 0; i < options.prune.size(); ++i ) m_prune.push_back( fnmatch::Pattern( options.prune[i], normcase ) );
+            }
+
+            std::size_t run( const std::string & top )
+            {
+                m_tasks.push_back( Task( top, 0 ) );
+
+                unsigned int threads = m_options.threads;
+                if ( threads == 0 ) threads = std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+
+                std::vector< std::thread > workers;
+                for ( unsigned int i = 1; i < threads; ++i ) workers.push_back( std::thread( &Walker::work, this ) );
+                work();
+                for ( std::size_t i = 0; i < workers.size(); ++i ) workers[i].join();
+                return m_errors;
+            }
+
+        private:
+            // A directory waiting, bottom up, for the ones it holds; pending counts them and
+            // the directory itself until it has been read
+            struct Dir
+            {
+                std::string path;
+                Dir * parent;
+                std::atomic< std::size_t > pending;
+                std::vector< std::string > dirnames, filenames;
+            };
+
+            struct Task
+            {
+                Task( const std::string & task_path, Dir * task_parent ) : path( task_path ), parent( task_parent ) {}
+
+                std::string path;
+                Dir * parent;
+            };
+
+            // Directories to read are taken from the end, so that with one thread the tree is
+            // walked depth first, in the order of the names
+            void work()
+            {
+                Scratch scratch;
+                std::vector< Task > children;
+
+                std::unique_lock< std::mutex > lock( m_mutex );
+                for ( ;; )
+                {
+                    while ( m_tasks.empty() && m_active > 0 ) m_wake.wait( lock );
+                    if ( m_tasks.empty() ) break;
+
+                    Task task = std::move( m_tasks.back() );
+                    m_tasks.pop_back();
+                    ++m_active;
+                    lock.unlock();
+
+                    children.clear();
+                    visit( task, scratch, children );
+
+                    lock.lock();
+                    --m_active;
+                    for ( std::size_t i = children.size(); i > 0; --i ) m_tasks.push_back( std::move( children[i - 1] ) );
+                    if ( !children.empty() || m_active == 0 ) m_wake.notify_all();
+                }
+            }
+
+            void visit( const Task & task, Scratch & scratch, std::vector< Task > & children )
+            {
+                Dir * dir = 0;
+                if ( !m_options.topdown )
+                {
+                    dir = new Dir;
+                    dir->path = task.path;
+                    dir->parent = task.parent;
+                    dir->pending = 1;
+                }
+                std::vector< std::string > & dirnames = dir ? dir->dirnames : scratch.dirnames;
+                std::vector< std::string > & filenames = dir ? dir->filenames : scratch.filenames;
+                dirnames.clear();
+                filenames.clear();
+                scratch.links.clear();
+
+                bool complete = read_directory( task.path, scratch,
+                    [&]( const char * name, std::size_t size, DirEntry::Type type, std::uint64_t )
+                    {
+                        if ( type == DirEntry::SYMLINK )
+                        {
+                            scratch.path.clear();
+                            os::path::join_append( scratch.path, task.path, name );
+                            if ( stat_type( scratch.path, true ) == DirEntry::DIRECTORY ) type = DirEntry::DIRECTORY;
+                            if ( type == DirEntry::DIRECTORY ) scratch.links.push_back( std::string( name, size ) );
+                        }
+                        ( type == DirEntry::DIRECTORY ? dirnames : filenames ).push_back( std::string( name, size ) );
+                    } );
+
+                if ( !complete )
+                {
+                    ++m_errors;
+                    delete dir;
+                    done( task.parent );
+                    return;
+                }
+
+                if ( !m_prune.empty() )
+                {
+                    dirnames.erase( std::remove_if( dirnames.begin(), dirnames.end(), [this]( const std::string & name ) { return pruned( name ); } ),
+                                    dirnames.end() );
+                }
+
+                if ( !dir ) m_callback( task.path, dirnames, filenames );
+
+                for ( std::size_t i = 0; i < dirnames.size(); ++i )
+                {
+                    if ( !m_options.followlinks && !scratch.links.empty() &&
+                         std::find( scratch.links.begin(), scratch.links.end(), dirnames[i] ) != scratch.links.end() ) continue;
+
+                    Task child( std::string(), dir );
+                    os::path::join_append( child.path, task.path, dirnames[i] );
+                    children.push_back( std::move( child ) );
+                }
+
+                if ( dir )
+                {
+                    dir->pending += children.size();
+                    done( dir );
+                }
+            }
+
+            bool pruned( const std::string & name ) const
+            {
+                for ( std::size_t i = 0; i < m_prune.size(); ++i )
+                {
+                    if ( m_prune[i].match( name ) ) return true;
+                }
+                return false;
+            }
+
+            // One thing dir was waiting for is done; when it was the last, the directory is
+            // given to the callback and its parent has one less to wait for
+            void done( Dir * dir )
+            {
+                while ( dir && dir->pending.fetch_sub( 1 ) == 1 )
+                {
+                    m_callback( dir->path, dir->dirnames, dir->filenames );
+                    Dir * parent = dir->parent;
+                    delete dir;
+                    dir = parent;
+                }
+            }
+
+            const WalkCallback & m_callback;
+            const WalkOptions & m_options;
+            std::vector< fnmatch::Pattern > m_prune;
+
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+            std::vector< Task > m_tasks;
+            std::size_t m_active;
+            std::atomic< std::size_t > m_errors;
+        };
+    }
+
+    std::size_t walk( const std::string & top, const WalkCallback & callback, const WalkOptions & options )
+    {
+        Walker walker( callback, options );
+        return walker.run( top );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    bool path::exists( const std::string & path )
+    {
+        StatResult result;
+        return os::stat( path, result, StatResult::TYPE );
+    }
+
+    bool path::isdir( const std::string & path )
+    {
+        StatResult result;
+        return os::stat( path, result, StatResult::TYPE ) && result.type == DirEntry::DIRECTORY;
+    }
+
+    bool path::isfile( const std::string & path )
+    {
+        StatResult result;
+        return os::stat( path, result, StatResult::TYPE ) && result.type == DirEntry::REGULAR;
+    }
+
+    long long path::getsize( const std::string & path )
+    {
+        StatResult result;
+        return os::stat( path, result, StatResult::SIZE ) ? (long long) result.size : -1;
+    }
+
+    double path::getmtime( const std::string & path )
+    {
+        StatResult result;
+        return os::stat( path, result, StatResult::MTIME ) ? result.mtime : -1.0;
+    }
+
+} // namespace os
+} // namespace pystring
@@ -0,0 +1,166 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_FS_H
+#define INCLUDED_PYSTRING_FS_H
+
+#include "pystring.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup fs pystring::os
+    /// @{
+    ///
+    /// The directory traversal of python's os module and the file queries of os.path, over
+    /// the local filesystem. These, os::path::realpath() and the caches of StatCache and
+    /// RealpathCache are the only parts of pystring that access the filesystem.
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief An entry of a directory, as scandir() returns it. type is the type the directory
+    /// itself reports, which most filesystems store with the name, so that it costs no stat()
+    /// call; an lstat() is only made for the entries of filesystems that do not. As in python,
+    /// is_dir() and is_file() follow symbolic links unless told not to, which takes a stat().
+    ///
+    struct DirEntry
+    {
+        enum Type
+        {
+            OTHER,
+            REGULAR,
+            DIRECTORY,
+            SYMLINK
+        };
+
+        std::string name;
+        std::string path;
+        Type type;
+        std::uint64_t inode;
+
+        bool is_dir( bool follow_symlinks = true ) const;
+        bool is_file( bool follow_symlinks = true ) const;
+        bool is_symlink() const { return type == SYMLINK; }
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief What stat() finds out about a path. A path that does not exist, or that cannot be
+    /// looked up, has exists false, type OTHER and size and mtime 0. mtime is in seconds since
+    /// the epoch, as python's os.path.getmtime() returns it.
+    ///
+    struct StatResult
+    {
+        enum Fields
+        {
+            TYPE = 1 << 0,
+            SIZE = 1 << 1,
+            MTIME = 1 << 2,
+            ALL = TYPE | SIZE | MTIME
+        };
+
+        bool exists;
+        DirEntry::Type type;
+        std::uint64_t size;
+        double mtime;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Look path up, following symbolic links as os.stat() does, and return
+    /// result.exists. Only the fields asked for are guaranteed to be filled in; on Linux they
+    /// are the only ones statx() asks the filesystem for, which network filesystems can
+    /// sometimes answer from what they already know.
+    ///
+    bool stat( const std::string & path, StatResult & result, int fields = StatResult::ALL );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Store the entries of the directory path in result, in the order the directory
+    /// lists them, without "." and "..". The path of each entry is join() of path and its name.
+    /// Return false, with result empty, if the directory cannot be read.
+    ///
+    bool scandir( const std::string & path, std::vector< DirEntry > & result );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief How walk() goes through a tree.
+    ///
+    /// topdown and followlinks are the arguments of python's os.walk(). Directories whose name
+    /// matches one of the prune patterns, as fnmatch::fnmatch() matches it, are left out of the
+    /// directory names and not entered. threads is the number of threads reading directories,
+    /// 0 meaning twice the number of cores, as most of the time is spent waiting on the
+    /// filesystem.
+    ///
+    struct WalkOptions
+    {
+        WalkOptions() : topdown( true ), followlinks( false ), threads( 0 ) {}
+
+        bool topdown;
+        bool followlinks;
+        unsigned int threads;
+        std::vector< std::string > prune;
+    };
+
+    typedef std::function< void ( const std::string & dirpath, std::vector< std::string > & dirnames,
+                                  std::vector< std::string > & filenames ) > WalkCallback;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Call callback with the path of each directory of the tree under top, top
+    /// included, and the names of the directories and of the other entries it holds, as
+    /// python's os.walk() yields them. Return the number of directories that could not be
+    /// read, which are skipped as os.walk() skips them by default.
+    ///
+    /// Topdown, a directory is given to the callback before the ones it holds, and the
+    /// callback may remove names from dirnames to keep walk() out of them. Bottom up, it is
+    /// given after all of them.
+    ///
+    /// Directories are read by options.threads threads, the calling one included, and the
+    /// callback is called on all of them, possibly at the same time: it has to be thread safe.
+    /// The order is then only kept within each branch of the tree. With one thread, the
+    /// directories come in the order os.walk() yields them.
+    ///
+    /// Symbolic links to directories are listed in dirnames, and only entered with
+    /// followlinks. As in python, a link to one of its parents is then entered again until
+    /// the system refuses to resolve the path.
+    ///
+    std::size_t walk( const std::string & top, const WalkCallback & callback,
+                      const WalkOptions & options = WalkOptions() );
+
+namespace path
+{
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if path refers to an existing path, an existing directory or an
+    /// existing regular file, following symbolic links. A broken symbolic link does not
+    /// exist.
+    ///
+    bool exists( const std::string & path );
+    bool isdir( const std::string & path );
+    bool isfile( const std::string & path );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the size in bytes and the time of last modification, in seconds since the
+    /// epoch, of path.
+    ///
+    /// NOTE: Where python raises OSError, for a path that does not exist or cannot be looked
+    /// up, these return -1.
+    ///
+    long long getsize( const std::string & path );
+    double getmtime( const std::string & path );
+
+} // namespace path
+
+    ///
+    /// @ }
+    ///
+
+} // namespace os
+} // namespace pystring
+
+#endif
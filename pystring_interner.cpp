@@ -0,0 +1,309 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_interner.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace pystring
+{
+
+    namespace
+    {
+        // Ids are the index of the string in its shard, followed by the shard number
+        const int SHARD_BITS = 4;
+        const std::uint32_t SHARDS = 1u << SHARD_BITS;
+        const std::uint32_t MAX_PER_SHARD = ( 1u << ( 32 - SHARD_BITS ) ) - 1;
+
+        // Entries live in chunks of 256, 512, 1024... entries, so that they never move once added
+        // and readers can look them up while the shard grows
+        const int FIRST_CHUNK_BITS = 8;
+        const int MAX_CHUNKS = 32 - SHARD_BITS - FIRST_CHUNK_BITS + 1;
+
+        // Strings are copied into blocks of this size; longer ones get a block of their own
+        const std::size_t BLOCK_SIZE = 1 << 16;
+
+        const std::size_t FIRST_CAPACITY = 1024;
+
+        struct Entry
+        {
+            const char * data;
+            std::uint32_t size;
+            std::uint32_t hash;
+        };
+
+        // Open addressing index of a shard. A slot holds the low 32 bits of the hash of the
+        // string above the index of its entry plus one, or 0 while it is empty. The table is
+        // never more than half full, so a probe always ends.
+        struct Table
+        {
+            explicit Table( std::size_t capacity ) :
+                mask( capacity - 1 ), slots( new std::atomic< std::uint64_t >[capacity] )
+            {
+                for ( std::size_t i = 0; i < capacity; ++i ) slots[i].store( 0, std::memory_order_relaxed );
+            }
+
+            ~Table() { delete[] slots; }
+
+            void insert( std::uint32_t hash, std::uint32_t index )
+            {
+                std::size_t i = hash & mask;
+                while ( slots[i].load( std::memory_order_relaxed ) ) i = ( i + 1 ) & mask;
+                slots[i].store( ( (std::uint64_t) hash << 32 ) | ( index + 1 ), std::memory_order_release );
+            }
+
+            std::size_t mask;
+            std::atomic< std::uint64_t > * slots;
+
+        private:
+            Table( const Table & );
+            Table & operator=( const Table & );
+        };
+
+        int highest_bit( std::uint32_t x )
+        {
+#if defined(__GNUC__)
+            return 31 - __builtin_clz( x );
+#else
+            int bit = 0;
+            while ( x >>= 1 ) ++bit;
+            return bit;
+#endif
+        }
+
+        // 64 bit multiply and fold over 8 bytes at a time
+        std::uint64_t hash_bytes( const char * s, std::size_t n )
+        {
+            const std::uint64_t m = 0x9e3779b97f4a7c15ull;
+            std::uint64_t h = n * m, k;
+            for ( ; n >= 8; s += 8, n -= 8 )
+            {
+                std::memcpy( &k, s, 8 );
+                h = ( h ^ k ) * m;
+                h ^= h >> 29;
+            }
+            for ( k = 0; n > 0; --n ) k = ( k << 8 ) | (unsigned char) s[n - 1];
+            h = ( h ^ k ) * m;
+            h ^= h >> 32;
+            h *= 0xff51afd7ed558ccdull;
+            return h ^ ( h >> 33 );
+        }
+    }
+
+    struct Interner::Shard
+    {
+        Shard() : table( new Table( FIRST_CAPACITY ) ), count( 0 ), bytes( FIRST_CAPACITY * 8 ), block( 0 ), left( 0 )
+        {
+            for ( int k = 0; k < MAX_CHUNKS; ++k ) chunks[k] = 0;
+        }
+
+        ~Shard()
+        {
+            delete table.load();
+            for ( std::size_t i = 0; i < retired.size(); ++i ) delete retired[i];
+            for ( int k = 0; k < MAX_CHUNKS; ++k ) delete[] chunks[k];
+            for ( std::size_t i = 0; i < blocks.size(); ++i ) delete[] blocks[i];
+        }
+
+        const Entry & entry( std::uint32_t index ) const
+        {
+            int k = highest_bit( ( index >> FIRST_CHUNK_BITS ) + 1 );
+            return chunks[k][index - ( ( ( 1u << k ) - 1 ) << FIRST_CHUNK_BITS )];
+        }
+
+        std::uint32_t find( const char * s, std::size_t n, std::uint32_t hash ) const
+        {
+            const Table * t = table.load( std::memory_order_acquire );
+            for ( std::size_t i = hash & t->mask; ; i = ( i + 1 ) & t->mask )
+            {
+                std::uint64_t slot = t->slots[i].load( std::memory_order_acquire );
+                if ( slot == 0 ) return NONE;
+                if ( (std::uint32_t) ( slot >> 32 ) != hash ) continue;
+
+                std::uint32_t index = (std::uint32_t) slot - 1;
+                const Entry & e = entry( index );
+                if ( e.size == n && std::memcmp( e.data, s, n ) == 0 ) return index;
+            }
+        }
+
+        // Called with the lock held, for a string that is not in the shard yet
+        std::uint32_t add( const char * s, std::size_t n, std::uint32_t hash )
+        {
+            std::uint32_t index = count.load( std::memory_order_relaxed );
+            if ( index >= MAX_PER_SHARD ) return NONE;
+
+            int k = highest_bit( ( index >> FIRST_CHUNK_BITS ) + 1 );
+            if ( !chunks[k] )
+            {
+                std::size_t size = (std::size_t) 1 << ( k + FIRST_CHUNK_BITS );
+                chunks[k] = new Entry[size];
+                bytes.fetch_add( size * sizeof( Entry ), std::memory_order_relaxed );
+            }
+
+            Entry & e = chunks[k][index - ( ( ( 1u << k ) - 1 ) << FIRST_CHUNK_BITS )];
+            e.data = copy( s, n );
+            e.size = (std::uint32_t) n;
+            e.hash = hash;
+
+            Table * t = table.load( std::memory_order_relaxed );
+            if ( ( index + 1 ) * 2 > t->mask + 1 )
+            {
+                // Readers may still be probing the old table, so it is kept until the end
+                Table * bigger = new Table( ( t->mask + 1 ) * 2 );
+                for ( std::uint32_t i = 0; i < index; ++i ) bigger->insert( entry( i ).hash, i );
+                bytes.fetch_add( ( bigger->mask + 1 ) * 8, std::memory_order_relaxed );
+                retired.push_back( t );
+                table.store( bigger, std::memory_order_release );
+                t = bigger;
+            }
+
+            t->insert( hash, index );
+            count.store( index + 1, std::memory_order_release );
+            return index;
+        }
+
+        const char * copy( const char * s, std::size_t n )
+        {
+            char * data;
+            if ( n + 1 > BLOCK_SIZE / 4 )
+            {
+                data = new char[n + 1];
+                blocks.push_back( data );
+                bytes.fetch_add( n + 1, std::memory_order_relaxed );
+            }
+            else
+            {
+                if ( left < n + 1 )
+                {
+                    block = new char[BLOCK_SIZE];
+                    left = BLOCK_SIZE;
+                    blocks.push_back( block );
+                    bytes.fetch_add( BLOCK_SIZE, std::memory_order_relaxed );
+                }
+                data = block;
+                block += n + 1;
+                left -= n + 1;
+            }
+            std::memcpy( data, s, n );
+            data[n] = '\0';
+            return data;
+        }
+
+        std::mutex mutex;
+        std::atomic< Table * > table;
+        std::vector< Table * > retired;
+        Entry * chunks[MAX_CHUNKS];
+        std::atomic< std::uint32_t > count;
+        std::atomic< std::size_t > bytes;
+        std::vector< char * > blocks;
+        char * block;
+        std::size_t left;
+    };
+
+    const Interner::Id Interner::NONE;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    Interner::Interner() : m_shards( new Shard[SHARDS] )
+    {
+    }
+
+    Interner::~Interner()
+    {
+        delete[] m_shards;
+    }
+
+    Interner::Id Interner::intern( const char * s, std::size_t n )
+    {
+        std::uint64_t h = hash_bytes( s, n );
+        std::uint32_t shard = (std::uint32_t) ( h >> ( 64 - SHARD_BITS ) ), hash = (std::uint32_t) h;
+        Shard & sh = m_shards[shard];
+
+        std::uint32_t index = sh.find( s, n, hash );
+        if ( index == NONE )
+        {
+            std::lock_guard< std::mutex > lock( sh.mutex );
+
+            // Another thread may have added it meanwhile
+            index = sh.find( s, n, hash );
+            if ( index == NONE ) index = sh.add( s, n, hash );
+            if ( index == NONE ) return NONE;
+        }
+        return ( index << SHARD_BITS ) | shard;
+    }
+
+    Interner::Id Interner::find( const char * s, std::size_t n ) const
+    {
+        std::uint64_t h = hash_bytes( s, n );
+        std::uint32_t shard = (std::uint32_t) ( h >> ( 64 - SHARD_BITS ) );
+        std::uint32_t index = m_shards[shard].find( s, n, (std::uint32_t) h );
+        return index == NONE ? NONE : ( index << SHARD_BITS ) | shard;
+    }
+
+    const char * Interner::c_str( Id id ) const
+    {
+        return m_shards[id & ( SHARDS - 1 )].entry( id >> SHARD_BITS ).data;
+    }
+
+    std::size_t Interner::length( Id id ) const
+    {
+        return m_shards[id & ( SHARDS - 1 )].entry( id >> SHARD_BITS ).size;
+    }
+
+    std::size_t Interner::size() const
+    {
+        std::size_t total = 0;
+        for ( std::uint32_t i = 0; i < SHARDS; ++i ) total += m_shards[i].count.load( std::memory_order_relaxed );
+        return total;
+    }
+
+    std::size_t Interner::bytes() const
+    {
+        std::size_t total = 0;
+        for ( std::uint32_t i = 0; i < SHARDS; ++i ) total += m_shards[i].bytes.load( std::memory_order_relaxed );
+        return total;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void split( Interner & interner, const std::string & str, std::vector< Interner::Id > & result,
+                const std::string & sep, int maxsplit )
+    {
+        // The words go through a scratch vector of the thread, which split() reuses
+#ifdef PYSTRING_HAVE_CXX17
+        thread_local std::vector< std::string_view > words;
+#else
+        thread_local std::vector< std::string > words;
+#endif
+        pystring::split( str, words, sep, maxsplit );
+
+        result.resize( words.size() );
+        for ( std::size_t i = 0; i < words.size(); ++i ) result[i] = interner.intern( words[i] );
+    }
+
+namespace os
+{
+namespace path
+{
+
+    void split( Interner & interner, Interner::Id & head, Interner::Id & tail, const std::string & path )
+    {
+#ifdef PYSTRING_HAVE_CXX17
+        std::string_view h, t;
+        os::path::split_view( h, t, path );
+#else
+        thread_local std::string h, t;
+        os::path::split( h, t, path );
+#endif
+        head = interner.intern( h );
+        tail = interner.intern( t );
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
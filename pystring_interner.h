@@ -0,0 +1,102 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_INTERNER_H
+#define INCLUDED_PYSTRING_INTERNER_H
+
+#include "pystring.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A table of unique strings. intern() stores one copy of each distinct string and
+    /// returns a 32 bit id for it, the same id for equal strings, so that strings can be kept as
+    /// ids and compared with an integer compare. The stored strings are NUL terminated, never
+    /// move and are only freed with the Interner, so c_str() and view() stay valid as long as it
+    /// lives.
+    ///
+    /// The table is split into shards by hash. find() and the lookup part of intern() do not
+    /// take any lock; intern() takes the lock of one shard only to add a new string. Any number
+    /// of threads may use an Interner at the same time.
+    ///
+    class Interner
+    {
+    public:
+        typedef std::uint32_t Id;
+
+        /// The id find() returns for a string that has not been interned.
+        static const Id NONE = 0xffffffffu;
+
+        Interner();
+        ~Interner();
+
+        Id intern( const char * s, std::size_t n );
+        Id intern( const char * str ) { return intern( str, std::strlen( str ) ); }
+        Id intern( const std::string & str ) { return intern( str.data(), str.size() ); }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the id of a string if it has been interned, NONE otherwise. A string
+        /// being interned by another thread at the same time may or may not be found.
+        ///
+        Id find( const char * s, std::size_t n ) const;
+        Id find( const char * str ) const { return find( str, std::strlen( str ) ); }
+        Id find( const std::string & str ) const { return find( str.data(), str.size() ); }
+
+#ifdef PYSTRING_HAVE_CXX17
+        Id intern( std::string_view str ) { return intern( str.data(), str.size() ); }
+        Id find( std::string_view str ) const { return find( str.data(), str.size() ); }
+        std::string_view view( Id id ) const { return std::string_view( c_str( id ), length( id ) ); }
+#endif
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the string of an id returned by intern().
+        ///
+        const char * c_str( Id id ) const;
+        std::size_t length( Id id ) const;
+        std::string str( Id id ) const { return std::string( c_str( id ), length( id ) ); }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the number of distinct strings, and the bytes allocated to hold them and
+        /// their index.
+        ///
+        std::size_t size() const;
+        std::size_t bytes() const;
+
+    private:
+        Interner( const Interner & );
+        Interner & operator=( const Interner & );
+
+        struct Shard;
+        Shard * m_shards;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief split() straight into interned ids: the words of str, as split() returns them,
+    /// are interned and their ids stored in result.
+    ///
+    void split( Interner & interner, const std::string & str, std::vector< Interner::Id > & result,
+                const std::string & sep = "", int maxsplit = -1 );
+
+namespace os
+{
+namespace path
+{
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief os::path::split() straight into interned ids for head and tail.
+    ///
+    void split( Interner & interner, Interner::Id & head, Interner::Id & tail, const std::string & path );
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
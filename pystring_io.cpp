@@ -0,0 +1,597 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_io.h"
+#include "pystring_simd.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pystring
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    ReplaceFilter::ReplaceFilter( const std::string & oldstr, const std::string & newstr, int count ) :
+        m_old( oldstr ), m_new( newstr ), m_count( count )
+    {
+    }
+
+    void ReplaceFilter::write( const char * data, std::size_t size, std::string & out )
+    {
+        std::size_t n = m_old.size();
+
+        // An empty oldstr matches in front of every character, and once more at the end
+        if ( n == 0 )
+        {
+            for ( std::size_t i = 0; i < size; ++i )
+            {
+                if ( m_count != 0 )
+                {
+                    out += m_new;
+                    if ( m_count > 0 ) --m_count;
+                }
+                out += data[i];
+            }
+            return;
+        }
+
+        if ( m_carry.empty() )
+        {
+            scan( data, size, out );
+            return;
+        }
+
+        // Too little input to settle the carried bytes, so just hold on to more of them
+        if ( size < n )
+        {
+            m_buffer = m_carry;
+            m_buffer.append( data, size );
+            m_carry.clear();
+            scan( m_buffer.data(), m_buffer.size(), out );
+            return;
+        }
+
+        // Every suffix of the carry that is a prefix of oldstr may be completed by data. The
+        // longest one starts leftmost, so it wins.
+        std::size_t carried = m_carry.size(), offset = 0;
+        bool matched = false;
+
+        for ( std::size_t s = 0; s < carried && !matched; ++s )
+        {
+            std::size_t k = carried - s;
+            if ( std::memcmp( m_carry.data() + s, m_old.data(), k ) == 0 &&
+                 std::memcmp( data, m_old.data() + k, n - k ) == 0 )
+            {
+                out.append( m_carry, 0, s );
+                out += m_new;
+                if ( m_count > 0 ) --m_count;
+                offset = n - k;
+                matched = true;
+            }
+        }
+
+        if ( !matched ) out += m_carry;
+        m_carry.clear();
+
+        scan( data + offset, size - offset, out );
+    }
+
+    void ReplaceFilter::scan( const char * data, std::size_t size, std::string & out )
+    {
+        std::size_t n = m_old.size(), i = 0, last = 0;
+        const char * old = m_old.data();
+
+        while ( m_count != 0 && i + n <= size )
+        {
+            const void * hit = std::memchr( data + i, old[0], size - n + 1 - i );
+            if ( !hit ) break;
+
+            i = (std::size_t) ( static_cast< const char * >( hit ) - data );
+            if ( std::memcmp( data + i, old, n ) == 0 )
+            {
+                out.append( data + last, i - last );
+                out += m_new;
+                if ( m_count > 0 ) --m_count;
+                i = last = i + n;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        // Hold back the longest tail that could still turn into a match
+        std::size_t keep = 0;
+        if ( m_count != 0 )
+        {
+            keep = std::min( n - 1, size - last );
+            while ( keep > 0 && std::memcmp( data + size - keep, old, keep ) != 0 ) --keep;
+        }
+
+        out.append( data + last, size - last - keep );
+        m_carry.assign( data + size - keep, keep );
+    }
+
+    void ReplaceFilter::finish( std::string & out )
+    {
+        out += m_carry;
+        m_carry.clear();
+
+        if ( m_old.empty() && m_count != 0 )
+        {
+            out += m_new;
+            if ( m_count > 0 ) --m_count;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    TranslateFilter::TranslateFilter( const std::string & table, const std::string & deletechars ) :
+        m_valid( table.size() == 256 )
+    {
+        if ( !m_valid ) return;
+
+        for ( int i = 0; i < 256; i++ )
+        {
+            m_table[i] = (unsigned char) table[i];
+        }
+
+        for ( std::string::size_type i = 0; i < deletechars.size(); i++ )
+        {
+            m_table[(unsigned char) deletechars[i]] = -1;
+        }
+    }
+
+    void TranslateFilter::write( const char * data, std::size_t size, std::string & out )
+    {
+        if ( !m_valid )
+        {
+            out.append( data, size );
+            return;
+        }
+
+        for ( std::size_t i = 0; i < size; ++i )
+        {
+            int c = m_table[(unsigned char) data[i]];
+            if ( c != -1 ) out += (char) c;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void ExpandTabsFilter::write( const char * data, std::size_t size, std::string & out )
+    {
+        for ( std::size_t i = 0; i < size; ++i )
+        {
+            if ( data[i] == '\t' )
+            {
+                if ( m_tabsize > 0 )
+                {
+                    int fillsize = m_tabsize - ( m_column % m_tabsize );
+                    m_column += fillsize;
+                    out.append( (std::size_t) fillsize, ' ' );
+                }
+            }
+            else
+            {
+                m_column++;
+
+                if ( data[i] == '\n' || data[i] == '\r' )
+                {
+                    m_column = 0;
+                }
+                out += data[i];
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void UpperFilter::write( const char * data, std::size_t size, std::string & out )
+    {
+        std::size_t start = out.size();
+        out.append( data, size );
+        simd::kernels().upper( &out[0] + start, size );
+    }
+
+    void LowerFilter::write( const char * data, std::size_t size, std::string & out )
+    {
+        std::size_t start = out.size();
+        out.append( data, size );
+        simd::kernels().lower( &out[0] + start, size );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    FilterPipeline::FilterPipeline( std::ostream & out ) :
+        m_stream( &out ), m_fd( -1 )
+    {
+    }
+
+    FilterPipeline::FilterPipeline( int fd ) :
+        m_stream( 0 ), m_fd( fd )
+    {
+    }
+
+    FilterPipeline & FilterPipeline::add( StreamFilter & filter )
+    {
+        m_filters.push_back( &filter );
+        m_buffers.resize( m_filters.size() );
+        return *this;
+    }
+
+    bool FilterPipeline::write( const char * data, std::size_t size )
+    {
+        return flush( data, size, false );
+    }
+
+    bool FilterPipeline::finish()
+    {
+        return flush( 0, 0, true );
+    }
+
+    // Run data through every filter in turn. With last set, each filter is finished once
+    // everything upstream of it has been flushed into it.
+    bool FilterPipeline::flush( const char * data, std::size_t size, bool last )
+    {
+        for ( std::size_t stage = 0; stage < m_filters.size(); ++stage )
+        {
+            std::string & out = m_buffers[stage];
+            out.clear();
+            if ( size ) m_filters[stage]->write( data, size, out );
+            if ( last ) m_filters[stage]->finish( out );
+            data = out.data();
+            size = out.size();
+        }
+
+        return emit( data, size );
+    }
+
+    bool FilterPipeline::emit( const char * data, std::size_t size )
+    {
+        if ( m_stream )
+        {
+            m_stream->write( data, (std::streamsize) size );
+            return !m_stream->fail();
+        }
+
+        const char * p = data;
+        std::size_t remaining = size;
+        while ( remaining > 0 )
+        {
+#ifdef _WIN32
+            int written = ::_write( m_fd, p, (unsigned int) remaining );
+#else
+            ssize_t written = ::write( m_fd, p, remaining );
+#endif
+            if ( written < 0 ) return false;
+            p += written;
+            remaining -= (std::size_t) written;
+        }
+        return true;
+    }
+
+    bool FilterPipeline::run( std::istream & in, std::size_t chunksize )
+    {
+        std::vector< char > chunk( chunksize ? chunksize : 1 );
+
+        while ( in )
+        {
+            in.read( &chunk[0], (std::streamsize) chunk.size() );
+            std::size_t got = (std::size_t) in.gcount();
+            if ( got && !write( &chunk[0], got ) ) return false;
+        }
+
+        return !in.bad() && finish();
+    }
+
+#ifdef PYSTRING_HAVE_CXX17
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void LineRange::iterator::advance()
+    {
+        const std::string_view & str = m_range->m_str;
+        std::size_t len = str.size(), i = m_pos, eol;
+
+        if ( i >= len )
+        {
+            m_range = 0;
+            return;
+        }
+
+        while ( i < len && str[i] != '\n' && str[i] != '\r' ) i++;
+
+        eol = i;
+        if ( i < len )
+        {
+            if ( str[i] == '\r' && i + 1 < len && str[i+1] == '\n' )
+            {
+                i += 2;
+            }
+            else
+            {
+                i++;
+            }
+            if ( m_range->m_keepends )
+                eol = i;
+        }
+
+        m_line = str.substr( m_pos, eol - m_pos );
+        m_pos = i;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void SplitRange::iterator::advance()
+    {
+        const std::string_view & str = m_range->m_str;
+        const std::string_view & sep = m_range->m_sep;
+        std::size_t len = str.size(), i = m_pos;
+
+        if ( sep.empty() )
+        {
+            while ( i < len && ::isspace( str[i] ) ) i++;
+
+            if ( i >= len )
+            {
+                m_range = 0;
+                return;
+            }
+
+            std::size_t j = i;
+            if ( m_splits-- <= 0 )
+            {
+                i = len;
+            }
+            else
+            {
+                while ( i < len && ! ::isspace( str[i] ) ) i++;
+            }
+
+            m_word = str.substr( j, i - j );
+            m_pos = i;
+            return;
+        }
+
+        // m_pos moves one past the end once the last word has been produced
+        if ( i > len )
+        {
+            m_range = 0;
+            return;
+        }
+
+        std::size_t found = std::string_view::npos;
+        if ( m_splits > 0 )
+        {
+            found = str.find( sep, i );
+        }
+
+        if ( found == std::string_view::npos )
+        {
+            m_word = str.substr( i );
+            m_pos = len + 1;
+        }
+        else
+        {
+            --m_splits;
+            m_word = str.substr( i, found - i );
+            m_pos = found + sep.size();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    MappedFile::MappedFile() :
+        m_data( 0 ), m_size( 0 ), m_open( false )
+#ifdef _WIN32
+        , m_file( 0 ), m_mapping( 0 )
+#endif
+    {
+    }
+
+    MappedFile::MappedFile( const std::string & path, int flags ) :
+        m_data( 0 ), m_size( 0 ), m_open( false )
+#ifdef _WIN32
+        , m_file( 0 ), m_mapping( 0 )
+#endif
+    {
+        open( path, flags );
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile( MappedFile && other ) noexcept :
+        m_data( other.m_data ), m_size( other.m_size ), m_open( other.m_open )
+#ifdef _WIN32
+        , m_file( other.m_file ), m_mapping( other.m_mapping )
+#endif
+    {
+        other.m_data = 0;
+        other.m_size = 0;
+        other.m_open = false;
+#ifdef _WIN32
+        other.m_file = 0;
+        other.m_mapping = 0;
+#endif
+    }
+
+    MappedFile & MappedFile::operator=( MappedFile && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            close();
+            std::swap( m_data, other.m_data );
+            std::swap( m_size, other.m_size );
+            std::swap( m_open, other.m_open );
+#ifdef _WIN32
+            std::swap( m_file, other.m_file );
+            std::swap( m_mapping, other.m_mapping );
+#endif
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+
+    bool MappedFile::open( const std::string & path, int flags )
+    {
+        close();
+
+        HANDLE file = ::CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if ( file == INVALID_HANDLE_VALUE ) return false;
+
+        LARGE_INTEGER size;
+        if ( !::GetFileSizeEx( file, &size ) )
+        {
+            ::CloseHandle( file );
+            return false;
+        }
+
+        m_file = file;
+        m_open = true;
+        if ( size.QuadPart == 0 ) return true;
+
+        HANDLE mapping = ::CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( mapping == NULL )
+        {
+            close();
+            return false;
+        }
+        m_mapping = mapping;
+
+        void * addr = ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        if ( addr == NULL )
+        {
+            close();
+            return false;
+        }
+
+        m_data = static_cast< const char * >( addr );
+        m_size = (std::size_t) size.QuadPart;
+
+        // Large pages are not available for file backed views on Windows
+        if ( flags & PREFETCH ) prefetch( 0, m_size );
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if ( m_data ) ::UnmapViewOfFile( m_data );
+        if ( m_mapping ) ::CloseHandle( (HANDLE) m_mapping );
+        if ( m_file ) ::CloseHandle( (HANDLE) m_file );
+        m_data = 0;
+        m_size = 0;
+        m_open = false;
+        m_file = 0;
+        m_mapping = 0;
+    }
+
+    void MappedFile::prefetch( std::size_t offset, std::size_t length ) const
+    {
+        if ( offset >= m_size ) return;
+        if ( length > m_size - offset ) length = m_size - offset;
+
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = (PVOID) ( m_data + offset );
+        range.NumberOfBytes = length;
+        ::PrefetchVirtualMemory( ::GetCurrentProcess(), 1, &range, 0 );
+    }
+
+#else
+
+    bool MappedFile::open( const std::string & path, int flags )
+    {
+        close();
+
+        int fd = ::open( path.c_str(), O_RDONLY );
+        if ( fd < 0 ) return false;
+
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        // An empty file cannot be mapped, but is a perfectly good empty view
+        if ( st.st_size == 0 )
+        {
+            ::close( fd );
+            m_open = true;
+            return true;
+        }
+
+        void * addr = ::mmap( 0, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( addr == MAP_FAILED ) return false;
+
+        m_data = static_cast< const char * >( addr );
+        m_size = (std::size_t) st.st_size;
+        m_open = true;
+
+        // The advice is only a hint, so failures are ignored
+        ::madvise( addr, m_size, MADV_SEQUENTIAL );
+#ifdef MADV_HUGEPAGE
+        if ( flags & HUGEPAGES ) ::madvise( addr, m_size, MADV_HUGEPAGE );
+#endif
+        if ( flags & PREFETCH ) prefetch( 0, m_size );
+
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if ( m_data ) ::munmap( const_cast< char * >( m_data ), m_size );
+        m_data = 0;
+        m_size = 0;
+        m_open = false;
+    }
+
+    void MappedFile::prefetch( std::size_t offset, std::size_t length ) const
+    {
+        if ( offset >= m_size ) return;
+        if ( length > m_size - offset ) length = m_size - offset;
+
+        // madvise wants a page aligned start address
+        std::size_t page = (std::size_t) ::sysconf( _SC_PAGESIZE );
+        std::size_t aligned = offset - offset % page;
+        ::madvise( const_cast< char * >( m_data ) + aligned, length + ( offset - aligned ), MADV_WILLNEED );
+    }
+
+#endif
+
+#endif // PYSTRING_HAVE_CXX17
+
+} // namespace pystring
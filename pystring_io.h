@@ -0,0 +1,316 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_IO_H
+#define INCLUDED_PYSTRING_IO_H
+
+#include "pystring.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef PYSTRING_HAVE_CXX17
+#include <string_view>
+#endif
+
+namespace pystring
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup io pystring io
+    /// @{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Base class of the streaming transforms. Input is pushed through write() in chunks
+    /// of any size and the transformed bytes are appended to out; state that spans a chunk
+    /// boundary is carried over to the next call. finish() flushes whatever is still held back
+    /// once the input is exhausted. Feeding a whole string through write() and finish() gives
+    /// the same result as the matching pystring function.
+    ///
+    class StreamFilter
+    {
+    public:
+        virtual ~StreamFilter() {}
+        virtual void write( const char * data, std::size_t size, std::string & out ) = 0;
+        virtual void finish( std::string & out ) { (void) out; }
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Streaming replace(). Up to len(oldstr) - 1 bytes may be held back at the end of a
+    /// chunk, when they could be the start of a match completed by the next chunk.
+    ///
+    class ReplaceFilter : public StreamFilter
+    {
+    public:
+        ReplaceFilter( const std::string & oldstr, const std::string & newstr, int count = -1 );
+        void write( const char * data, std::size_t size, std::string & out );
+        void finish( std::string & out );
+
+    private:
+        void scan( const char * data, std::size_t size, std::string & out );
+
+        std::string m_old, m_new, m_carry, m_buffer;
+        int m_count;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Streaming translate(). The table must be a string of length 256, otherwise the
+    /// input is passed through unchanged.
+    ///
+    class TranslateFilter : public StreamFilter
+    {
+    public:
+        TranslateFilter( const std::string & table, const std::string & deletechars = "" );
+        void write( const char * data, std::size_t size, std::string & out );
+
+    private:
+        int m_table[256];
+        bool m_valid;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Streaming expandtabs(). The current column is carried across chunks.
+    ///
+    class ExpandTabsFilter : public StreamFilter
+    {
+    public:
+        explicit ExpandTabsFilter( int tabsize = 8 ) : m_tabsize( tabsize ), m_column( 0 ) {}
+        void write( const char * data, std::size_t size, std::string & out );
+
+    private:
+        int m_tabsize, m_column;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Streaming upper().
+    ///
+    class UpperFilter : public StreamFilter
+    {
+    public:
+        void write( const char * data, std::size_t size, std::string & out );
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Streaming lower().
+    ///
+    class LowerFilter : public StreamFilter
+    {
+    public:
+        void write( const char * data, std::size_t size, std::string & out );
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A chain of filters feeding an std::ostream or a file descriptor. Each chunk passed
+    /// to write() goes through the filters in the order they were added, and the result is
+    /// written to the sink, so memory use is bounded by the chunk size rather than the size of
+    /// the input. The filters are not owned and must outlive the pipeline. Call finish() once
+    /// at the end of the input.
+    ///
+    class FilterPipeline
+    {
+    public:
+        explicit FilterPipeline( std::ostream & out );
+        explicit FilterPipeline( int fd );
+
+        FilterPipeline & add( StreamFilter & filter );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Push a chunk through the pipeline. Return false if the sink failed.
+        ///
+        bool write( const char * data, std::size_t size );
+        bool write( const std::string & chunk ) { return write( chunk.data(), chunk.size() ); }
+        bool finish();
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Read in until end of file in chunks of chunksize bytes, push every chunk
+        /// through the pipeline and finish it.
+        ///
+        bool run( std::istream & in, std::size_t chunksize = 1 << 16 );
+
+    private:
+        bool flush( const char * data, std::size_t size, bool last );
+        bool emit( const char * data, std::size_t size );
+
+        std::vector< StreamFilter * > m_filters;
+        std::vector< std::string > m_buffers;
+        std::ostream * m_stream;
+        int m_fd;
+    };
+
+#ifdef PYSTRING_HAVE_CXX17
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Lazy range over the lines of a string, with the same line boundaries and keepends
+    /// behavior as splitlines(). The lines are views into the original buffer, which must
+    /// outlive the range.
+    ///
+    class LineRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef std::string_view value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const std::string_view * pointer;
+            typedef const std::string_view & reference;
+
+            iterator() : m_range( 0 ), m_pos( 0 ) {}
+            iterator( const LineRange * range, std::size_t pos ) : m_range( range ), m_pos( pos ) { advance(); }
+
+            reference operator*() const { return m_line; }
+            pointer operator->() const { return &m_line; }
+            iterator & operator++() { advance(); return *this; }
+            iterator operator++( int ) { iterator tmp( *this ); advance(); return tmp; }
+
+            // Iterators past the end are all equal, whatever position they stopped at
+            bool operator==( const iterator & other ) const { return m_range == other.m_range && ( !m_range || m_pos == other.m_pos ); }
+            bool operator!=( const iterator & other ) const { return !( *this == other ); }
+
+        private:
+            void advance();
+
+            const LineRange * m_range;
+            std::size_t m_pos;
+            std::string_view m_line;
+        };
+
+        LineRange() : m_keepends( false ) {}
+        explicit LineRange( std::string_view str, bool keepends = false ) : m_str( str ), m_keepends( keepends ) {}
+
+        iterator begin() const { return iterator( this, 0 ); }
+        iterator end() const { return iterator(); }
+
+    private:
+        std::string_view m_str;
+        bool m_keepends;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Lazy range over the words of a string, with the same sep and maxsplit behavior as
+    /// split(). If sep is "", any whitespace string is a separator. The words are views into the
+    /// original buffer, and sep is referenced rather than copied; both must outlive the range.
+    ///
+    class SplitRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef std::string_view value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const std::string_view * pointer;
+            typedef const std::string_view & reference;
+
+            iterator() : m_range( 0 ), m_pos( 0 ), m_splits( 0 ) {}
+            iterator( const SplitRange * range, std::size_t pos ) :
+                m_range( range ), m_pos( pos ), m_splits( range->m_maxsplit ) { advance(); }
+
+            reference operator*() const { return m_word; }
+            pointer operator->() const { return &m_word; }
+            iterator & operator++() { advance(); return *this; }
+            iterator operator++( int ) { iterator tmp( *this ); advance(); return tmp; }
+
+            // Iterators past the end are all equal, whatever position they stopped at
+            bool operator==( const iterator & other ) const { return m_range == other.m_range && ( !m_range || m_pos == other.m_pos ); }
+            bool operator!=( const iterator & other ) const { return !( *this == other ); }
+
+        private:
+            void advance();
+
+            const SplitRange * m_range;
+            std::size_t m_pos;
+            int m_splits;
+            std::string_view m_word;
+        };
+
+        SplitRange() : m_maxsplit( MAX_32BIT_INT ) {}
+        SplitRange( std::string_view str, std::string_view sep = std::string_view(), int maxsplit = -1 ) :
+            m_str( str ), m_sep( sep ), m_maxsplit( maxsplit < 0 ? MAX_32BIT_INT : maxsplit ) {}
+
+        iterator begin() const { return iterator( this, 0 ); }
+        iterator end() const { return iterator(); }
+
+    private:
+        std::string_view m_str;
+        std::string_view m_sep;
+        int m_maxsplit;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A read-only memory mapping of a whole file. The contents are exposed as views, and
+    /// lines() / split() iterate over them without copying. The file is advised for sequential
+    /// access; huge pages and read-ahead of the whole mapping can be requested with the
+    /// HUGEPAGES and PREFETCH flags. Views returned by a MappedFile are only valid while it is
+    /// open.
+    ///
+    class MappedFile
+    {
+    public:
+        enum Flags
+        {
+            NONE = 0,
+            HUGEPAGES = 1 << 0,
+            PREFETCH = 1 << 1
+        };
+
+        MappedFile();
+        explicit MappedFile( const std::string & path, int flags = NONE );
+        ~MappedFile();
+
+        MappedFile( MappedFile && other ) noexcept;
+        MappedFile & operator=( MappedFile && other ) noexcept;
+
+        MappedFile( const MappedFile & ) = delete;
+        MappedFile & operator=( const MappedFile & ) = delete;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Map path, closing any previous mapping first. Return false if the file could not
+        /// be opened or mapped. An empty file opens successfully with a size of 0.
+        ///
+        bool open( const std::string & path, int flags = NONE );
+        void close();
+
+        bool is_open() const { return m_open; }
+        const char * data() const { return m_data; }
+        std::size_t size() const { return m_size; }
+        std::string_view view() const { return std::string_view( m_data, m_size ); }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Ask the OS to start reading [offset, offset + length) ahead of use. Useful to
+        /// keep a window ahead of a sequential scan when PREFETCH of the whole file is too much.
+        ///
+        void prefetch( std::size_t offset, std::size_t length ) const;
+
+        LineRange lines( bool keepends = false ) const { return LineRange( view(), keepends ); }
+        SplitRange split( std::string_view sep = std::string_view(), int maxsplit = -1 ) const
+        {
+            return SplitRange( view(), sep, maxsplit );
+        }
+
+    private:
+        const char * m_data;
+        std::size_t m_size;
+        bool m_open;
+#ifdef _WIN32
+        void * m_file;
+        void * m_mapping;
+#endif
+    };
+
+#endif // PYSTRING_HAVE_CXX17
+
+    ///
+    /// @ }
+    ///
+
+} // namespace pystring
+
+#endif
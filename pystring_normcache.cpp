@@ -0,0 +1,185 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_normcache.h"
+#include "pystring.h"
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+        // Rough heap cost of an entry besides its two strings: the hash node and its ring slot
+        const std::size_t ENTRY_OVERHEAD = 64;
+    }
+
+    struct NormCache::Shard
+    {
+        struct Value
+        {
+            std::string result;
+            bool referenced;
+        };
+
+        typedef std::unordered_map< std::string, Value > Table;
+
+        // Entries in CLOCK order. Pointers to the elements of an unordered_map stay valid until
+        // the element is erased.
+        struct Slot
+        {
+            Kind kind;
+            Table::value_type * entry;
+        };
+
+        Shard() : hand( 0 ), bytes( 0 ), hits( 0 ), misses( 0 ), evictions( 0 ) {}
+
+        std::mutex mutex;
+        Table tables[KINDS];
+        std::vector< Slot > ring;
+        std::size_t hand, bytes;
+        unsigned long long hits, misses, evictions;
+    };
+
+    namespace
+    {
+        std::size_t cost( const std::string & key, const std::string & result )
+        {
+            return key.size() + result.size() + ENTRY_OVERHEAD;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    NormCache::NormCache( std::size_t max_bytes, unsigned int shards ) :
+        m_shards( shards ? shards : 1 ), m_shard_bytes( max_bytes / ( shards ? shards : 1 ) )
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i ) m_shards[i] = new Shard();
+    }
+
+    NormCache::~NormCache()
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i ) delete m_shards[i];
+    }
+
+    std::string NormCache::normpath( const std::string & path )
+    {
+        return lookup( NORMPATH, path, path, path );
+    }
+
+    std::string NormCache::abspath( const std::string & path, const std::string & cwd )
+    {
+        if ( os::path::isabs( path ) ) return lookup( NORMPATH, path, path, cwd );
+
+        std::string key;
+        key.reserve( cwd.size() + 1 + path.size() );
+        key.append( cwd ).append( 1, '\0' ).append( path );
+        return lookup( ABSPATH, key, path, cwd );
+    }
+
+    std::string NormCache::dirname( const std::string & path )
+    {
+        return lookup( DIRNAME, path, path, path );
+    }
+
+    std::string NormCache::lookup( Kind kind, const std::string & key, const std::string & path, const std::string & cwd )
+    {
+        Shard & shard = *m_shards[std::hash< std::string >()( key ) % m_shards.size()];
+        Shard::Table & table = shard.tables[kind];
+
+        {
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            Shard::Table::iterator it = table.find( key );
+            if ( it != table.end() )
+            {
+                ++shard.hits;
+                it->second.referenced = true;
+                return it->second.result;
+            }
+            ++shard.misses;
+        }
+
+        std::string result;
+        switch ( kind )
+        {
+            case NORMPATH: result = os::path::normpath( path ); break;
+            case ABSPATH: result = os::path::abspath( path, cwd ); break;
+            default: result = os::path::dirname( path ); break;
+        }
+
+        std::size_t bytes = cost( key, result );
+        if ( bytes > m_shard_bytes ) return result;
+
+        std::lock_guard< std::mutex > lock( shard.mutex );
+
+        // Another thread may have added it meanwhile
+        if ( table.count( key ) ) return result;
+
+        while ( !shard.ring.empty() && shard.bytes + bytes > m_shard_bytes )
+        {
+            if ( shard.hand >= shard.ring.size() ) shard.hand = 0;
+            Shard::Slot & slot = shard.ring[shard.hand];
+            if ( slot.entry->second.referenced )
+            {
+                slot.entry->second.referenced = false;
+                ++shard.hand;
+                continue;
+            }
+
+            Shard::Table & victims = shard.tables[slot.kind];
+            shard.bytes -= cost( slot.entry->first, slot.entry->second.result );
+            victims.erase( victims.find( slot.entry->first ) );
+            slot = shard.ring.back();
+            shard.ring.pop_back();
+            ++shard.evictions;
+        }
+
+        Shard::Slot slot = { kind, &*table.insert( Shard::Table::value_type( key, Shard::Value() ) ).first };
+        slot.entry->second.result = result;
+        shard.ring.push_back( slot );
+        shard.bytes += bytes;
+        return result;
+    }
+
+    NormCache::Stats NormCache::stats() const
+    {
+        Stats total = { 0, 0, 0, 0, 0 };
+        for ( std::size_t i = 0; i < m_shards.size(); ++i )
+        {
+            Shard & shard = *m_shards[i];
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.evictions += shard.evictions;
+            total.entries += shard.ring.size();
+            total.bytes += shard.bytes;
+        }
+        return total;
+    }
+
+    void NormCache::clear()
+    {
+        for ( std::size_t i = 0; i < m_shards.size(); ++i )
+        {
+            Shard & shard = *m_shards[i];
+            std::lock_guard< std::mutex > lock( shard.mutex );
+            for ( int kind = 0; kind < KINDS; ++kind ) shard.tables[kind].clear();
+            shard.ring.clear();
+            shard.hand = shard.bytes = 0;
+            shard.hits = shard.misses = shard.evictions = 0;
+        }
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
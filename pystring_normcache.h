@@ -0,0 +1,80 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_NORMCACHE_H
+#define INCLUDED_PYSTRING_NORMCACHE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Bounded cache of normpath(), abspath() and dirname() results, for programs that
+    /// see the same paths over and over. The functions return exactly what the uncached
+    /// os::path functions of the same name return.
+    ///
+    /// The cache is split into shards, picked by the hash of the path, each with its own lock,
+    /// so threads looking up different paths rarely wait for each other; a lookup holds the
+    /// lock only for the hash probe and the copy of the result. Results are computed outside of
+    /// the lock. When a shard is over its share of max_bytes, entries are evicted in CLOCK
+    /// order: a hit marks its entry, and the eviction hand skips (and unmarks) marked entries
+    /// once before evicting them. Sizes count the key, the result and a fixed per entry
+    /// overhead. Results bigger than a whole shard are returned but not cached.
+    ///
+    /// normpath() and dirname() look up the path as it is; abspath() of a relative path builds a
+    /// key from the path and cwd, so it allocates even on a hit. An absolute path is looked up
+    /// as normpath() of it.
+    ///
+    class NormCache
+    {
+    public:
+        struct Stats
+        {
+            unsigned long long hits, misses, evictions;
+            std::size_t entries, bytes;
+        };
+
+        explicit NormCache( std::size_t max_bytes = 64 << 20, unsigned int shards = 16 );
+        ~NormCache();
+
+        std::string normpath( const std::string & path );
+        std::string abspath( const std::string & path, const std::string & cwd );
+        std::string dirname( const std::string & path );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the counters and the current size summed over all shards.
+        ///
+        Stats stats() const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Drop every entry and reset the counters.
+        ///
+        void clear();
+
+    private:
+        NormCache( const NormCache & );
+        NormCache & operator=( const NormCache & );
+
+        struct Shard;
+        enum Kind { NORMPATH, ABSPATH, DIRNAME, KINDS };
+
+        std::string lookup( Kind kind, const std::string & key, const std::string & path, const std::string & cwd );
+
+        std::vector< Shard * > m_shards;
+        std::size_t m_shard_bytes;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
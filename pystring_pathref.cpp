@@ -0,0 +1,177 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_pathref.h"
+
+#ifdef PYSTRING_HAVE_CXX17
+
+#include "pystring_simd.h"
+
+#include <cstring>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+        bool same( std::string_view a, std::string_view b, bool nt )
+        {
+            if ( a.size() != b.size() ) return false;
+            if ( nt ) return simd::kernels().imismatch( a.data(), b.data(), a.size() ) == a.size();
+            return a == b;
+        }
+    }
+
+    const std::size_t PathRef::INLINE;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    PathRef::PathRef( std::string_view path ) :
+#if defined(_WIN32) || defined(_WIN64)
+        PathRef( path, true )
+#else
+        PathRef( path, false )
+#endif
+    {
+    }
+
+    PathRef::PathRef( std::string_view path, bool nt ) : m_path( path ), m_nt( nt ), m_drive( 0 ), m_root( 0 ), m_count( 0 )
+    {
+        parse();
+    }
+
+    void PathRef::parse()
+    {
+        const char * p = m_path.data();
+        std::size_t n = m_path.size(), i = 0;
+
+        if ( m_nt )
+        {
+            if ( n >= 2 && p[1] == ':' ) i = 2;
+            m_drive = (std::uint32_t) i;
+            if ( i < n && ( p[i] == '/' || p[i] == '\\' ) ) ++i;
+        }
+        else if ( n > 0 && p[0] == '/' )
+        {
+            // Exactly two leading slashes are kept, as posix leaves their meaning to the system
+            i = n >= 2 && p[1] == '/' && ( n == 2 || p[2] != '/' ) ? 2 : 1;
+        }
+        m_root = (std::uint32_t) i;
+
+        while ( i < n )
+        {
+            std::size_t begin = i;
+            if ( m_nt )
+            {
+                while ( i < n && p[i] != '/' && p[i] != '\\' ) ++i;
+            }
+            else
+            {
+                const void * sep = std::memchr( p + i, '/', n - i );
+                i = sep ? (std::size_t) ( (const char *) sep - p ) : n;
+            }
+
+            if ( i > begin && !( i == begin + 1 && p[begin] == '.' ) )
+            {
+                Name name = { (std::uint32_t) begin, (std::uint32_t) i };
+                if ( m_count < INLINE ) m_inline[m_count] = name;
+                else m_more.push_back( name );
+                ++m_count;
+            }
+            ++i;
+        }
+    }
+
+    std::string_view PathRef::operator[]( std::size_t index ) const
+    {
+        if ( m_root == 0 ) return name_at( index );
+        return index == 0 ? anchor() : name_at( index - 1 );
+    }
+
+    void PathRef::parts( std::vector< std::string_view > & result ) const
+    {
+        result.clear();
+        if ( m_root > 0 ) result.push_back( anchor() );
+        for ( std::size_t i = 0; i < m_count; ++i ) result.push_back( name_at( i ) );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::string_view PathRef::name() const
+    {
+        return m_count ? name_at( m_count - 1 ) : std::string_view();
+    }
+
+    std::string_view PathRef::stem() const
+    {
+        std::string_view n = name();
+        std::size_t dot = n.rfind( '.' );
+        return dot != std::string_view::npos && dot > 0 && dot + 1 < n.size() ? n.substr( 0, dot ) : n;
+    }
+
+    std::string_view PathRef::suffix() const
+    {
+        std::string_view n = name();
+        std::size_t dot = n.rfind( '.' );
+        return dot != std::string_view::npos && dot > 0 && dot + 1 < n.size() ? n.substr( dot ) : std::string_view();
+    }
+
+    void PathRef::suffixes( std::vector< std::string_view > & result ) const
+    {
+        result.clear();
+        std::string_view n = name();
+        if ( n.empty() || n.back() == '.' ) return;
+
+        std::size_t i = n.find_first_not_of( '.' );
+        for ( i = n.find( '.', i ); i != std::string_view::npos; )
+        {
+            std::size_t next = n.find( '.', i + 1 );
+            result.push_back( n.substr( i, next == std::string_view::npos ? next : next - i ) );
+            i = next;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::string_view PathRef::parent( std::size_t n ) const
+    {
+        if ( n + 1 < m_count ) return m_path.substr( 0, at( m_count - n - 2 ).end );
+        return m_root > 0 ? anchor() : std::string_view( "." );
+    }
+
+    bool PathRef::is_relative_to( const PathRef & other ) const
+    {
+        if ( other.m_count > m_count ) return false;
+        if ( !same( drive(), other.drive(), m_nt ) ) return false;
+        if ( m_nt ? isabs() != other.isabs() : root() != other.root() ) return false;
+
+        for ( std::size_t i = 0; i < other.m_count; ++i )
+        {
+            if ( !same( name_at( i ), other.name_at( i ), m_nt ) ) return false;
+        }
+        return true;
+    }
+
+    std::string_view PathRef::relative_to( const PathRef & other ) const
+    {
+        if ( !is_relative_to( other ) ) return std::string_view();
+        if ( other.m_count == m_count ) return std::string_view( "." );
+
+        std::uint32_t begin = at( other.m_count ).begin;
+        return m_path.substr( begin, at( m_count - 1 ).end - begin );
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
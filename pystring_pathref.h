@@ -0,0 +1,118 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_PATHREF_H
+#define INCLUDED_PYSTRING_PATHREF_H
+
+#include "pystring.h"
+
+#ifdef PYSTRING_HAVE_CXX17
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A path parsed once into its components, with the queries of python's
+    /// pathlib.PurePath answered from the stored offsets without scanning the path again.
+    ///
+    /// As in pathlib, the parts are the anchor (drive and root), if any, followed by the names
+    /// between separators; empty names and "." are left out, ".." is kept. Every query returns
+    /// views into the path, which must outlive the PathRef. parent() and relative_to() return a
+    /// slice of the path, so they keep its own separators and any "." or doubled separators
+    /// between the names they cover, which os::path::normpath() would remove.
+    ///
+    /// The first INLINE names are stored in the PathRef itself; only deeper paths allocate.
+    ///
+    class PathRef
+    {
+    public:
+        static const std::size_t INLINE = 16;
+
+        /// Parse path with the rules of the platform, of posix or of nt.
+        explicit PathRef( std::string_view path );
+        static PathRef posix( std::string_view path ) { return PathRef( path, false ); }
+        static PathRef nt( std::string_view path ) { return PathRef( path, true ); }
+
+        std::string_view path() const { return m_path; }
+        bool is_nt() const { return m_nt; }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The drive ("c:" on nt, always empty on posix), the root ("/", "//" or "\") and
+        /// the two together. isabs() is true when there is a root, as os::path::isabs().
+        ///
+        std::string_view drive() const { return m_path.substr( 0, m_drive ); }
+        std::string_view root() const { return m_path.substr( m_drive, m_root - m_drive ); }
+        std::string_view anchor() const { return m_path.substr( 0, m_root ); }
+        bool isabs() const { return m_root > m_drive; }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The number of parts and the part at index, the anchor first if there is one.
+        /// parts() stores all of them in result.
+        ///
+        std::size_t size() const { return m_count + ( m_root > 0 ? 1 : 0 ); }
+        std::string_view operator[]( std::size_t index ) const;
+        void parts( std::vector< std::string_view > & result ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The last name, empty if there is none; the name without its suffix; the
+        /// suffix, from the last dot of the name; and all the suffixes of the name. A leading
+        /// dot does not start a suffix, and a name ending with a dot has none.
+        ///
+        std::string_view name() const;
+        std::string_view stem() const;
+        std::string_view suffix() const;
+        void suffixes( std::vector< std::string_view > & result ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The ancestor n levels above the parent, as pathlib's parents[n]: parent() is
+        /// the path without its last name. Past the first name it is the anchor, or "." for a
+        /// relative path.
+        ///
+        std::string_view parent( std::size_t n = 0 ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The rest of the path after other, if other has the same anchor and its names
+        /// are the first names of this path; "." if they are the same path. relative_to()
+        /// returns an empty view when is_relative_to() is false. Names are compared without
+        /// regard to ascii case on nt.
+        ///
+        bool is_relative_to( const PathRef & other ) const;
+        std::string_view relative_to( const PathRef & other ) const;
+
+    private:
+        struct Name
+        {
+            std::uint32_t begin, end;
+        };
+
+        PathRef( std::string_view path, bool nt );
+        void parse();
+
+        const Name & at( std::size_t i ) const { return i < INLINE ? m_inline[i] : m_more[i - INLINE]; }
+        std::string_view slice( const Name & n ) const { return m_path.substr( n.begin, n.end - n.begin ); }
+        std::string_view name_at( std::size_t i ) const { return slice( at( i ) ); }
+
+        std::string_view m_path;
+        bool m_nt;
+        std::uint32_t m_drive, m_root, m_count;
+        Name m_inline[INLINE];
+        std::vector< Name > m_more;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
+
+#endif
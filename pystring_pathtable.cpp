@@ -0,0 +1,353 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_pathtable.h"
+
+#ifdef PYSTRING_HAVE_CXX17
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+        const char MAGIC[8] = { 'P', 'Y', 'S', 'T', 'R', 'T', 'A', 'B' };
+        const std::size_t HEADER = 40;
+
+        void put32( char * p, std::uint32_t v )
+        {
+            for ( int i = 0; i < 4; ++i ) p[i] = (char) ( v >> ( 8 * i ) );
+        }
+
+        void put64( char * p, std::uint64_t v )
+        {
+            for ( int i = 0; i < 8; ++i ) p[i] = (char) ( v >> ( 8 * i ) );
+        }
+
+        std::uint64_t get64( const char * p )
+        {
+            std::uint64_t v = 0;
+            for ( int i = 7; i >= 0; --i ) v = ( v << 8 ) | (unsigned char) p[i];
+            return v;
+        }
+
+        std::uint32_t get32( const char * p )
+        {
+            std::uint32_t v = 0;
+            for ( int i = 3; i >= 0; --i ) v = ( v << 8 ) | (unsigned char) p[i];
+            return v;
+        }
+
+        void put_varint( std::string & out, std::size_t v )
+        {
+            while ( v >= 0x80 )
+            {
+                out.push_back( (char) ( v | 0x80 ) );
+                v >>= 7;
+            }
+            out.push_back( (char) v );
+        }
+
+        const char * get_varint( const char * p, std::size_t & v )
+        {
+            v = 0;
+            for ( int shift = 0; ; shift += 7 )
+            {
+                unsigned char c = (unsigned char) *p++;
+                v |= (std::size_t) ( c & 0x7f ) << shift;
+                if ( c < 0x80 ) return p;
+            }
+        }
+
+        // Decodes the paths of a block one after the other into path
+        struct Decoder
+        {
+            explicit Decoder( const char * block ) : p( block ), first( true ) {}
+
+            void next( std::string & path )
+            {
+                std::size_t shared = 0, size;
+                if ( !first ) p = get_varint( p, shared );
+                p = get_varint( p, size );
+                path.resize( shared );
+                path.append( p, size );
+                p += size;
+                first = false;
+            }
+
+            const char * p;
+            bool first;
+        };
+    }
+
+    const std::uint32_t PathTable::VERSION;
+    const std::size_t PathTable::BLOCK;
+    const std::size_t PathTable::npos;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    PathTable::PathTable() :
+        m_image( 0 ), m_bytes( 0 ), m_count( 0 ), m_blocks( 0 ), m_block( BLOCK ), m_offsets( 0 ), m_data( 0 )
+    {
+    }
+
+    PathTable::PathTable( const std::vector< std::string > & paths ) : PathTable()
+    {
+        build( paths );
+    }
+
+    PathTable::PathTable( PathTable && other ) noexcept : PathTable()
+    {
+        *this = std::move( other );
+    }
+
+    PathTable & PathTable::operator=( PathTable && other ) noexcept
+    {
+        if ( this != &other )
+        {
+            close();
+
+            // A mapping stays where it is, but the image of a built table is in its string
+            const char * image = other.m_image;
+            std::size_t bytes = other.m_bytes;
+            bool built = image && image == other.m_built.data();
+            m_built = std::move( other.m_built );
+            m_file = std::move( other.m_file );
+            other.close();
+
+            if ( built ) image = m_built.data();
+            if ( image ) view( image, bytes );
+        }
+        return *this;
+    }
+
+    void PathTable::close()
+    {
+        m_file.close();
+        m_built.clear();
+        close_view();
+    }
+
+    void PathTable::close_view()
+    {
+        m_image = 0;
+        m_bytes = 0;
+        m_count = 0;
+        m_blocks = 0;
+        m_block = BLOCK;
+        m_offsets = 0;
+        m_data = 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void PathTable::build( const std::vector< std::string > & paths )
+    {
+        close();
+
+        std::vector< const std::string * > sorted( paths.size() );
+        for ( std::size_t i = 0; i < paths.size(); ++i ) sorted[i] = &paths[i];
+        std::sort( sorted.begin(), sorted.end(), []( const std::string * a, const std::string * b ) { return *a < *b; } );
+        sorted.erase( std::unique( sorted.begin(), sorted.end(), []( const std::string * a, const std::string * b ) { return *a == *b; } ),
+                      sorted.end() );
+
+        // The header and offsets are filled in once the data after them is written
+        std::size_t blocks = ( sorted.size() + BLOCK - 1 ) / BLOCK, start = HEADER + blocks * 8;
+        m_built.resize( start );
+        for ( std::size_t i = 0; i < sorted.size(); ++i )
+        {
+            const std::string & path = *sorted[i];
+            if ( i % BLOCK == 0 )
+            {
+                put64( &m_built[HEADER + i / BLOCK * 8], m_built.size() - start );
+                put_varint( m_built, path.size() );
+                m_built.append( path );
+                continue;
+            }
+
+            const std::string & previous = *sorted[i - 1];
+            std::size_t shared = 0, limit = std::min( path.size(), previous.size() );
+            while ( shared < limit && path[shared] == previous[shared] ) ++shared;
+            put_varint( m_built, shared );
+            put_varint( m_built, path.size() - shared );
+            m_built.append( path, shared, std::string::npos );
+        }
+
+        std::memcpy( &m_built[0], MAGIC, sizeof( MAGIC ) );
+        put32( &m_built[8], VERSION );
+        put32( &m_built[12], (std::uint32_t) BLOCK );
+        put64( &m_built[16], sorted.size() );
+        put64( &m_built[24], blocks );
+        put64( &m_built[32], m_built.size() - start );
+        m_built.shrink_to_fit();
+
+        view( m_built.data(), m_built.size() );
+    }
+
+    bool PathTable::save( const std::string & filename ) const
+    {
+        if ( !m_image ) return PathTable( std::vector< std::string >() ).save( filename );
+
+        std::ofstream out( filename.c_str(), std::ios::binary | std::ios::trunc );
+        out.write( m_image, (std::streamsize) m_bytes );
+        return (bool) out;
+    }
+
+    bool PathTable::open( const std::string & filename, int flags )
+    {
+        close();
+        if ( !m_file.open( filename, flags ) ) return false;
+        if ( view( m_file.data(), m_file.size() ) ) return true;
+        m_file.close();
+        return false;
+    }
+
+    bool PathTable::attach( const char * data, std::size_t size )
+    {
+        close();
+        return view( data, size );
+    }
+
+    bool PathTable::view( const char * data, std::size_t size )
+    {
+        close_view();
+
+        // An empty table is still written with its header, so anything shorter is not a table
+        if ( size < HEADER || std::memcmp( data, MAGIC, sizeof( MAGIC ) ) != 0 ) return false;
+        if ( get32( data + 8 ) != VERSION ) return false;
+
+        std::uint64_t block = get32( data + 12 ), count = get64( data + 16 ), blocks = get64( data + 24 ), bytes = get64( data + 32 );
+        if ( block == 0 || blocks != ( count + block - 1 ) / block ) return false;
+        if ( blocks > ( size - HEADER ) / 8 || bytes != size - HEADER - blocks * 8 ) return false;
+
+        m_image = data;
+        m_bytes = size;
+        m_count = (std::size_t) count;
+        m_blocks = (std::size_t) blocks;
+        m_block = (std::size_t) block;
+        m_offsets = data + HEADER;
+        m_data = m_offsets + m_blocks * 8;
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    const char * PathTable::block( std::size_t index ) const
+    {
+        return m_data + get64( m_offsets + index * 8 );
+    }
+
+    void PathTable::get( std::size_t index, std::string & result ) const
+    {
+        result.clear();
+        if ( index >= m_count ) return;
+
+        Decoder decoder( block( index / m_block ) );
+        for ( std::size_t i = index - index % m_block; i <= index; ++i ) decoder.next( result );
+    }
+
+    std::string PathTable::operator[]( std::size_t index ) const
+    {
+        std::string result;
+        get( index, result );
+        return result;
+    }
+
+    void PathTable::get( std::size_t begin, std::size_t end, std::vector< std::string > & result ) const
+    {
+        result.clear();
+        end = std::min( end, m_count );
+        if ( begin >= end ) return;
+        result.reserve( end - begin );
+
+        std::string path;
+        Decoder decoder( 0 );
+        for ( std::size_t i = begin - begin % m_block; i < end; ++i )
+        {
+            if ( i % m_block == 0 ) decoder = Decoder( block( i / m_block ) );
+            decoder.next( path );
+            if ( i >= begin ) result.push_back( path );
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::size_t PathTable::search( std::string_view path, bool & found ) const
+    {
+        found = false;
+        if ( m_count == 0 ) return 0;
+
+        // The last block whose first path is not greater than path; the first paths are
+        // compared where they are stored
+        std::size_t lo = 0, hi = m_blocks;
+        while ( lo < hi )
+        {
+            std::size_t mid = lo + ( hi - lo ) / 2, size;
+            const char * first = get_varint( block( mid ), size );
+            if ( std::string_view( first, size ) <= path ) lo = mid + 1;
+            else hi = mid;
+        }
+        if ( lo == 0 ) return 0;
+
+        std::size_t b = lo - 1, begin = b * m_block, end = std::min( begin + m_block, m_count );
+        thread_local std::string current;
+        Decoder decoder( block( b ) );
+        for ( std::size_t i = begin; i < end; ++i )
+        {
+            decoder.next( current );
+            int order = std::string_view( current ).compare( path );
+            if ( order >= 0 )
+            {
+                found = order == 0;
+                return i;
+            }
+        }
+        return end;
+    }
+
+    std::size_t PathTable::lower_bound( std::string_view path ) const
+    {
+        bool found;
+        return search( path, found );
+    }
+
+    std::size_t PathTable::find( std::string_view path ) const
+    {
+        bool found;
+        std::size_t index = search( path, found );
+        return found ? index : npos;
+    }
+
+    std::pair< std::size_t, std::size_t > PathTable::prefix_range( std::string_view prefix ) const
+    {
+        std::size_t begin = lower_bound( prefix );
+
+        // The paths with the prefix end before the smallest string greater than all of them:
+        // the prefix without its trailing 0xff bytes, with its last byte incremented
+        std::size_t n = prefix.size();
+        while ( n > 0 && (unsigned char) prefix[n - 1] == 0xff ) --n;
+        if ( n == 0 ) return std::make_pair( begin, m_count );
+
+        std::string limit( prefix.substr( 0, n ) );
+        limit[n - 1] = (char) ( (unsigned char) limit[n - 1] + 1 );
+        return std::make_pair( begin, lower_bound( limit ) );
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif // PYSTRING_HAVE_CXX17
@@ -0,0 +1,138 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_PATHTABLE_H
+#define INCLUDED_PYSTRING_PATHTABLE_H
+
+#include "pystring.h"
+
+#ifdef PYSTRING_HAVE_CXX17
+
+#include "pystring_io.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A sorted, read-only table of paths, front coded to a fraction of their size, that
+    /// can be saved to a file and mapped back without reading it.
+    ///
+    /// Paths are sorted bytewise and cut into blocks of BLOCK. The first path of a block is
+    /// stored whole; each of the others as the length it shares with the path before it and
+    /// the rest of it. Looking a path up binary searches the first paths of the blocks in
+    /// place, then decodes at most one block. In sorted trees of files the shared part is
+    /// most of each path, so the table is usually several times smaller than the strings.
+    ///
+    /// The table in memory is the file, byte for byte, all little endian:
+    ///
+    ///     "PYSTRTAB"       8 bytes
+    ///     version          u32, VERSION
+    ///     block            u32, paths per block
+    ///     count            u64, paths
+    ///     blocks           u64
+    ///     data             u64, bytes of block data
+    ///     offsets          u64 x blocks, of each block in the data
+    ///     block data       varint length and bytes of the first path, then varint shared
+    ///                      length, varint length and bytes of the rest of each other path
+    ///
+    /// open() only checks the header and the size, so it takes the same time whatever the size
+    /// of the table; the file is trusted to be one written by save(). The const members may be
+    /// called from any number of threads at the same time.
+    ///
+    class PathTable
+    {
+    public:
+        static const std::uint32_t VERSION = 1;
+        static const std::size_t BLOCK = 16;
+        static const std::size_t npos = static_cast< std::size_t >( -1 );
+
+        PathTable();
+        explicit PathTable( const std::vector< std::string > & paths );
+
+        PathTable( PathTable && other ) noexcept;
+        PathTable & operator=( PathTable && other ) noexcept;
+
+        PathTable( const PathTable & ) = delete;
+        PathTable & operator=( const PathTable & ) = delete;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Replace the table with paths, sorted, each one kept once.
+        ///
+        void build( const std::vector< std::string > & paths );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Write the table to filename, or map a file written by save() and use it in
+        /// place until the table is closed or replaced. attach() uses a table image the caller
+        /// keeps alive, such as image() of another table. They return false if the file cannot
+        /// be written or mapped or does not hold a table of this version, leaving the table
+        /// empty.
+        ///
+        bool save( const std::string & filename ) const;
+        bool open( const std::string & filename, int flags = MappedFile::NONE );
+        bool attach( const char * data, std::size_t size );
+        void close();
+
+        std::string_view image() const { return std::string_view( m_image, m_bytes ); }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The number of paths, and the path at index. get() of a range decodes the
+        /// paths one after the other, which is faster than getting them one by one.
+        ///
+        std::size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+        std::string operator[]( std::size_t index ) const;
+        void get( std::size_t index, std::string & result ) const;
+        void get( std::size_t begin, std::size_t end, std::vector< std::string > & result ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The index of the first path not less than path, the index of path or npos
+        /// if it is not in the table, and the range of indices of the paths that start with
+        /// prefix. Prefixes are bytes: the paths under a directory are the ones that start
+        /// with it and a separator.
+        ///
+        std::size_t lower_bound( std::string_view path ) const;
+        std::size_t find( std::string_view path ) const;
+        std::pair< std::size_t, std::size_t > prefix_range( std::string_view prefix ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The size of the image, which is what the table takes in memory.
+        ///
+        std::size_t bytes() const { return m_bytes; }
+
+    private:
+        bool view( const char * data, std::size_t size );
+        void close_view();
+        std::size_t search( std::string_view path, bool & found ) const;
+        const char * block( std::size_t index ) const;
+
+        std::string m_built;
+        MappedFile m_file;
+
+        const char * m_image;
+        std::size_t m_bytes;
+        std::size_t m_count;
+        std::size_t m_blocks;
+        std::size_t m_block;
+        const char * m_offsets;
+        const char * m_data;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif // PYSTRING_HAVE_CXX17
+
+#endif
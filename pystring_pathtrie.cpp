@@ -0,0 +1,278 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_pathtrie.h"
+#include "pystring_simd.h"
+
+#include <cstring>
+#include <utility>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+        const std::size_t FIRST_CAPACITY = 64;
+
+        // normpath() of path, in a buffer of the thread that keeps its capacity between calls
+        const std::string & normalized( const std::string & path, bool nt )
+        {
+            thread_local std::string buffer;
+            buffer.assign( path );
+            buffer = nt ? normpath_nt( std::move( buffer ) ) : normpath_posix( std::move( buffer ) );
+            return buffer;
+        }
+
+        // The anchor and then the names of a normalized path. The anchor of a relative path is
+        // empty, so that relative paths are a subtree of their own.
+        struct Components
+        {
+            Components( const std::string & path, bool nt ) :
+                p( path.data() ), n( path.size() ), sep( nt ? '\\' : '/' ), i( 0 ), anchor( true )
+            {
+                if ( n == 1 && p[0] == '.' ) n = 0;
+            }
+
+            bool next( const char *& s, std::size_t & size )
+            {
+                if ( anchor )
+                {
+                    anchor = false;
+                    std::size_t end = sep == '\\' && n >= 2 && p[1] == ':' ? 2 : 0;
+                    while ( end < n && ( p[end] == sep || p[end] == '/' ) ) ++end;
+                    s = p;
+                    size = end;
+                    i = end;
+                    return true;
+                }
+
+                if ( i >= n ) return false;
+                const void * found = std::memchr( p + i, sep, n - i );
+                std::size_t end = found ? (std::size_t) ( (const char *) found - p ) : n;
+                s = p + i;
+                size = end - i;
+                i = end + 1;
+                return true;
+            }
+
+            const char * p;
+            std::size_t n;
+            char sep;
+            std::size_t i;
+            bool anchor;
+        };
+
+        std::uint32_t hash_name( PathTrie::Node parent, const char * s, std::size_t n, bool nt )
+        {
+            std::uint64_t h = ( parent + 1 ) * 0x9e3779b97f4a7c15ull;
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                char c = s[i];
+                if ( nt && c >= 'A' && c <= 'Z' ) c = (char) ( c - 'A' + 'a' );
+                h = ( h ^ (unsigned char) c ) * 0x100000001b3ull;
+            }
+            return (std::uint32_t) ( h ^ ( h >> 32 ) );
+        }
+    }
+
+    const PathTrie::Node PathTrie::NONE;
+    const std::uint32_t PathTrie::INSERTED;
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    PathTrie::PathTrie() :
+#if defined(_WIN32) || defined(_WIN64)
+        PathTrie( true )
+#else
+        PathTrie( false )
+#endif
+    {
+    }
+
+    PathTrie::PathTrie( bool nt ) : m_nt( nt ), m_size( 0 ), m_table( FIRST_CAPACITY, 0 )
+    {
+        // The node above the anchors, which is never a path itself
+        NodeData top = { 0, 0, 0, NONE, NONE, NONE, NONE, 0 };
+        m_nodes.push_back( top );
+    }
+
+    std::size_t PathTrie::bytes() const
+    {
+        return m_nodes.capacity() * sizeof( NodeData ) + m_names.capacity() + m_table.capacity() * sizeof( Node );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    PathTrie::Node PathTrie::child( Node parent, const char * s, std::size_t n, std::uint32_t hash ) const
+    {
+        std::size_t mask = m_table.size() - 1;
+        for ( std::size_t i = hash & mask; ; i = ( i + 1 ) & mask )
+        {
+            Node node = m_table[i];
+            if ( node == 0 ) return NONE;
+
+            const NodeData & data = m_nodes[node];
+            if ( data.hash != hash || data.parent != parent || data.length != n ) continue;
+
+            const char * name = m_names.data() + data.name;
+            if ( m_nt ? simd::kernels().imismatch( name, s, n ) == n : std::memcmp( name, s, n ) == 0 ) return node;
+        }
+    }
+
+    void PathTrie::link( Node node )
+    {
+        std::size_t mask = m_table.size() - 1, i = m_nodes[node].hash & mask;
+        while ( m_table[i] ) i = ( i + 1 ) & mask;
+        m_table[i] = node;
+    }
+
+    PathTrie::Node PathTrie::add( Node parent, const char * s, std::size_t n, std::uint32_t hash )
+    {
+        Node node = (Node) m_nodes.size();
+        NodeData data = { (std::uint32_t) m_names.size(), (std::uint32_t) n, hash, parent, NONE, NONE, NONE, 0 };
+        m_nodes.push_back( data );
+        m_names.append( s, n );
+
+        NodeData & up = m_nodes[parent];
+        if ( up.last_child == NONE ) up.first_child = node;
+        else m_nodes[up.last_child].next_sibling = node;
+        up.last_child = node;
+
+        if ( m_nodes.size() * 2 > m_table.size() )
+        {
+            m_table.assign( m_table.size() * 2, 0 );
+            for ( Node i = 1; i < m_nodes.size(); ++i ) link( i );
+        }
+        else
+        {
+            link( node );
+        }
+        return node;
+    }
+
+    PathTrie::Node PathTrie::insert( const std::string & path )
+    {
+        Components components( normalized( path, m_nt ), m_nt );
+        const char * s;
+        std::size_t n;
+        Node node = 0;
+        while ( components.next( s, n ) )
+        {
+            std::uint32_t hash = hash_name( node, s, n, m_nt );
+            Node next = child( node, s, n, hash );
+            node = next != NONE ? next : add( node, s, n, hash );
+        }
+
+        if ( !( m_nodes[node].count & INSERTED ) )
+        {
+            m_nodes[node].count |= INSERTED;
+            for ( Node up = node; up != NONE; up = m_nodes[up].parent ) ++m_nodes[up].count;
+            ++m_size;
+        }
+        return node;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    PathTrie::Node PathTrie::walk( const std::string & path, Node * prefix ) const
+    {
+        Components components( normalized( path, m_nt ), m_nt );
+        const char * s;
+        std::size_t n;
+        Node node = 0;
+        while ( components.next( s, n ) )
+        {
+            node = child( node, s, n, hash_name( node, s, n, m_nt ) );
+            if ( node == NONE ) return NONE;
+            if ( prefix && ( m_nodes[node].count & INSERTED ) ) *prefix = node;
+        }
+        return node;
+    }
+
+    PathTrie::Node PathTrie::find( const std::string & path ) const
+    {
+        Node node = walk( path, 0 );
+        return node != NONE && ( m_nodes[node].count & INSERTED ) ? node : NONE;
+    }
+
+    PathTrie::Node PathTrie::longest_prefix( const std::string & path ) const
+    {
+        Node prefix = NONE;
+        walk( path, &prefix );
+        return prefix;
+    }
+
+    std::size_t PathTrie::count( const std::string & path ) const
+    {
+        Node node = walk( path, 0 );
+        return node != NONE ? m_nodes[node].count & ~INSERTED : 0;
+    }
+
+    void PathTrie::subtree( const std::string & path, std::vector< Node > & result ) const
+    {
+        result.clear();
+        Node top = walk( path, 0 );
+        if ( top == NONE ) return;
+        result.reserve( m_nodes[top].count & ~INSERTED );
+
+        // Depth first without a stack: down to the first child, else on to the next sibling
+        // of the node or of the closest of its parents that has one
+        Node node = top;
+        for ( ;; )
+        {
+            const NodeData & data = m_nodes[node];
+            if ( data.count & INSERTED ) result.push_back( node );
+            if ( data.first_child != NONE )
+            {
+                node = data.first_child;
+                continue;
+            }
+            while ( node != top && m_nodes[node].next_sibling == NONE ) node = m_nodes[node].parent;
+            if ( node == top ) break;
+            node = m_nodes[node].next_sibling;
+        }
+    }
+
+    void PathTrie::subtree( const std::string & path, std::vector< std::string > & result ) const
+    {
+        std::vector< Node > nodes;
+        subtree( path, nodes );
+        result.clear();
+        result.reserve( nodes.size() );
+        for ( std::size_t i = 0; i < nodes.size(); ++i ) result.push_back( this->path( nodes[i] ) );
+    }
+
+    std::string PathTrie::path( Node node ) const
+    {
+        if ( node == 0 || node >= m_nodes.size() ) return std::string();
+
+        // Walk up to the anchor to know the length, then fill the names in from the end
+        std::size_t size = 0, depth = 0;
+        for ( Node up = node; up != 0; up = m_nodes[up].parent, ++depth ) size += m_nodes[up].length;
+        // The names after the anchor are separated; the anchor is followed by the first one
+        if ( depth > 2 ) size += depth - 2;
+        if ( size == 0 ) return std::string( "." );
+        std::string result( size, m_nt ? '\\' : '/' );
+        std::size_t end = size;
+        for ( Node up = node; up != 0; up = m_nodes[up].parent )
+        {
+            const NodeData & data = m_nodes[up];
+            end -= data.length;
+            std::memcpy( &result[end], m_names.data() + data.name, data.length );
+            if ( data.parent != 0 && m_nodes[data.parent].parent != 0 ) --end;
+        }
+        return result;
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
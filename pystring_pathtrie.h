@@ -0,0 +1,138 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_PATHTRIE_H
+#define INCLUDED_PYSTRING_PATHTRIE_H
+
+#include "pystring.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief A set of paths stored as a tree of their components, which answers "is this path
+    /// under one of the registered ones" and "which registered paths are under this one" by
+    /// following the components of the path, whatever the number of paths stored.
+    ///
+    /// Paths are normalized with normpath() as they are inserted and looked up, and cut into
+    /// their anchor ("/", "c:\" or "" for relative paths) and names. Prefixes are whole
+    /// components: /show/seq is a prefix of /show/seq/shot but not of /show/seq2. On nt,
+    /// names are compared ignoring the case of ASCII letters.
+    ///
+    /// Each distinct component of each directory is one node. Nodes are 32 bytes, in a single
+    /// array; their names are appended to a single string; and the child of a node with a
+    /// given name is found through one hash table for the whole trie. A Node is the index of
+    /// a node, which does not change while the trie grows.
+    ///
+    /// The const members may be called from any number of threads at the same time, as long
+    /// as no thread is inserting.
+    ///
+    class PathTrie
+    {
+    public:
+        typedef std::uint32_t Node;
+
+        /// The node returned for a path that is not in the trie.
+        static const Node NONE = 0xffffffffu;
+
+        /// A trie of paths with the rules of the platform, of posix or of nt.
+        PathTrie();
+        static PathTrie posix() { return PathTrie( false ); }
+        static PathTrie nt() { return PathTrie( true ); }
+
+        bool is_nt() const { return m_nt; }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Add a path, and return its node. Inserting a path again returns the same node.
+        ///
+        Node insert( const std::string & path );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the node of path if it was inserted, NONE otherwise. A directory of
+        /// an inserted path is not in the trie unless it was inserted itself.
+        ///
+        Node find( const std::string & path ) const;
+        bool contains( const std::string & path ) const { return find( path ) != NONE; }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the node of the longest inserted path that is path itself or one of
+        /// its directories, NONE if there is none.
+        ///
+        Node longest_prefix( const std::string & path ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the number of inserted paths that are path or under it. It is kept
+        /// up to date by insert(), so this only looks path up.
+        ///
+        std::size_t count( const std::string & path ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Store in result the inserted paths that are path or under it, depth first,
+        /// a directory before what it contains and the entries of a directory in the order
+        /// they were first inserted.
+        ///
+        void subtree( const std::string & path, std::vector< Node > & result ) const;
+        void subtree( const std::string & path, std::vector< std::string > & result ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the path of a node, as normpath() of the path that was inserted, with
+        /// the case that path had when the node was added on nt.
+        ///
+        std::string path( Node node ) const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the number of paths inserted, the number of nodes holding them, and
+        /// the bytes allocated for the nodes, their names and the table that links them.
+        ///
+        std::size_t size() const { return m_size; }
+        std::size_t nodes() const { return m_nodes.size(); }
+        std::size_t bytes() const;
+
+    private:
+        explicit PathTrie( bool nt );
+
+        struct NodeData
+        {
+            std::uint32_t name;
+            std::uint32_t length;
+            std::uint32_t hash;
+            Node parent;
+            Node first_child;
+            Node last_child;
+            Node next_sibling;
+            std::uint32_t count;    // inserted paths at or under the node, with the flag below
+        };
+
+        static const std::uint32_t INSERTED = 0x80000000u;
+
+        Node walk( const std::string & path, Node * prefix ) const;
+        Node child( Node parent, const char * s, std::size_t n, std::uint32_t hash ) const;
+        Node add( Node parent, const char * s, std::size_t n, std::uint32_t hash );
+        void link( Node node );
+
+        bool m_nt;
+        std::size_t m_size;
+        std::vector< NodeData > m_nodes;
+        std::string m_names;
+
+        // Open addressing table of the nodes but the first, by the hash of their parent and
+        // name; 0 marks an empty slot. It is never more than half full.
+        std::vector< Node > m_table;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
@@ -0,0 +1,265 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_realpath.h"
+#include "pystring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+#ifndef _WIN32
+        std::string getcwd()
+        {
+            std::vector< char > buffer( 4096 );
+            while ( !::getcwd( &buffer[0], buffer.size() ) )
+            {
+                if ( errno != ERANGE ) return std::string( "/" );
+                buffer.resize( buffer.size() * 2 );
+            }
+            return std::string( &buffer[0] );
+        }
+
+        bool read_link( const std::string & path, std::string & target )
+        {
+            target.resize( 256 );
+            for ( ;; )
+            {
+                ssize_t n = ::readlinkat( AT_FDCWD, path.c_str(), &target[0], target.size() );
+                if ( n < 0 ) return false;
+                if ( (std::size_t) n < target.size() )
+                {
+                    target.resize( (std::size_t) n );
+                    return true;
+                }
+                target.resize( target.size() * 2 );
+            }
+        }
+
+        // posixpath._joinrealpath(), on a path that is always absolute. The links already
+        // followed map to what they resolve to, or to nothing while they are being resolved,
+        // which is how a loop is recognized.
+        class Resolver
+        {
+        public:
+            Resolver() : path( "/" ) {}
+
+            // Append name to the path, following it if it is a link, and tell whether the
+            // directory it was looked up in exists. Return false if the link is part of a
+            // loop, with the path ending at it.
+            bool step( const std::string & name, bool & exists )
+            {
+                exists = false;
+                if ( name.empty() || name == "." ) return true;
+                if ( name == ".." )
+                {
+                    std::size_t slash = path.rfind( '/' );
+                    path.resize( slash == 0 ? 1 : slash );
+                    return true;
+                }
+
+                // One readlinkat() tells both whether name is a link and whether the path
+                // before it is a directory, which is all that a name that is not a link needs
+                std::string link = path.size() == 1 ? path + name : path + "/" + name;
+                std::string target;
+                if ( !read_link( link, target ) )
+                {
+                    exists = errno == EINVAL;
+                    path.swap( link );
+                    return true;
+                }
+
+                exists = true;
+                std::unordered_map< std::string, std::pair< bool, std::string > >::iterator it = seen.find( link );
+                if ( it != seen.end() )
+                {
+                    if ( !it->second.first )
+                    {
+                        path.swap( link );
+                        return false;
+                    }
+                    path = it->second.second;
+                    return true;
+                }
+
+                seen[link] = std::make_pair( false, std::string() );
+                if ( !join( target ) ) return false;
+                seen[link] = std::make_pair( true, path );
+                return true;
+            }
+
+            // Append the components of rest, which restarts from the root if it is absolute
+            bool join( const std::string & rest )
+            {
+                if ( !rest.empty() && rest[0] == '/' ) path = "/";
+
+                bool exists;
+                for ( std::size_t i = 0; i <= rest.size(); )
+                {
+                    std::size_t end = std::min( rest.find( '/', i ), rest.size() );
+                    if ( !step( rest.substr( i, end - i ), exists ) )
+                    {
+                        if ( end < rest.size() ) path.append( 1, '/' ).append( rest, end + 1, std::string::npos );
+                        return false;
+                    }
+                    i = end + 1;
+                }
+                return true;
+            }
+
+            std::string path;
+            std::unordered_map< std::string, std::pair< bool, std::string > > seen;
+        };
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::string realpath( const std::string & path )
+    {
+        return RealpathCache::resolve( path, 0 );
+    }
+
+#ifdef _WIN32
+    std::string RealpathCache::resolve( const std::string & path, RealpathCache * )
+    {
+        char full[MAX_PATH];
+        std::string result = _fullpath( full, path.c_str(), MAX_PATH ) ? std::string( full ) : path;
+
+        HANDLE handle = CreateFileA( result.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                     OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+        if ( handle == INVALID_HANDLE_VALUE ) return result;
+
+        char final_path[MAX_PATH];
+        DWORD n = GetFinalPathNameByHandleA( handle, final_path, MAX_PATH, FILE_NAME_NORMALIZED );
+        CloseHandle( handle );
+        if ( n == 0 || n >= MAX_PATH ) return result;
+
+        // The final path comes with the prefix of the long path syntax
+        result.assign( final_path, n );
+        if ( result.compare( 0, 8, "\\\\?\\UNC\\" ) == 0 ) return "\\" + result.substr( 7 );
+        if ( result.compare( 0, 4, "\\\\?\\" ) == 0 ) return result.substr( 4 );
+        return result;
+    }
+#else
+    std::string RealpathCache::resolve( const std::string & path, RealpathCache * cache )
+    {
+        std::string full = !path.empty() && path[0] == '/' ? path : getcwd() + "/" + path;
+
+        // The names of the path, and the path written cleanly up to each of them, which keys
+        // the cache up to the first ".."
+        std::vector< std::string > names;
+        std::string clean;
+        std::vector< std::size_t > ends( 1, 1 );
+        std::size_t up = std::string::npos;
+        for ( std::size_t i = 0; i <= full.size(); )
+        {
+            std::size_t end = std::min( full.find( '/', i ), full.size() );
+            if ( end > i && !( end - i == 1 && full[i] == '.' ) )
+            {
+                names.push_back( full.substr( i, end - i ) );
+                if ( up == std::string::npos && names.back() == ".." ) up = names.size() - 1;
+                clean.append( 1, '/' ).append( names.back() );
+                ends.push_back( clean.size() );
+            }
+            i = end + 1;
+        }
+        std::size_t count = names.size(), cacheable = std::min( up, count );
+
+        Resolver resolver;
+        std::size_t start = 0;
+        if ( cache )
+        {
+            // The deepest directory already resolved
+            for ( std::size_t j = std::min( cacheable, count ? count - 1 : 0 ); j > 0; --j )
+            {
+                if ( cache->m_map.lookup( clean.substr( 0, ends[j] ), resolver.path ) )
+                {
+                    start = j;
+                    break;
+                }
+            }
+        }
+
+        std::string before;
+        for ( std::size_t i = start; i < count; ++i )
+        {
+            bool keep = cache && i > start && i <= cacheable, exists;
+            if ( keep ) before = resolver.path;
+            if ( !resolver.step( names[i], exists ) )
+            {
+                for ( std::size_t j = i + 1; j < count; ++j ) resolver.path.append( 1, '/' ).append( names[j] );
+                return os::path::normpath_posix( resolver.path );
+            }
+            if ( keep && exists ) cache->m_map.store( clean.substr( 0, ends[i] ), before );
+        }
+        return resolver.path;
+    }
+#endif
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    RealpathCache::RealpathCache( double ttl, std::size_t max_entries, unsigned int shards ) : m_map( ttl, max_entries, shards )
+    {
+    }
+
+    std::string RealpathCache::realpath( const std::string & path )
+    {
+        return resolve( path, this );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void RealpathCache::invalidate_tree( const std::string & path )
+    {
+        // Keys are written as resolve() cleans the path, so the prefix is cleaned the same way
+#ifdef _WIN32
+        std::string prefix = os::path::normpath_posix( path );
+#else
+        std::string prefix = os::path::normpath_posix( !path.empty() && path[0] == '/' ? path : getcwd() + "/" + path );
+#endif
+        if ( prefix.empty() || prefix[prefix.size() - 1] != '/' ) prefix += '/';
+
+        m_map.erase_if( [&]( const std::string & key )
+        {
+            return key.size() + 1 == prefix.size() ? prefix.compare( 0, key.size(), key ) == 0 : key.compare( 0, prefix.size(), prefix ) == 0;
+        } );
+    }
+
+    RealpathCache::Stats RealpathCache::stats() const
+    {
+        return m_map.stats();
+    }
+
+    void RealpathCache::clear()
+    {
+        m_map.clear();
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
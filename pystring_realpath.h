@@ -0,0 +1,88 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_REALPATH_H
+#define INCLUDED_PYSTRING_REALPATH_H
+
+#include "pystring_cachemap.h"
+
+#include <cstddef>
+#include <string>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the canonical path of path, with its symbolic links resolved, as python's
+    /// os.path.realpath() does: relative paths are made absolute against the working directory,
+    /// ".." goes up from what the path before it resolves to, and the components that do not
+    /// exist are kept as they are. A loop of symbolic links stops the resolution at the link
+    /// that closes it, and the rest of the path is appended to it.
+    ///
+    /// Each component is looked up with a single readlinkat(), which tells a link from a name
+    /// that is not one without an lstat() first.
+    ///
+    /// NOTE: On Windows the system resolves the path whole, and RealpathCache does not cache
+    /// it.
+    ///
+    std::string realpath( const std::string & path );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Bounded cache of the resolved directories of realpath(), for programs that
+    /// resolve many paths under the same trees of symbolic links. realpath() returns exactly
+    /// what the uncached function does.
+    ///
+    /// The cache maps each directory of a path, as it is written before the first "..", to
+    /// what it resolves to: resolving a file resolves only the components after the deepest
+    /// directory already cached, so the files of a directory share the resolution of their
+    /// parents. A directory is only cached once a name has been found in it.
+    ///
+    /// An entry older than ttl seconds is resolved again; a ttl of 0 keeps entries until they
+    /// are invalidated or evicted. invalidate_tree() drops the directories written under path,
+    /// which are the ones a change to a link there can affect when the paths are written
+    /// through it; clear() the cache after changing links reached some other way. As in
+    /// StatCache, entries beyond max_entries are evicted in CLOCK order.
+    ///
+    class RealpathCache
+    {
+    public:
+        typedef CacheStats Stats;
+
+        explicit RealpathCache( double ttl = 0.0, std::size_t max_entries = 1 << 18, unsigned int shards = 16 );
+
+        std::string realpath( const std::string & path );
+
+        void invalidate_tree( const std::string & path );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the counters and the current number of entries summed over all shards.
+        ///
+        Stats stats() const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Drop every entry and reset the counters.
+        ///
+        void clear();
+
+    private:
+        RealpathCache( const RealpathCache & );
+        RealpathCache & operator=( const RealpathCache & );
+
+        friend std::string os::path::realpath( const std::string & path );
+
+        static std::string resolve( const std::string & path, RealpathCache * cache );
+
+        detail::CacheMap< std::string > m_map;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
@@ -0,0 +1,1186 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_simd.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PYSTRING_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and clang only generate vector instructions in functions marked for them;
+// MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define PYSTRING_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PYSTRING_TARGET(isa)
+#endif
+
+namespace pystring
+{
+namespace simd
+{
+
+    namespace
+    {
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Scalar kernels, the reference for the vector ones and their fallback for non ASCII
+        /// blocks and tails.
+        ///
+        bool in_class( char c, CharClass cls )
+        {
+            switch ( cls )
+            {
+                case ALNUM: return ::isalnum( c ) != 0;
+                case ALPHA: return ::isalpha( c ) != 0;
+                case DIGIT: return ::isdigit( c ) != 0;
+                case LOWER: return ::islower( c ) != 0;
+                case SPACE: return ::isspace( c ) != 0;
+                case UPPER: return ::isupper( c ) != 0;
+            }
+            return false;
+        }
+
+        // memchr is usually vectorized by the C library, which keeps the scalar search on par
+        // with std::string::find on machines without vector kernels
+        std::size_t find_byte_scalar( const char * s, std::size_t n, char c )
+        {
+            const void * p = n ? std::memchr( s, c, n ) : 0;
+            return p ? (std::size_t) ( (const char *) p - s ) : n;
+        }
+
+        std::size_t find_scalar( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            std::size_t i = 0, starts = n - m + 1;
+            while ( i < starts )
+            {
+                i += find_byte_scalar( s + i, starts - i, needle[0] );
+                if ( i == starts ) break;
+                if ( std::memcmp( s + i, needle, m ) == 0 ) return i;
+                ++i;
+            }
+            return n;
+        }
+
+        std::size_t span_scalar( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( in_class( s[i], cls ) != match ) return i;
+            }
+            return n;
+        }
+
+        void lower_scalar( char * s, std::size_t n )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( ::isupper( s[i] ) ) s[i] = (char) ::tolower( s[i] );
+            }
+        }
+
+        void upper_scalar( char * s, std::size_t n )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( ::islower( s[i] ) ) s[i] = (char) ::toupper( s[i] );
+            }
+        }
+
+        std::size_t ascii_scalar( const char * s, std::size_t n )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( (unsigned char) s[i] > 0x7f ) return i;
+            }
+            return n;
+        }
+
+        // Case folding for the case insensitive kernels is ASCII only and ignores the locale,
+        // so it gives the same answer for every instruction set
+        inline char fold( char c )
+        {
+            return ( c >= 'A' && c <= 'Z' ) ? (char) ( c | 0x20 ) : c;
+        }
+
+        std::size_t imismatch_scalar( const char * a, const char * b, std::size_t n )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( fold( a[i] ) != fold( b[i] ) ) return i;
+            }
+            return n;
+        }
+
+        std::size_t ifind_scalar( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            char first = fold( needle[0] );
+            for ( std::size_t i = 0, starts = n - m + 1; i < starts; ++i )
+            {
+                if ( fold( s[i] ) == first && imismatch_scalar( s + i + 1, needle + 1, m - 1 ) == m - 1 ) return i;
+            }
+            return n;
+        }
+
+        std::size_t rfind_scalar( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            for ( std::size_t i = n - m + 1; i-- > 0; )
+            {
+                if ( s[i] == needle[0] && std::memcmp( s + i, needle, m ) == 0 ) return i;
+            }
+            return n;
+        }
+
+        std::size_t rspan_scalar( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            for ( std::size_t i = n; i > 0; --i )
+            {
+                if ( in_class( s[i - 1], cls ) != match ) return i;
+            }
+            return 0;
+        }
+
+        std::size_t mismatch_scalar( const char * a, const char * b, std::size_t n )
+        {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( a[i] != b[i] ) return i;
+            }
+            return n;
+        }
+
+        const Kernels scalar_kernels = { find_byte_scalar, find_scalar, span_scalar, lower_scalar, upper_scalar,
+                                         ascii_scalar, imismatch_scalar, ifind_scalar, rfind_scalar, rspan_scalar,
+                                         mismatch_scalar };
+
+#ifdef PYSTRING_SIMD_X86
+
+        inline unsigned int lowest_bit( unsigned long long mask )
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward64( &index, mask );
+            return (unsigned int) index;
+#else
+            return (unsigned int) __builtin_ctzll( mask );
+#endif
+        }
+
+        inline unsigned int highest_bit( unsigned long long mask )
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanReverse64( &index, mask );
+            return (unsigned int) index;
+#else
+            return (unsigned int) ( 63 - __builtin_clzll( mask ) );
+#endif
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// SSE2, 16 bytes at a time. Every kernel follows the same pattern: a block of bytes
+        /// is compared at once into a bit mask with one bit per byte, and the position comes
+        /// from its lowest set bit. Bytes above 0x7f are negative as signed chars, so range
+        /// tests on ASCII can use the signed compares.
+        ///
+        PYSTRING_TARGET("sse2") inline __m128i range_sse2( __m128i x, char lo, char hi )
+        {
+            return _mm_and_si128( _mm_cmpgt_epi8( x, _mm_set1_epi8( (char) ( lo - 1 ) ) ),
+                                  _mm_cmpgt_epi8( _mm_set1_epi8( (char) ( hi + 1 ) ), x ) );
+        }
+
+        PYSTRING_TARGET("sse2") inline __m128i class_sse2( __m128i x, CharClass cls )
+        {
+            // Setting bit 5 folds upper case letters onto lower case ones
+            switch ( cls )
+            {
+                case ALNUM: return _mm_or_si128( range_sse2( _mm_or_si128( x, _mm_set1_epi8( 0x20 ) ), 'a', 'z' ),
+                                                 range_sse2( x, '0', '9' ) );
+                case ALPHA: return range_sse2( _mm_or_si128( x, _mm_set1_epi8( 0x20 ) ), 'a', 'z' );
+                case DIGIT: return range_sse2( x, '0', '9' );
+                case LOWER: return range_sse2( x, 'a', 'z' );
+                case UPPER: return range_sse2( x, 'A', 'Z' );
+                case SPACE: break;
+            }
+            return _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( ' ' ) ), range_sse2( x, '\t', '\r' ) );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t find_byte_sse2( const char * s, std::size_t n, char c )
+        {
+            const __m128i value = _mm_set1_epi8( c );
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                unsigned int mask = (unsigned int) _mm_movemask_epi8( _mm_cmpeq_epi8( x, value ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + find_byte_scalar( s + i, n - i, c );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t find_sse2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m == 1 ) return find_byte_sse2( s, n, needle[0] );
+            if ( m > n ) return n;
+
+            // Candidates must match both the first and the last byte of the needle before the
+            // rest is compared
+            const __m128i first = _mm_set1_epi8( needle[0] );
+            const __m128i last = _mm_set1_epi8( needle[m - 1] );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 16 <= starts; i += 16 )
+            {
+                __m128i a = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                __m128i b = _mm_loadu_si128( (const __m128i *) ( s + i + m - 1 ) );
+                unsigned int mask = (unsigned int) _mm_movemask_epi8(
+                    _mm_and_si128( _mm_cmpeq_epi8( a, first ), _mm_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            return i + find_scalar( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t span_sse2( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                if ( _mm_movemask_epi8( x ) )
+                {
+                    std::size_t k = span_scalar( s + i, 16, cls, match );
+                    if ( k < 16 ) return i + k;
+                    continue;
+                }
+
+                unsigned int in = (unsigned int) _mm_movemask_epi8( class_sse2( x, cls ) );
+                unsigned int stop = match ? ( ~in & 0xffffu ) : in;
+                if ( stop ) return i + lowest_bit( stop );
+            }
+            return i + span_scalar( s + i, n - i, cls, match );
+        }
+
+        PYSTRING_TARGET("sse2") void lower_sse2( char * s, std::size_t n )
+        {
+            const __m128i bit5 = _mm_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                if ( _mm_movemask_epi8( x ) )
+                {
+                    lower_scalar( s + i, 16 );
+                    continue;
+                }
+                x = _mm_or_si128( x, _mm_and_si128( range_sse2( x, 'A', 'Z' ), bit5 ) );
+                _mm_storeu_si128( (__m128i *) ( s + i ), x );
+            }
+            lower_scalar( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("sse2") void upper_sse2( char * s, std::size_t n )
+        {
+            const __m128i bit5 = _mm_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                if ( _mm_movemask_epi8( x ) )
+                {
+                    upper_scalar( s + i, 16 );
+                    continue;
+                }
+                x = _mm_andnot_si128( _mm_and_si128( range_sse2( x, 'a', 'z' ), bit5 ), x );
+                _mm_storeu_si128( (__m128i *) ( s + i ), x );
+            }
+            upper_scalar( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t ascii_sse2( const char * s, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                unsigned int mask = (unsigned int) _mm_movemask_epi8( _mm_loadu_si128( (const __m128i *) ( s + i ) ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + ascii_scalar( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("sse2") inline __m128i fold_sse2( __m128i x )
+        {
+            return _mm_or_si128( x, _mm_and_si128( range_sse2( x, 'A', 'Z' ), _mm_set1_epi8( 0x20 ) ) );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t imismatch_sse2( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = fold_sse2( _mm_loadu_si128( (const __m128i *) ( a + i ) ) );
+                __m128i y = fold_sse2( _mm_loadu_si128( (const __m128i *) ( b + i ) ) );
+                unsigned int mask = ~(unsigned int) _mm_movemask_epi8( _mm_cmpeq_epi8( x, y ) ) & 0xffffu;
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + imismatch_scalar( a + i, b + i, n - i );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t ifind_sse2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            // find_sse2 with both sides folded
+            const __m128i first = _mm_set1_epi8( fold( needle[0] ) );
+            const __m128i last = _mm_set1_epi8( fold( needle[m - 1] ) );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 16 <= starts; i += 16 )
+            {
+                __m128i a = fold_sse2( _mm_loadu_si128( (const __m128i *) ( s + i ) ) );
+                __m128i b = fold_sse2( _mm_loadu_si128( (const __m128i *) ( s + i + m - 1 ) ) );
+                unsigned int mask = (unsigned int) _mm_movemask_epi8(
+                    _mm_and_si128( _mm_cmpeq_epi8( a, first ), _mm_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( m <= 2 || imismatch_sse2( s + i + bit + 1, needle + 1, m - 2 ) == m - 2 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            return i + ifind_scalar( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t rfind_sse2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            // find_sse2 run backwards: blocks of candidate starts from the end, and the highest
+            // candidate of a block first
+            const __m128i first = _mm_set1_epi8( needle[0] );
+            const __m128i last = _mm_set1_epi8( needle[m - 1] );
+            std::size_t i = n - m + 1;
+            while ( i >= 16 )
+            {
+                i -= 16;
+                __m128i a = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                __m128i b = _mm_loadu_si128( (const __m128i *) ( s + i + m - 1 ) );
+                unsigned int mask = (unsigned int) _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( a, first ), _mm_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = highest_bit( mask );
+                    if ( m <= 2 || std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= ~( 1u << bit );
+                }
+            }
+
+            // What is left are the starts before i, which all fit in s[0, i + m - 1)
+            std::size_t result = rfind_scalar( s, i + m - 1, needle, m );
+            return result == i + m - 1 ? n : result;
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t rspan_sse2( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = n;
+            while ( i >= 16 )
+            {
+                i -= 16;
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( s + i ) );
+                if ( _mm_movemask_epi8( x ) )
+                {
+                    std::size_t k = rspan_scalar( s + i, 16, cls, match );
+                    if ( k > 0 ) return i + k;
+                    continue;
+                }
+
+                unsigned int in = (unsigned int) _mm_movemask_epi8( class_sse2( x, cls ) );
+                unsigned int stop = match ? ( ~in & 0xffffu ) : in;
+                if ( stop ) return i + highest_bit( stop ) + 1;
+            }
+            return rspan_scalar( s, i, cls, match );
+        }
+
+        PYSTRING_TARGET("sse2") std::size_t mismatch_sse2( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 16 <= n; i += 16 )
+            {
+                __m128i x = _mm_loadu_si128( (const __m128i *) ( a + i ) );
+                __m128i y = _mm_loadu_si128( (const __m128i *) ( b + i ) );
+                unsigned int mask = ~(unsigned int) _mm_movemask_epi8( _mm_cmpeq_epi8( x, y ) ) & 0xffffu;
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + mismatch_scalar( a + i, b + i, n - i );
+        }
+
+        const Kernels sse2_kernels = { find_byte_sse2, find_sse2, span_sse2, lower_sse2, upper_sse2,
+                                       ascii_sse2, imismatch_sse2, ifind_sse2, rfind_sse2, rspan_sse2,
+                                       mismatch_sse2 };
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// AVX2, the SSE2 kernels on 32 bytes. Tails shorter than a block go to the SSE2 ones,
+        /// after clearing the upper halves of the registers: the compiler does not do it before
+        /// calls, and running SSE code with them dirty costs far more than the tail itself.
+        ///
+        PYSTRING_TARGET("avx2") inline __m256i range_avx2( __m256i x, char lo, char hi )
+        {
+            return _mm256_and_si256( _mm256_cmpgt_epi8( x, _mm256_set1_epi8( (char) ( lo - 1 ) ) ),
+                                     _mm256_cmpgt_epi8( _mm256_set1_epi8( (char) ( hi + 1 ) ), x ) );
+        }
+
+        PYSTRING_TARGET("avx2") inline __m256i class_avx2( __m256i x, CharClass cls )
+        {
+            switch ( cls )
+            {
+                case ALNUM: return _mm256_or_si256( range_avx2( _mm256_or_si256( x, _mm256_set1_epi8( 0x20 ) ), 'a', 'z' ),
+                                                    range_avx2( x, '0', '9' ) );
+                case ALPHA: return range_avx2( _mm256_or_si256( x, _mm256_set1_epi8( 0x20 ) ), 'a', 'z' );
+                case DIGIT: return range_avx2( x, '0', '9' );
+                case LOWER: return range_avx2( x, 'a', 'z' );
+                case UPPER: return range_avx2( x, 'A', 'Z' );
+                case SPACE: break;
+            }
+            return _mm256_or_si256( _mm256_cmpeq_epi8( x, _mm256_set1_epi8( ' ' ) ), range_avx2( x, '\t', '\r' ) );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t find_byte_avx2( const char * s, std::size_t n, char c )
+        {
+            const __m256i value = _mm256_set1_epi8( c );
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8( _mm256_cmpeq_epi8( x, value ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            _mm256_zeroupper();
+            return i + find_byte_sse2( s + i, n - i, c );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t find_avx2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m == 1 ) return find_byte_avx2( s, n, needle[0] );
+            if ( m > n ) return n;
+
+            const __m256i first = _mm256_set1_epi8( needle[0] );
+            const __m256i last = _mm256_set1_epi8( needle[m - 1] );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 32 <= starts; i += 32 )
+            {
+                __m256i a = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                __m256i b = _mm256_loadu_si256( (const __m256i *) ( s + i + m - 1 ) );
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+                    _mm256_and_si256( _mm256_cmpeq_epi8( a, first ), _mm256_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            _mm256_zeroupper();
+            return i + find_sse2( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t span_avx2( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                if ( _mm256_movemask_epi8( x ) )
+                {
+                    std::size_t k = span_scalar( s + i, 32, cls, match );
+                    if ( k < 32 ) return i + k;
+                    continue;
+                }
+
+                unsigned int in = (unsigned int) _mm256_movemask_epi8( class_avx2( x, cls ) );
+                unsigned int stop = match ? ~in : in;
+                if ( stop ) return i + lowest_bit( stop );
+            }
+            _mm256_zeroupper();
+            return i + span_sse2( s + i, n - i, cls, match );
+        }
+
+        PYSTRING_TARGET("avx2") void lower_avx2( char * s, std::size_t n )
+        {
+            const __m256i bit5 = _mm256_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                if ( _mm256_movemask_epi8( x ) )
+                {
+                    lower_scalar( s + i, 32 );
+                    continue;
+                }
+                x = _mm256_or_si256( x, _mm256_and_si256( range_avx2( x, 'A', 'Z' ), bit5 ) );
+                _mm256_storeu_si256( (__m256i *) ( s + i ), x );
+            }
+            _mm256_zeroupper();
+            lower_sse2( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("avx2") void upper_avx2( char * s, std::size_t n )
+        {
+            const __m256i bit5 = _mm256_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                if ( _mm256_movemask_epi8( x ) )
+                {
+                    upper_scalar( s + i, 32 );
+                    continue;
+                }
+                x = _mm256_andnot_si256( _mm256_and_si256( range_avx2( x, 'a', 'z' ), bit5 ), x );
+                _mm256_storeu_si256( (__m256i *) ( s + i ), x );
+            }
+            _mm256_zeroupper();
+            upper_sse2( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t ascii_avx2( const char * s, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8( _mm256_loadu_si256( (const __m256i *) ( s + i ) ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            _mm256_zeroupper();
+            return i + ascii_sse2( s + i, n - i );
+        }
+
+        PYSTRING_TARGET("avx2") inline __m256i fold_avx2( __m256i x )
+        {
+            return _mm256_or_si256( x, _mm256_and_si256( range_avx2( x, 'A', 'Z' ), _mm256_set1_epi8( 0x20 ) ) );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t imismatch_avx2( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = fold_avx2( _mm256_loadu_si256( (const __m256i *) ( a + i ) ) );
+                __m256i y = fold_avx2( _mm256_loadu_si256( (const __m256i *) ( b + i ) ) );
+                unsigned int mask = ~(unsigned int) _mm256_movemask_epi8( _mm256_cmpeq_epi8( x, y ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            _mm256_zeroupper();
+            return i + imismatch_sse2( a + i, b + i, n - i );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t ifind_avx2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            const __m256i first = _mm256_set1_epi8( fold( needle[0] ) );
+            const __m256i last = _mm256_set1_epi8( fold( needle[m - 1] ) );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 32 <= starts; i += 32 )
+            {
+                __m256i a = fold_avx2( _mm256_loadu_si256( (const __m256i *) ( s + i ) ) );
+                __m256i b = fold_avx2( _mm256_loadu_si256( (const __m256i *) ( s + i + m - 1 ) ) );
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+                    _mm256_and_si256( _mm256_cmpeq_epi8( a, first ), _mm256_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( m <= 2 || imismatch_avx2( s + i + bit + 1, needle + 1, m - 2 ) == m - 2 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            _mm256_zeroupper();
+            return i + ifind_sse2( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t rfind_avx2( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            const __m256i first = _mm256_set1_epi8( needle[0] );
+            const __m256i last = _mm256_set1_epi8( needle[m - 1] );
+            std::size_t i = n - m + 1;
+            while ( i >= 32 )
+            {
+                i -= 32;
+                __m256i a = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                __m256i b = _mm256_loadu_si256( (const __m256i *) ( s + i + m - 1 ) );
+                unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+                    _mm256_and_si256( _mm256_cmpeq_epi8( a, first ), _mm256_cmpeq_epi8( b, last ) ) );
+                while ( mask )
+                {
+                    unsigned int bit = highest_bit( mask );
+                    if ( m <= 2 || std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= ~( 1u << bit );
+                }
+            }
+
+            _mm256_zeroupper();
+            std::size_t result = rfind_sse2( s, i + m - 1, needle, m );
+            return result == i + m - 1 ? n : result;
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t rspan_avx2( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = n;
+            while ( i >= 32 )
+            {
+                i -= 32;
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( s + i ) );
+                if ( _mm256_movemask_epi8( x ) )
+                {
+                    std::size_t k = rspan_scalar( s + i, 32, cls, match );
+                    if ( k > 0 ) return i + k;
+                    continue;
+                }
+
+                unsigned int in = (unsigned int) _mm256_movemask_epi8( class_avx2( x, cls ) );
+                unsigned int stop = match ? ~in : in;
+                if ( stop ) return i + highest_bit( stop ) + 1;
+            }
+            _mm256_zeroupper();
+            return rspan_sse2( s, i, cls, match );
+        }
+
+        PYSTRING_TARGET("avx2") std::size_t mismatch_avx2( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 32 <= n; i += 32 )
+            {
+                __m256i x = _mm256_loadu_si256( (const __m256i *) ( a + i ) );
+                __m256i y = _mm256_loadu_si256( (const __m256i *) ( b + i ) );
+                unsigned int mask = ~(unsigned int) _mm256_movemask_epi8( _mm256_cmpeq_epi8( x, y ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            _mm256_zeroupper();
+            return i + mismatch_sse2( a + i, b + i, n - i );
+        }
+
+        const Kernels avx2_kernels = { find_byte_avx2, find_avx2, span_avx2, lower_avx2, upper_avx2,
+                                       ascii_avx2, imismatch_avx2, ifind_avx2, rfind_avx2, rspan_avx2,
+                                       mismatch_avx2 };
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// AVX-512 (F and BW), 64 bytes at a time. Compares produce the bit masks directly, and
+        /// the unsigned byte compares make the range tests simpler.
+        ///
+#define PYSTRING_AVX512 PYSTRING_TARGET("avx512f,avx512bw")
+
+        PYSTRING_AVX512 inline __mmask64 range_avx512( __m512i x, char lo, char hi )
+        {
+            return _mm512_cmpge_epu8_mask( x, _mm512_set1_epi8( lo ) ) & _mm512_cmple_epu8_mask( x, _mm512_set1_epi8( hi ) );
+        }
+
+        PYSTRING_AVX512 inline __mmask64 class_avx512( __m512i x, CharClass cls )
+        {
+            switch ( cls )
+            {
+                case ALNUM: return range_avx512( _mm512_or_si512( x, _mm512_set1_epi8( 0x20 ) ), 'a', 'z' ) |
+                                   range_avx512( x, '0', '9' );
+                case ALPHA: return range_avx512( _mm512_or_si512( x, _mm512_set1_epi8( 0x20 ) ), 'a', 'z' );
+                case DIGIT: return range_avx512( x, '0', '9' );
+                case LOWER: return range_avx512( x, 'a', 'z' );
+                case UPPER: return range_avx512( x, 'A', 'Z' );
+                case SPACE: break;
+            }
+            return _mm512_cmpeq_epi8_mask( x, _mm512_set1_epi8( ' ' ) ) | range_avx512( x, '\t', '\r' );
+        }
+
+        PYSTRING_AVX512 std::size_t find_byte_avx512( const char * s, std::size_t n, char c )
+        {
+            const __m512i value = _mm512_set1_epi8( c );
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = _mm512_loadu_si512( (const void *) ( s + i ) );
+                unsigned long long mask = _mm512_cmpeq_epi8_mask( x, value );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + find_byte_avx2( s + i, n - i, c );
+        }
+
+        PYSTRING_AVX512 std::size_t find_avx512( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m == 1 ) return find_byte_avx512( s, n, needle[0] );
+            if ( m > n ) return n;
+
+            const __m512i first = _mm512_set1_epi8( needle[0] );
+            const __m512i last = _mm512_set1_epi8( needle[m - 1] );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 64 <= starts; i += 64 )
+            {
+                __m512i a = _mm512_loadu_si512( (const void *) ( s + i ) );
+                __m512i b = _mm512_loadu_si512( (const void *) ( s + i + m - 1 ) );
+                unsigned long long mask = _mm512_cmpeq_epi8_mask( a, first ) & _mm512_cmpeq_epi8_mask( b, last );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            return i + find_avx2( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_AVX512 std::size_t span_avx512( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = _mm512_loadu_si512( (const void *) ( s + i ) );
+                if ( _mm512_movepi8_mask( x ) )
+                {
+                    std::size_t k = span_scalar( s + i, 64, cls, match );
+                    if ( k < 64 ) return i + k;
+                    continue;
+                }
+
+                unsigned long long in = class_avx512( x, cls );
+                unsigned long long stop = match ? ~in : in;
+                if ( stop ) return i + lowest_bit( stop );
+            }
+            return i + span_avx2( s + i, n - i, cls, match );
+        }
+
+        PYSTRING_AVX512 void lower_avx512( char * s, std::size_t n )
+        {
+            const __m512i bit5 = _mm512_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = _mm512_loadu_si512( (const void *) ( s + i ) );
+                if ( _mm512_movepi8_mask( x ) )
+                {
+                    lower_scalar( s + i, 64 );
+                    continue;
+                }
+                x = _mm512_mask_add_epi8( x, range_avx512( x, 'A', 'Z' ), x, bit5 );
+                _mm512_storeu_si512( (void *) ( s + i ), x );
+            }
+            lower_avx2( s + i, n - i );
+        }
+
+        PYSTRING_AVX512 void upper_avx512( char * s, std::size_t n )
+        {
+            const __m512i bit5 = _mm512_set1_epi8( 0x20 );
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = _mm512_loadu_si512( (const void *) ( s + i ) );
+                if ( _mm512_movepi8_mask( x ) )
+                {
+                    upper_scalar( s + i, 64 );
+                    continue;
+                }
+                x = _mm512_mask_sub_epi8( x, range_avx512( x, 'a', 'z' ), x, bit5 );
+                _mm512_storeu_si512( (void *) ( s + i ), x );
+            }
+            upper_avx2( s + i, n - i );
+        }
+
+        PYSTRING_AVX512 std::size_t ascii_avx512( const char * s, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                unsigned long long mask = _mm512_movepi8_mask( _mm512_loadu_si512( (const void *) ( s + i ) ) );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + ascii_avx2( s + i, n - i );
+        }
+
+        PYSTRING_AVX512 inline __m512i fold_avx512( __m512i x )
+        {
+            return _mm512_mask_add_epi8( x, range_avx512( x, 'A', 'Z' ), x, _mm512_set1_epi8( 0x20 ) );
+        }
+
+        PYSTRING_AVX512 std::size_t imismatch_avx512( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = fold_avx512( _mm512_loadu_si512( (const void *) ( a + i ) ) );
+                __m512i y = fold_avx512( _mm512_loadu_si512( (const void *) ( b + i ) ) );
+                unsigned long long mask = _mm512_cmpneq_epi8_mask( x, y );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + imismatch_avx2( a + i, b + i, n - i );
+        }
+
+        PYSTRING_AVX512 std::size_t ifind_avx512( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            const __m512i first = _mm512_set1_epi8( fold( needle[0] ) );
+            const __m512i last = _mm512_set1_epi8( fold( needle[m - 1] ) );
+            std::size_t i = 0, starts = n - m + 1;
+            for ( ; i + 64 <= starts; i += 64 )
+            {
+                __m512i a = fold_avx512( _mm512_loadu_si512( (const void *) ( s + i ) ) );
+                __m512i b = fold_avx512( _mm512_loadu_si512( (const void *) ( s + i + m - 1 ) ) );
+                unsigned long long mask = _mm512_cmpeq_epi8_mask( a, first ) & _mm512_cmpeq_epi8_mask( b, last );
+                while ( mask )
+                {
+                    unsigned int bit = lowest_bit( mask );
+                    if ( m <= 2 || imismatch_avx512( s + i + bit + 1, needle + 1, m - 2 ) == m - 2 ) return i + bit;
+                    mask &= mask - 1;
+                }
+            }
+            return i + ifind_avx2( s + i, n - i, needle, m );
+        }
+
+        PYSTRING_AVX512 std::size_t rfind_avx512( const char * s, std::size_t n, const char * needle, std::size_t m )
+        {
+            if ( m > n ) return n;
+
+            const __m512i first = _mm512_set1_epi8( needle[0] );
+            const __m512i last = _mm512_set1_epi8( needle[m - 1] );
+            std::size_t i = n - m + 1;
+            while ( i >= 64 )
+            {
+                i -= 64;
+                __m512i a = _mm512_loadu_si512( (const void *) ( s + i ) );
+                __m512i b = _mm512_loadu_si512( (const void *) ( s + i + m - 1 ) );
+                unsigned long long mask = _mm512_cmpeq_epi8_mask( a, first ) & _mm512_cmpeq_epi8_mask( b, last );
+                while ( mask )
+                {
+                    unsigned int bit = highest_bit( mask );
+                    if ( m <= 2 || std::memcmp( s + i + bit + 1, needle + 1, m - 2 ) == 0 ) return i + bit;
+                    mask &= ~( 1ULL << bit );
+                }
+            }
+
+            std::size_t result = rfind_avx2( s, i + m - 1, needle, m );
+            return result == i + m - 1 ? n : result;
+        }
+
+        PYSTRING_AVX512 std::size_t rspan_avx512( const char * s, std::size_t n, CharClass cls, bool match )
+        {
+            std::size_t i = n;
+            while ( i >= 64 )
+            {
+                i -= 64;
+                __m512i x = _mm512_loadu_si512( (const void *) ( s + i ) );
+                if ( _mm512_movepi8_mask( x ) )
+                {
+                    std::size_t k = rspan_scalar( s + i, 64, cls, match );
+                    if ( k > 0 ) return i + k;
+                    continue;
+                }
+
+                unsigned long long in = class_avx512( x, cls );
+                unsigned long long stop = match ? ~in : in;
+                if ( stop ) return i + highest_bit( stop ) + 1;
+            }
+            return rspan_avx2( s, i, cls, match );
+        }
+
+        PYSTRING_AVX512 std::size_t mismatch_avx512( const char * a, const char * b, std::size_t n )
+        {
+            std::size_t i = 0;
+            for ( ; i + 64 <= n; i += 64 )
+            {
+                __m512i x = _mm512_loadu_si512( (const void *) ( a + i ) );
+                __m512i y = _mm512_loadu_si512( (const void *) ( b + i ) );
+                unsigned long long mask = _mm512_cmpneq_epi8_mask( x, y );
+                if ( mask ) return i + lowest_bit( mask );
+            }
+            return i + mismatch_avx2( a + i, b + i, n - i );
+        }
+
+#undef PYSTRING_AVX512
+
+        const Kernels avx512_kernels = { find_byte_avx512, find_avx512, span_avx512, lower_avx512, upper_avx512,
+                                         ascii_avx512, imismatch_avx512, ifind_avx512, rfind_avx512, rspan_avx512,
+                                         mismatch_avx512 };
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// CPU detection. AVX and AVX-512 also need the OS to save their registers, which XCR0
+        /// tells.
+        ///
+        void cpuid( unsigned int leaf, unsigned int subleaf, unsigned int regs[4] )
+        {
+#if defined(_MSC_VER)
+            int r[4];
+            __cpuidex( r, (int) leaf, (int) subleaf );
+            for ( int i = 0; i < 4; ++i ) regs[i] = (unsigned int) r[i];
+#else
+            __cpuid_count( leaf, subleaf, regs[0], regs[1], regs[2], regs[3] );
+#endif
+        }
+
+        unsigned long long xgetbv0()
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return _xgetbv( 0 );
+#else
+            unsigned int eax, edx;
+            __asm__ __volatile__( "xgetbv" : "=a"( eax ), "=d"( edx ) : "c"( 0 ) );
+            return ( (unsigned long long) edx << 32 ) | eax;
+#endif
+        }
+
+        ISA detect_cpu()
+        {
+            unsigned int regs[4];
+            cpuid( 0, 0, regs );
+            unsigned int max_leaf = regs[0];
+
+            // SSE2 is part of x86-64
+            cpuid( 1, 0, regs );
+            bool osxsave = ( regs[2] >> 27 ) & 1, avx = ( regs[2] >> 28 ) & 1;
+            if ( max_leaf < 7 || !osxsave || !avx ) return SSE2;
+
+            unsigned long long xcr0 = xgetbv0();
+            if ( ( xcr0 & 0x6 ) != 0x6 ) return SSE2;
+
+            cpuid( 7, 0, regs );
+            if ( !( ( regs[1] >> 5 ) & 1 ) ) return SSE2;
+
+            bool avx512f = ( regs[1] >> 16 ) & 1, avx512bw = ( regs[1] >> 30 ) & 1;
+            if ( avx512f && avx512bw && ( xcr0 & 0xe0 ) == 0xe0 ) return AVX512;
+            return AVX2;
+        }
+
+#else
+
+        ISA detect_cpu()
+        {
+            return SCALAR;
+        }
+
+#endif // PYSTRING_SIMD_X86
+
+        const Kernels & table( ISA isa )
+        {
+            switch ( isa )
+            {
+#ifdef PYSTRING_SIMD_X86
+                case SSE2: return sse2_kernels;
+                case AVX2: return avx2_kernels;
+                case AVX512: return avx512_kernels;
+#endif
+                default: return scalar_kernels;
+            }
+        }
+
+        // The requested instruction set from PYSTRING_ISA, or the detected one
+        ISA requested()
+        {
+            const char * env = std::getenv( "PYSTRING_ISA" );
+            if ( env )
+            {
+                for ( int isa = SCALAR; isa <= AVX512; ++isa )
+                {
+                    if ( std::strcmp( env, name( (ISA) isa ) ) == 0 ) return (ISA) isa;
+                }
+            }
+            return detect();
+        }
+
+        std::atomic< const Kernels * > active_kernels( 0 );
+        std::atomic< int > active_isa( SCALAR );
+
+        // Bind the kernels at load time, so the first call does not pay for the detection
+        const ISA isa_at_load = select( requested() );
+
+        unsigned int next_random( unsigned int & state )
+        {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        }
+
+    } // anonymous namespace
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    ISA detect()
+    {
+        static const ISA isa = detect_cpu();
+        return isa;
+    }
+
+    ISA active()
+    {
+        kernels();
+        return (ISA) active_isa.load( std::memory_order_relaxed );
+    }
+
+    ISA select( ISA isa )
+    {
+        if ( isa > detect() ) isa = detect();
+        active_isa.store( isa, std::memory_order_relaxed );
+        active_kernels.store( &table( isa ), std::memory_order_release );
+        return isa;
+    }
+
+    const char * name( ISA isa )
+    {
+        switch ( isa )
+        {
+            case SCALAR: return "scalar";
+            case SSE2: return "sse2";
+            case AVX2: return "avx2";
+            case AVX512: return "avx512";
+        }
+        return "";
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    const Kernels & kernels()
+    {
+        // Only null when called from a static initializer that runs before ours
+        const Kernels * k = active_kernels.load( std::memory_order_acquire );
+        if ( !k )
+        {
+            select( requested() );
+            k = active_kernels.load( std::memory_order_acquire );
+        }
+        return *k;
+    }
+
+    const Kernels & kernels( ISA isa )
+    {
+        return table( isa > detect() ? detect() : isa );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    bool crosscheck( ISA isa, int rounds, unsigned int seed )
+    {
+        const Kernels & reference = scalar_kernels;
+        const Kernels & k = kernels( isa );
+
+        // Buffers mostly come from one alphabet so that long runs of a class and repeated
+        // needles are common, with a few bytes of other classes and above 0x7f mixed in
+        static const char * const alphabets[] = {
+            "abcdefghijklmnopqrstuvwxyz", "ABCDEFGHIJKLMNOPQRSTUVWXYZ", "0123456789", " \t\n\v\f\r",
+            "aZ0 \t/._-:\\", "ab", "abcXYZ019"
+        };
+        const int num_alphabets = (int) ( sizeof( alphabets ) / sizeof( alphabets[0] ) );
+
+        unsigned int state = seed;
+        std::string buffer, needle, a, b;
+
+        for ( int round = 0; round < rounds; ++round )
+        {
+            const char * alphabet = alphabets[next_random( state ) % num_alphabets];
+            std::size_t alphabet_size = std::strlen( alphabet );
+            unsigned int noise = 2 + next_random( state ) % 64;
+
+            std::size_t n = next_random( state ) % 300;
+            buffer.resize( n );
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                unsigned int r = next_random( state );
+                buffer[i] = ( r % noise == 0 ) ? (char) ( r >> 8 ) : alphabet[( r >> 8 ) % alphabet_size];
+            }
+
+            char c = alphabet[next_random( state ) % alphabet_size];
+            if ( k.find_byte( buffer.data(), n, c ) != reference.find_byte( buffer.data(), n, c ) ) return false;
+
+            std::size_t m = 1 + next_random( state ) % 8;
+            if ( m <= n && next_random( state ) % 2 )
+            {
+                needle.assign( buffer, next_random( state ) % ( n - m + 1 ), m );
+            }
+            else
+            {
+                needle.resize( m );
+                for ( std::size_t i = 0; i < m; ++i ) needle[i] = alphabet[next_random( state ) % alphabet_size];
+            }
+            if ( k.find( buffer.data(), n, needle.data(), m ) != reference.find( buffer.data(), n, needle.data(), m ) )
+            {
+                return false;
+            }
+            if ( k.rfind( buffer.data(), n, needle.data(), m ) != reference.rfind( buffer.data(), n, needle.data(), m ) )
+            {
+                return false;
+            }
+
+            for ( int cls = ALNUM; cls <= UPPER; ++cls )
+            {
+                for ( int match = 0; match < 2; ++match )
+                {
+                    if ( k.span( buffer.data(), n, (CharClass) cls, match != 0 ) !=
+                         reference.span( buffer.data(), n, (CharClass) cls, match != 0 ) )
+                    {
+                        return false;
+                    }
+                    if ( k.rspan( buffer.data(), n, (CharClass) cls, match != 0 ) !=
+                         reference.rspan( buffer.data(), n, (CharClass) cls, match != 0 ) )
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            if ( k.ascii( buffer.data(), n ) != reference.ascii( buffer.data(), n ) ) return false;
+
+            // The case insensitive kernels get a copy of the buffer with some letters flipped,
+            // and sometimes one byte changed
+            a = buffer;
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+                if ( ( ( a[i] | 0x20 ) >= 'a' && ( a[i] | 0x20 ) <= 'z' ) && next_random( state ) % 2 ) a[i] ^= 0x20;
+            }
+            if ( n && next_random( state ) % 2 ) a[next_random( state ) % n] = (char) next_random( state );
+            if ( k.imismatch( buffer.data(), a.data(), n ) != reference.imismatch( buffer.data(), a.data(), n ) ) return false;
+
+            if ( m <= n ) needle.assign( a, next_random( state ) % ( n - m + 1 ), m );
+            if ( k.ifind( buffer.data(), n, needle.data(), m ) != reference.ifind( buffer.data(), n, needle.data(), m ) )
+            {
+                return false;
+            }
+
+            // mismatch() gets an exact copy, or one with a single byte changed
+            a = buffer;
+            if ( n && next_random( state ) % 4 ) a[next_random( state ) % n] ^= (char) ( 1 + next_random( state ) % 255 );
+            if ( k.mismatch( buffer.data(), a.data(), n ) != reference.mismatch( buffer.data(), a.data(), n ) ) return false;
+
+            a = buffer;
+            b = buffer;
+            k.lower( &a[0], n );
+            reference.lower( &b[0], n );
+            if ( a != b ) return false;
+
+            a = buffer;
+            b = buffer;
+            k.upper( &a[0], n );
+            reference.upper( &b[0], n );
+            if ( a != b ) return false;
+        }
+
+        return true;
+    }
+
+} // namespace simd
+} // namespace pystring
@@ -0,0 +1,131 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_SIMD_H
+#define INCLUDED_PYSTRING_SIMD_H
+
+#include <cstddef>
+
+namespace pystring
+{
+namespace simd
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup simd pystring::simd
+    /// @{
+    ///
+    /// The byte scanning loops behind find(), rfind(), split(), rsplit(), the is*() tests,
+    /// lower(), upper(), the case insensitive functions and the ASCII checks of pystring::utf8
+    /// run through a table of kernels picked at run time. On x86-64 the CPU is queried once, at
+    /// load time, and the widest instruction set supported by both the CPU and the OS is used,
+    /// so a single binary runs on SSE2-only machines as well as AVX2 and AVX-512 ones. Setting
+    /// the PYSTRING_ISA environment variable to scalar, sse2, avx2 or avx512 caps the choice;
+    /// asking for more than the machine has falls back to the best it does have. Other
+    /// architectures always use the scalar kernels.
+    ///
+    /// The vector kernels only handle ASCII themselves. Blocks holding bytes above 0x7f are
+    /// passed to the scalar code, which uses the C library character functions exactly as the
+    /// rest of pystring does. The case insensitive kernels are the exception: they fold only
+    /// the ASCII letters, whatever the locale.
+
+    enum ISA
+    {
+        SCALAR = 0,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    enum CharClass
+    {
+        ALNUM = 0,
+        ALPHA,
+        DIGIT,
+        LOWER,
+        SPACE,
+        UPPER
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief One implementation of each kernel. Positions are offsets from s, and n is returned
+    /// when nothing is found.
+    ///
+    struct Kernels
+    {
+        /// First occurrence of the byte c in s[0, n).
+        std::size_t ( *find_byte )( const char * s, std::size_t n, char c );
+
+        /// First occurrence of needle[0, m) in s[0, n). m must be at least 1.
+        std::size_t ( *find )( const char * s, std::size_t n, const char * needle, std::size_t m );
+
+        /// First byte of s[0, n) whose membership of cls is not match, like strspn / strcspn.
+        std::size_t ( *span )( const char * s, std::size_t n, CharClass cls, bool match );
+
+        /// In place lower() and upper().
+        void ( *lower )( char * s, std::size_t n );
+        void ( *upper )( char * s, std::size_t n );
+
+        /// First byte of s[0, n) above 0x7f.
+        std::size_t ( *ascii )( const char * s, std::size_t n );
+
+        /// First position where a[0, n) and b[0, n) differ, ignoring the case of ASCII letters.
+        std::size_t ( *imismatch )( const char * a, const char * b, std::size_t n );
+
+        /// find() ignoring the case of ASCII letters.
+        std::size_t ( *ifind )( const char * s, std::size_t n, const char * needle, std::size_t m );
+
+        /// Last occurrence of needle[0, m) in s[0, n). m must be at least 1.
+        std::size_t ( *rfind )( const char * s, std::size_t n, const char * needle, std::size_t m );
+
+        /// span() from the end: one past the last byte of s[0, n) whose membership of cls is not
+        /// match, or 0 if there is none.
+        std::size_t ( *rspan )( const char * s, std::size_t n, CharClass cls, bool match );
+
+        /// First position where a[0, n) and b[0, n) differ, or n if they are equal.
+        std::size_t ( *mismatch )( const char * a, const char * b, std::size_t n );
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the best instruction set supported by the CPU and the OS.
+    ///
+    ISA detect();
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the instruction set of the kernels in use.
+    ///
+    ISA active();
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Use the kernels of isa from now on, or of detect() if isa is not supported. Return
+    /// the instruction set actually selected.
+    ///
+    ISA select( ISA isa );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return "scalar", "sse2", "avx2" or "avx512".
+    ///
+    const char * name( ISA isa );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the kernels in use, or those of a given instruction set (capped to detect()).
+    ///
+    const Kernels & kernels();
+    const Kernels & kernels( ISA isa );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Run every kernel of isa against the scalar ones on rounds randomized inputs.
+    /// Return false at the first difference. Meant to be run once on new hardware.
+    ///
+    bool crosscheck( ISA isa, int rounds = 2000, unsigned int seed = 1 );
+
+    ///
+    /// @ }
+    ///
+
+} // namespace simd
+} // namespace pystring
+
+#endif
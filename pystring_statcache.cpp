@@ -0,0 +1,189 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_statcache.h"
+#include "pystring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    namespace
+    {
+        // The fewest misses worth a thread of their own
+        const std::size_t MIN_BATCH = 64;
+
+#ifdef _WIN32
+        const char SEP = '\\';
+        bool is_sep( char c ) { return c == '\\' || c == '/'; }
+#else
+        const char SEP = '/';
+        bool is_sep( char c ) { return c == '/'; }
+#endif
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Return true if path names the same file as its normpath(), so that they can share
+        /// an entry. normpath() drops a trailing separator or "/.", which only resolve when
+        /// what comes before is a directory, and resolves ".." lexically, which is wrong after
+        /// a symbolic link; it also turns "" into ".".
+        ///
+        bool cacheable( const std::string & path )
+        {
+            std::size_t n = path.size();
+            if ( n == 0 ) return false;
+
+            // A root is all separators
+            std::size_t last = n;
+            while ( last > 0 && is_sep( path[last - 1] ) ) --last;
+            if ( last == 0 ) return true;
+            if ( last < n ) return false;
+            if ( n >= 2 && path[n - 1] == '.' && is_sep( path[n - 2] ) ) return false;
+
+            for ( std::size_t i = path.find( ".." ); i != std::string::npos; i = path.find( "..", i + 1 ) )
+            {
+                if ( ( i == 0 || is_sep( path[i - 1] ) ) && ( i + 2 == n || is_sep( path[i + 2] ) ) ) return false;
+            }
+            return true;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    StatCache::StatCache( double ttl, std::size_t max_entries, unsigned int shards ) : m_map( ttl, max_entries, shards )
+    {
+    }
+
+    bool StatCache::stat( const std::string & path, StatResult & result )
+    {
+        if ( !cacheable( path ) ) return os::stat( path, result );
+
+        std::string key = os::path::normpath( path );
+        if ( m_map.lookup( key, result ) ) return result.exists;
+
+        os::stat( path, result );
+        m_map.store( key, result );
+        return result.exists;
+    }
+
+    bool StatCache::exists( const std::string & path )
+    {
+        StatResult result;
+        return stat( path, result );
+    }
+
+    bool StatCache::isdir( const std::string & path )
+    {
+        StatResult result;
+        return stat( path, result ) && result.type == DirEntry::DIRECTORY;
+    }
+
+    bool StatCache::isfile( const std::string & path )
+    {
+        StatResult result;
+        return stat( path, result ) && result.type == DirEntry::REGULAR;
+    }
+
+    long long StatCache::getsize( const std::string & path )
+    {
+        StatResult result;
+        return stat( path, result ) ? (long long) result.size : -1;
+    }
+
+    double StatCache::getmtime( const std::string & path )
+    {
+        StatResult result;
+        return stat( path, result ) ? result.mtime : -1.0;
+    }
+
+    std::size_t StatCache::stat( const std::vector< std::string > & paths, std::vector< StatResult > & results,
+                                 unsigned int threads )
+    {
+        std::size_t n = paths.size();
+        results.resize( n );
+
+        // Answer the hits first, keeping the keys of the misses to look them up in parallel. An
+        // empty key marks a path that is looked up without the cache.
+        std::vector< std::size_t > missing;
+        std::vector< std::string > keys;
+        for ( std::size_t i = 0; i < n; ++i )
+        {
+            std::string key;
+            if ( cacheable( paths[i] ) )
+            {
+                key = os::path::normpath( paths[i] );
+                if ( m_map.lookup( key, results[i] ) ) continue;
+            }
+            missing.push_back( i );
+            keys.push_back( std::move( key ) );
+        }
+
+        if ( threads == 0 ) threads = std::max( 1u, std::thread::hardware_concurrency() ) * 2;
+        threads = (unsigned int) std::min< std::size_t >( threads, ( missing.size() + MIN_BATCH - 1 ) / MIN_BATCH );
+
+        // Lookups take very different times, so the threads take the misses one at a time
+        std::atomic< std::size_t > next( 0 );
+        auto run = [&]()
+        {
+            for ( std::size_t m = next++; m < missing.size(); m = next++ )
+            {
+                StatResult & result = results[missing[m]];
+                os::stat( paths[missing[m]], result );
+                if ( !keys[m].empty() ) m_map.store( keys[m], result );
+            }
+        };
+
+        std::vector< std::thread > workers;
+        for ( unsigned int t = 1; t < threads; ++t ) workers.emplace_back( run );
+        run();
+        for ( std::size_t t = 0; t < workers.size(); ++t ) workers[t].join();
+
+        std::size_t found = 0;
+        for ( std::size_t i = 0; i < n; ++i ) found += results[i].exists ? 1 : 0;
+        return found;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void StatCache::invalidate( const std::string & path )
+    {
+        m_map.erase( os::path::normpath( path ) );
+    }
+
+    void StatCache::invalidate_tree( const std::string & path )
+    {
+        // The paths under a directory start with it and a separator, unless it is a root that
+        // already ends with one; everything relative is under "."
+        std::string key = os::path::normpath( path ), prefix = key;
+        bool relative = key == ".";
+        if ( prefix.empty() || prefix[prefix.size() - 1] != SEP ) prefix += SEP;
+
+        m_map.erase_if( [&]( const std::string & entry )
+        {
+            return relative ? !os::path::isabs( entry ) : entry == key || entry.compare( 0, prefix.size(), prefix ) == 0;
+        } );
+    }
+
+    StatCache::Stats StatCache::stats() const
+    {
+        return m_map.stats();
+    }
+
+    void StatCache::clear()
+    {
+        m_map.clear();
+    }
+
+} // namespace path
+} // namespace os
+} // namespace pystring
@@ -0,0 +1,97 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_STATCACHE_H
+#define INCLUDED_PYSTRING_STATCACHE_H
+
+#include "pystring_cachemap.h"
+#include "pystring_fs.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pystring
+{
+namespace os
+{
+namespace path
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Bounded cache of os::stat() results, for programs that query the same paths over
+    /// and over, as pipelines on network filesystems do, where each lookup is a round trip.
+    ///
+    /// Entries are keyed by normpath() of the path, so that "a/./b" and "a//b" share one entry.
+    /// The answers are those of os::stat(): paths whose meaning normpath() changes, the empty
+    /// path, those ending with a separator or "/." and those with a ".." component, are
+    /// looked up every time, without the cache or its counters. Relative paths are kept
+    /// relative; clear() the cache after changing the working directory. Paths that do not
+    /// exist are cached too.
+    ///
+    /// An entry older than ttl seconds is looked up again; a ttl of 0 keeps entries until they
+    /// are invalidated or evicted. The cache does not watch the filesystem: changes made
+    /// through it are only seen once the entries they touch expire or are invalidated.
+    ///
+    /// The cache is split into shards, each with its own lock, and entries beyond max_entries
+    /// are evicted in CLOCK order. Each entry holds all the fields of StatResult, so that one
+    /// lookup answers all the queries.
+    ///
+    class StatCache
+    {
+    public:
+        typedef CacheStats Stats;
+
+        explicit StatCache( double ttl = 0.0, std::size_t max_entries = 1 << 20, unsigned int shards = 16 );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief The queries of os::stat() and of the os::path functions of the same name,
+        /// answered from the cache when they can be.
+        ///
+        bool stat( const std::string & path, StatResult & result );
+        bool exists( const std::string & path );
+        bool isdir( const std::string & path );
+        bool isfile( const std::string & path );
+        long long getsize( const std::string & path );
+        double getmtime( const std::string & path );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Store the result of stat() of each path in results, in order. The paths that
+        /// are not cached are looked up by up to threads threads, the calling one included, 0
+        /// meaning twice the number of cores; small batches are looked up on the calling
+        /// thread alone. Return the number of paths that exist.
+        ///
+        std::size_t stat( const std::vector< std::string > & paths, std::vector< StatResult > & results,
+                          unsigned int threads = 0 );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Drop the entry of path, or of path and of every path under it. invalidate_tree()
+        /// goes through the whole cache.
+        ///
+        void invalidate( const std::string & path );
+        void invalidate_tree( const std::string & path );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the counters and the current number of entries summed over all shards.
+        ///
+        Stats stats() const;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Drop every entry and reset the counters.
+        ///
+        void clear();
+
+    private:
+        StatCache( const StatCache & );
+        StatCache & operator=( const StatCache & );
+
+        detail::CacheMap< StatResult > m_map;
+    };
+
+} // namespace path
+} // namespace os
+} // namespace pystring
+
+#endif
@@ -0,0 +1,234 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+namespace pystring
+{
+namespace stats
+{
+
+    namespace
+    {
+        // Counter slots are fixed per thread so that snapshot() can read them while the owning
+        // thread keeps counting. Functions registered past the limit are not counted.
+        const int MAX_FUNCTIONS = 128;
+
+        struct ThreadCounters
+        {
+            detail::Counters functions[MAX_FUNCTIONS];
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector< std::string > names;
+            std::vector< ThreadCounters * > threads;
+            ThreadCounters retired; // totals of the threads that have exited
+        };
+
+        // Never destroyed, threads may still exit after static destruction has started
+        Registry & registry()
+        {
+            static Registry * r = new Registry();
+            return *r;
+        }
+
+        void accumulate( detail::Counters & total, const detail::Counters & c )
+        {
+            detail::add( total.calls, c.calls.load( std::memory_order_relaxed ) );
+            detail::add( total.bytes_in, c.bytes_in.load( std::memory_order_relaxed ) );
+            detail::add( total.bytes_out, c.bytes_out.load( std::memory_order_relaxed ) );
+            detail::add( total.allocations, c.allocations.load( std::memory_order_relaxed ) );
+            detail::add( total.sampled, c.sampled.load( std::memory_order_relaxed ) );
+            for ( int i = 0; i < LATENCY_BUCKETS; ++i )
+            {
+                detail::add( total.latency[i], c.latency[i].load( std::memory_order_relaxed ) );
+            }
+        }
+
+        void clear( detail::Counters & c )
+        {
+            c.calls.store( 0, std::memory_order_relaxed );
+            c.bytes_in.store( 0, std::memory_order_relaxed );
+            c.bytes_out.store( 0, std::memory_order_relaxed );
+            c.allocations.store( 0, std::memory_order_relaxed );
+            c.sampled.store( 0, std::memory_order_relaxed );
+            for ( int i = 0; i < LATENCY_BUCKETS; ++i ) c.latency[i].store( 0, std::memory_order_relaxed );
+        }
+
+        // Registers the thread's counters on first use and folds them into the retired totals
+        // when the thread exits
+        struct ThreadSlot
+        {
+            ThreadCounters * counters;
+
+            ThreadSlot() : counters( new ThreadCounters() )
+            {
+                Registry & r = registry();
+                std::lock_guard< std::mutex > lock( r.mutex );
+                r.threads.push_back( counters );
+            }
+
+            ~ThreadSlot()
+            {
+                Registry & r = registry();
+                std::lock_guard< std::mutex > lock( r.mutex );
+                for ( int i = 0; i < MAX_FUNCTIONS; ++i ) accumulate( r.retired.functions[i], counters->functions[i] );
+                r.threads.erase( std::find( r.threads.begin(), r.threads.end(), counters ) );
+                delete counters;
+            }
+        };
+
+        thread_local ThreadSlot thread_slot;
+        thread_local int depth = 0;
+
+    } // anonymous namespace
+
+    namespace detail
+    {
+        Function::Function( const char * name ) : m_index( -1 )
+        {
+            Registry & r = registry();
+            std::lock_guard< std::mutex > lock( r.mutex );
+
+            std::vector< std::string >::iterator it = std::find( r.names.begin(), r.names.end(), name );
+            if ( it != r.names.end() )
+            {
+                m_index = (int) ( it - r.names.begin() );
+            }
+            else if ( (int) r.names.size() < MAX_FUNCTIONS )
+            {
+                m_index = (int) r.names.size();
+                r.names.push_back( name );
+            }
+        }
+
+        Counters * enter( const Function & function )
+        {
+            if ( depth++ > 0 || function.index() < 0 ) return 0;
+            return &thread_slot.counters->functions[function.index()];
+        }
+
+        void leave()
+        {
+            --depth;
+        }
+    } // namespace detail
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    double FunctionStats::percentile( double fraction ) const
+    {
+        if ( sampled == 0 ) return 0.0;
+
+        unsigned long long seen = 0;
+        for ( int i = 0; i < LATENCY_BUCKETS; ++i )
+        {
+            seen += latency[i];
+            if ( (double) seen >= fraction * (double) sampled ) return (double) ( 1ULL << i );
+        }
+        return (double) ( 1ULL << ( LATENCY_BUCKETS - 1 ) );
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    bool enabled()
+    {
+#ifdef PYSTRING_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    std::vector< FunctionStats > snapshot()
+    {
+        std::vector< FunctionStats > result;
+
+        Registry & r = registry();
+        std::lock_guard< std::mutex > lock( r.mutex );
+
+        for ( std::size_t i = 0; i < r.names.size(); ++i )
+        {
+            detail::Counters total;
+            clear( total );
+            accumulate( total, r.retired.functions[i] );
+            for ( std::size_t t = 0; t < r.threads.size(); ++t ) accumulate( total, r.threads[t]->functions[i] );
+
+            if ( total.calls.load( std::memory_order_relaxed ) == 0 ) continue;
+
+            FunctionStats stats;
+            stats.name = r.names[i];
+            stats.calls = total.calls.load( std::memory_order_relaxed );
+            stats.bytes_in = total.bytes_in.load( std::memory_order_relaxed );
+            stats.bytes_out = total.bytes_out.load( std::memory_order_relaxed );
+            stats.allocations = total.allocations.load( std::memory_order_relaxed );
+            stats.sampled = total.sampled.load( std::memory_order_relaxed );
+            for ( int b = 0; b < LATENCY_BUCKETS; ++b ) stats.latency[b] = total.latency[b].load( std::memory_order_relaxed );
+            result.push_back( stats );
+        }
+
+        std::stable_sort( result.begin(), result.end(),
+                          []( const FunctionStats & a, const FunctionStats & b ) { return a.calls > b.calls; } );
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void dump( std::ostream & out )
+    {
+        std::vector< FunctionStats > stats = snapshot();
+
+        out << std::left << std::setw( 32 ) << "function" << std::right
+            << std::setw( 12 ) << "calls"
+            << std::setw( 14 ) << "bytes_in"
+            << std::setw( 14 ) << "bytes_out"
+            << std::setw( 12 ) << "allocs"
+            << std::setw( 12 ) << "p50_ns"
+            << std::setw( 12 ) << "p99_ns" << "\n";
+
+        for ( std::size_t i = 0; i < stats.size(); ++i )
+        {
+            const FunctionStats & s = stats[i];
+            out << std::left << std::setw( 32 ) << s.name << std::right
+                << std::setw( 12 ) << s.calls
+                << std::setw( 14 ) << s.bytes_in
+                << std::setw( 14 ) << s.bytes_out
+                << std::setw( 12 ) << s.allocations
+                << std::setw( 12 ) << s.percentile( 0.5 )
+                << std::setw( 12 ) << s.percentile( 0.99 ) << "\n";
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    ///
+    void reset()
+    {
+        Registry & r = registry();
+        std::lock_guard< std::mutex > lock( r.mutex );
+
+        // Counts made concurrently by other threads while resetting may survive or be lost
+        for ( int i = 0; i < MAX_FUNCTIONS; ++i )
+        {
+            clear( r.retired.functions[i] );
+            for ( std::size_t t = 0; t < r.threads.size(); ++t ) clear( r.threads[t]->functions[i] );
+        }
+    }
+
+} // namespace stats
+} // namespace pystring
@@ -0,0 +1,209 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_STATS_H
+#define INCLUDED_PYSTRING_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pystring
+{
+namespace stats
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup stats pystring::stats
+    /// @{
+    ///
+    /// Per function call counters, compiled in when the library is built with PYSTRING_STATS
+    /// defined (the PYSTRING_STATS CMake option). Every call made from outside the library counts
+    /// the call, the bytes of its main input and of its results, and the number of result
+    /// strings and containers it produced. One call in SAMPLE_RATE per thread is also timed into
+    /// a latency histogram. Calls that pystring makes to itself are not counted. The counters
+    /// are kept per thread and only merged when a snapshot is taken. Without PYSTRING_STATS the
+    /// instrumentation compiles to nothing and snapshot() is always empty.
+
+    static const int SAMPLE_RATE = 64;
+
+    /// Latency bucket i counts sampled calls that took less than 2^i nanoseconds.
+    static const int LATENCY_BUCKETS = 40;
+
+    struct FunctionStats
+    {
+        std::string name;
+        unsigned long long calls;
+        unsigned long long bytes_in;
+        unsigned long long bytes_out;
+        unsigned long long allocations;
+        unsigned long long sampled;
+        unsigned long long latency[LATENCY_BUCKETS];
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// @brief Return the upper bound in nanoseconds of the bucket holding the given fraction
+        /// (0 to 1) of the sampled calls, or 0 if nothing was sampled.
+        ///
+        double percentile( double fraction ) const;
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if the library was built with PYSTRING_STATS.
+    ///
+    bool enabled();
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the counters of every function called so far, summed over all threads, in
+    /// decreasing order of calls.
+    ///
+    std::vector< FunctionStats > snapshot();
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Write snapshot() as a table to out.
+    ///
+    void dump( std::ostream & out );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Set every counter back to zero.
+    ///
+    void reset();
+
+    ///
+    /// @ }
+    ///
+
+    // Implementation details used by the PYSTRING_STATS_* macros
+    namespace detail
+    {
+        struct Counters
+        {
+            std::atomic< unsigned long long > calls, bytes_in, bytes_out, allocations, sampled;
+            std::atomic< unsigned long long > latency[LATENCY_BUCKETS];
+        };
+
+        // Registers a function name on construction and keeps its counter slot
+        class Function
+        {
+        public:
+            explicit Function( const char * name );
+            int index() const { return m_index; }
+
+        private:
+            int m_index;
+        };
+
+        // The calling thread's counters for a function, or 0 while inside another counted call.
+        // Every enter() is matched by a leave().
+        Counters * enter( const Function & function );
+        void leave();
+
+        inline void add( std::atomic< unsigned long long > & counter, unsigned long long value )
+        {
+            // Only the owning thread writes, so a plain load and store is enough
+            counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+        }
+
+        template < class T >
+        std::size_t size_of( const T & s ) { return s.size(); }
+
+        inline std::size_t size_of( const std::vector< std::string > & v )
+        {
+            std::size_t size = 0;
+            for ( std::size_t i = 0; i < v.size(); ++i ) size += v[i].size();
+            return size;
+        }
+
+        inline std::size_t allocations_of( const std::string & ) { return 1; }
+        inline std::size_t allocations_of( const std::vector< std::string > & v ) { return v.size() + 1; }
+
+        class Scope
+        {
+        public:
+            template < class T >
+            Scope( const Function & function, const T & input ) :
+                m_counters( enter( function ) ), m_sampled( false )
+            {
+                if ( !m_counters ) return;
+
+                unsigned long long calls = m_counters->calls.load( std::memory_order_relaxed );
+                m_counters->calls.store( calls + 1, std::memory_order_relaxed );
+                add( m_counters->bytes_in, size_of( input ) );
+
+                m_sampled = ( calls % SAMPLE_RATE ) == 0;
+                if ( m_sampled ) m_start = std::chrono::steady_clock::now();
+            }
+
+            ~Scope()
+            {
+                if ( m_sampled )
+                {
+                    unsigned long long ns = (unsigned long long) std::chrono::duration_cast< std::chrono::nanoseconds >(
+                        std::chrono::steady_clock::now() - m_start ).count();
+                    int bucket = 0;
+                    while ( bucket < LATENCY_BUCKETS - 1 && ( 1ULL << bucket ) <= ns ) ++bucket;
+                    add( m_counters->sampled, 1 );
+                    add( m_counters->latency[bucket], 1 );
+                }
+                leave();
+            }
+
+            template < class T >
+            void result( const T & value )
+            {
+                if ( !m_counters ) return;
+                add( m_counters->bytes_out, size_of( value ) );
+                add( m_counters->allocations, allocations_of( value ) );
+            }
+
+            template < class T, class U >
+            void result( const T & first, const U & second )
+            {
+                result( first );
+                result( second );
+            }
+
+            template < class T >
+            T && returned( T && value )
+            {
+                result( value );
+                return std::forward< T >( value );
+            }
+
+        private:
+            Scope( const Scope & );
+            Scope & operator=( const Scope & );
+
+            Counters * m_counters;
+            bool m_sampled;
+            std::chrono::steady_clock::time_point m_start;
+        };
+    } // namespace detail
+
+} // namespace stats
+} // namespace pystring
+
+// PYSTRING_STATS_SCOPE(name, input) opens the counted scope of a function given
+// its main input, a string or a vector of strings. PYSTRING_STATS_RESULT(value[,
+// value]) records the strings or string vectors it produced, and
+// PYSTRING_STATS_RETURN(expr) does the same for a returned temporary or argument
+// (named locals should use PYSTRING_STATS_RESULT so they are not copied). All of
+// them vanish unless PYSTRING_STATS is defined.
+#ifdef PYSTRING_STATS
+#define PYSTRING_STATS_SCOPE(name, input)                                                         \
+    static const pystring::stats::detail::Function pystring_stats_function( name );              \
+    pystring::stats::detail::Scope pystring_stats_scope( pystring_stats_function, input )
+#define PYSTRING_STATS_RESULT(...) pystring_stats_scope.result( __VA_ARGS__ )
+#define PYSTRING_STATS_RETURN(expr) pystring_stats_scope.returned( expr )
+#else
+#define PYSTRING_STATS_SCOPE(name, input) ((void)0)
+#define PYSTRING_STATS_RESULT(...) ((void)0)
+#define PYSTRING_STATS_RETURN(expr) (expr)
+#endif
+
+#endif
@@ -0,0 +1,668 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#include "pystring_utf8.h"
+#include "pystring.h"
+#include "pystring_simd.h"
+
+#include <algorithm>
+
+namespace pystring
+{
+namespace utf8
+{
+
+    namespace
+    {
+        const unsigned int INVALID = 0xffffffff;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Decode the code point starting at s[i] and move i past it. A byte that does not start
+        /// a well formed sequence gives INVALID and i moves by one.
+        ///
+        unsigned int decode( const char * s, std::size_t n, std::size_t & i )
+        {
+            unsigned int c = (unsigned char) s[i];
+            if ( c < 0x80 )
+            {
+                ++i;
+                return c;
+            }
+
+            std::size_t count;
+            unsigned int min;
+            if ( ( c & 0xe0 ) == 0xc0 )      { count = 1; c &= 0x1f; min = 0x80; }
+            else if ( ( c & 0xf0 ) == 0xe0 ) { count = 2; c &= 0x0f; min = 0x800; }
+            else if ( ( c & 0xf8 ) == 0xf0 ) { count = 3; c &= 0x07; min = 0x10000; }
+            else
+            {
+                ++i;
+                return INVALID;
+            }
+
+            if ( n - i <= count )
+            {
+                ++i;
+                return INVALID;
+            }
+
+            for ( std::size_t k = 1; k <= count; ++k )
+            {
+                unsigned int next = (unsigned char) s[i + k];
+                if ( ( next & 0xc0 ) != 0x80 )
+                {
+                    ++i;
+                    return INVALID;
+                }
+                c = ( c << 6 ) | ( next & 0x3f );
+            }
+
+            if ( c < min || c > 0x10ffff || ( c >= 0xd800 && c <= 0xdfff ) )
+            {
+                ++i;
+                return INVALID;
+            }
+
+            i += count + 1;
+            return c;
+        }
+
+        void encode( unsigned int c, std::string & out )
+        {
+            if ( c < 0x80 )
+            {
+                out += (char) c;
+            }
+            else if ( c < 0x800 )
+            {
+                out += (char) ( 0xc0 | ( c >> 6 ) );
+                out += (char) ( 0x80 | ( c & 0x3f ) );
+            }
+            else if ( c < 0x10000 )
+            {
+                out += (char) ( 0xe0 | ( c >> 12 ) );
+                out += (char) ( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+                out += (char) ( 0x80 | ( c & 0x3f ) );
+            }
+            else
+            {
+                out += (char) ( 0xf0 | ( c >> 18 ) );
+                out += (char) ( 0x80 | ( ( c >> 12 ) & 0x3f ) );
+                out += (char) ( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+                out += (char) ( 0x80 | ( c & 0x3f ) );
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Case tables, from the simple mappings of Unicode 14 for the blocks named in
+        /// pystring_utf8.h. Each Offset is a block of letters whose other case sits delta code
+        /// points away: lower_offsets holds the uppercase letters and upper_offsets the
+        /// lowercase ones. Each Pairs block alternates uppercase and lowercase letters, from the
+        /// uppercase first to the uppercase last. Single holds the mappings that fit neither
+        /// pattern or only go one way. Every table is sorted, to be searched by bisection.
+        ///
+        struct Offset
+        {
+            unsigned int first, last;
+            int delta;
+        };
+
+        struct Pairs
+        {
+            unsigned int first, last;
+        };
+
+        struct Single
+        {
+            unsigned int from, to;
+        };
+
+        const Offset lower_offsets[] = {
+            { 0x00c0, 0x00d6, 32 }, { 0x00d8, 0x00de, 32 }, { 0x0178, 0x0178, -121 },
+            { 0x0181, 0x0181, 210 }, { 0x0186, 0x0186, 206 }, { 0x0189, 0x018a, 205 },
+            { 0x018e, 0x018e, 79 }, { 0x018f, 0x018f, 202 }, { 0x0190, 0x0190, 203 },
+            { 0x0193, 0x0193, 205 }, { 0x0194, 0x0194, 207 }, { 0x0196, 0x0196, 211 },
+            { 0x0197, 0x0197, 209 }, { 0x019c, 0x019c, 211 }, { 0x019d, 0x019d, 213 },
+            { 0x019f, 0x019f, 214 }, { 0x01a6, 0x01a6, 218 }, { 0x01a9, 0x01a9, 218 },
+            { 0x01ae, 0x01ae, 218 }, { 0x01b1, 0x01b2, 217 }, { 0x01b7, 0x01b7, 219 },
+            { 0x01c4, 0x01c4, 2 }, { 0x01c7, 0x01c7, 2 }, { 0x01ca, 0x01ca, 2 },
+            { 0x01f1, 0x01f1, 2 }, { 0x01f6, 0x01f6, -97 }, { 0x01f7, 0x01f7, -56 },
+            { 0x0220, 0x0220, -130 }, { 0x023a, 0x023a, 10795 }, { 0x023d, 0x023d, -163 },
+            { 0x023e, 0x023e, 10792 }, { 0x0243, 0x0243, -195 }, { 0x0244, 0x0244, 69 },
+            { 0x0245, 0x0245, 71 }, { 0x037f, 0x037f, 116 }, { 0x0386, 0x0386, 38 },
+            { 0x0388, 0x038a, 37 }, { 0x038c, 0x038c, 64 }, { 0x038e, 0x038f, 63 },
+            { 0x0391, 0x03a1, 32 }, { 0x03a3, 0x03ab, 32 }, { 0x03cf, 0x03cf, 8 },
+            { 0x03f9, 0x03f9, -7 }, { 0x03fd, 0x03ff, -130 }, { 0x0400, 0x040f, 80 },
+            { 0x0410, 0x042f, 32 }, { 0x04c0, 0x04c0, 15 }, { 0x0531, 0x0556, 48 },
+            { 0x1f08, 0x1f0f, -8 }, { 0x1f18, 0x1f1d, -8 }, { 0x1f28, 0x1f2f, -8 },
+            { 0x1f38, 0x1f3f, -8 }, { 0x1f48, 0x1f4d, -8 }, { 0x1f59, 0x1f59, -8 },
+            { 0x1f5b, 0x1f5b, -8 }, { 0x1f5d, 0x1f5d, -8 }, { 0x1f5f, 0x1f5f, -8 },
+            { 0x1f68, 0x1f6f, -8 }, { 0x1f88, 0x1f8f, -8 }, { 0x1f98, 0x1f9f, -8 },
+            { 0x1fa8, 0x1faf, -8 }, { 0x1fb8, 0x1fb9, -8 }, { 0x1fba, 0x1fbb, -74 },
+            { 0x1fbc, 0x1fbc, -9 }, { 0x1fc8, 0x1fcb, -86 }, { 0x1fcc, 0x1fcc, -9 },
+            { 0x1fd8, 0x1fd9, -8 }, { 0x1fda, 0x1fdb, -100 }, { 0x1fe8, 0x1fe9, -8 },
+            { 0x1fea, 0x1feb, -112 }, { 0x1fec, 0x1fec, -7 }, { 0x1ff8, 0x1ff9, -128 },
+            { 0x1ffa, 0x1ffb, -126 }, { 0x1ffc, 0x1ffc, -9 }, { 0x2c62, 0x2c62, -10743 },
+            { 0x2c64, 0x2c64, -10727 }, { 0x2c6d, 0x2c6d, -10780 }, { 0x2c6e, 0x2c6e, -10749 },
+            { 0x2c6f, 0x2c6f, -10783 }, { 0x2c70, 0x2c70, -10782 }, { 0x2c7e, 0x2c7f, -10815 },
+            { 0xa78d, 0xa78d, -42280 }, { 0xa7aa, 0xa7aa, -42308 }, { 0xa7ab, 0xa7ab, -42319 },
+            { 0xa7ac, 0xa7ac, -42315 }, { 0xa7ad, 0xa7ad, -42305 }, { 0xa7ae, 0xa7ae, -42308 },
+            { 0xa7b0, 0xa7b0, -42258 }, { 0xa7b1, 0xa7b1, -42282 }, { 0xa7b2, 0xa7b2, -42261 },
+            { 0xa7c4, 0xa7c4, -48 }, { 0xa7c5, 0xa7c5, -42307 }, { 0xff21, 0xff3a, 32 }
+        };
+
+        const Offset upper_offsets[] = {
+            { 0x00e0, 0x00f6, -32 }, { 0x00f8, 0x00fe, -32 }, { 0x00ff, 0x00ff, 121 },
+            { 0x0180, 0x0180, 195 }, { 0x0195, 0x0195, 97 }, { 0x019a, 0x019a, 163 },
+            { 0x019e, 0x019e, 130 }, { 0x01bf, 0x01bf, 56 }, { 0x01c6, 0x01c6, -2 },
+            { 0x01c9, 0x01c9, -2 }, { 0x01cc, 0x01cc, -2 }, { 0x01dd, 0x01dd, -79 },
+            { 0x01f3, 0x01f3, -2 }, { 0x023f, 0x0240, 10815 }, { 0x0250, 0x0250, 10783 },
+            { 0x0251, 0x0251, 10780 }, { 0x0252, 0x0252, 10782 }, { 0x0253, 0x0253, -210 },
+            { 0x0254, 0x0254, -206 }, { 0x0256, 0x0257, -205 }, { 0x0259, 0x0259, -202 },
+            { 0x025b, 0x025b, -203 }, { 0x025c, 0x025c, 42319 }, { 0x0260, 0x0260, -205 },
+            { 0x0261, 0x0261, 42315 }, { 0x0263, 0x0263, -207 }, { 0x0265, 0x0265, 42280 },
+            { 0x0266, 0x0266, 42308 }, { 0x0268, 0x0268, -209 }, { 0x0269, 0x0269, -211 },
+            { 0x026a, 0x026a, 42308 }, { 0x026b, 0x026b, 10743 }, { 0x026c, 0x026c, 42305 },
+            { 0x026f, 0x026f, -211 }, { 0x0271, 0x0271, 10749 }, { 0x0272, 0x0272, -213 },
+            { 0x0275, 0x0275, -214 }, { 0x027d, 0x027d, 10727 }, { 0x0280, 0x0280, -218 },
+            { 0x0282, 0x0282, 42307 }, { 0x0283, 0x0283, -218 }, { 0x0287, 0x0287, 42282 },
+            { 0x0288, 0x0288, -218 }, { 0x0289, 0x0289, -69 }, { 0x028a, 0x028b, -217 },
+            { 0x028c, 0x028c, -71 }, { 0x0292, 0x0292, -219 }, { 0x029d, 0x029d, 42261 },
+            { 0x029e, 0x029e, 42258 }, { 0x037b, 0x037d, 130 }, { 0x03ac, 0x03ac, -38 },
+            { 0x03ad, 0x03af, -37 }, { 0x03b1, 0x03c1, -32 }, { 0x03c3, 0x03cb, -32 },
+            { 0x03cc, 0x03cc, -64 }, { 0x03cd, 0x03ce, -63 }, { 0x03d7, 0x03d7, -8 },
+            { 0x03f2, 0x03f2, 7 }, { 0x03f3, 0x03f3, -116 }, { 0x0430, 0x044f, -32 },
+            { 0x0450, 0x045f, -80 }, { 0x04cf, 0x04cf, -15 }, { 0x0561, 0x0586, -48 },
+            { 0x1f00, 0x1f07, 8 }, { 0x1f10, 0x1f15, 8 }, { 0x1f20, 0x1f27, 8 },
+            { 0x1f30, 0x1f37, 8 }, { 0x1f40, 0x1f45, 8 }, { 0x1f51, 0x1f51, 8 },
+            { 0x1f53, 0x1f53, 8 }, { 0x1f55, 0x1f55, 8 }, { 0x1f57, 0x1f57, 8 },
+            { 0x1f60, 0x1f67, 8 }, { 0x1f70, 0x1f71, 74 }, { 0x1f72, 0x1f75, 86 },
+            { 0x1f76, 0x1f77, 100 }, { 0x1f78, 0x1f79, 128 }, { 0x1f7a, 0x1f7b, 112 },
+            { 0x1f7c, 0x1f7d, 126 }, { 0x1f80, 0x1f87, 8 }, { 0x1f90, 0x1f97, 8 },
+            { 0x1fa0, 0x1fa7, 8 }, { 0x1fb0, 0x1fb1, 8 }, { 0x1fb3, 0x1fb3, 9 },
+            { 0x1fc3, 0x1fc3, 9 }, { 0x1fd0, 0x1fd1, 8 }, { 0x1fe0, 0x1fe1, 8 },
+            { 0x1fe5, 0x1fe5, 7 }, { 0x1ff3, 0x1ff3, 9 }, { 0x2c65, 0x2c65, -10795 },
+            { 0x2c66, 0x2c66, -10792 }, { 0xa794, 0xa794, 48 }, { 0xff41, 0xff5a, -32 }
+        };
+
+        const Pairs pairs[] = {
+            { 0x0100, 0x012e }, { 0x0132, 0x0136 }, { 0x0139, 0x0147 }, { 0x014a, 0x0176 },
+            { 0x0179, 0x017d }, { 0x0182, 0x0184 }, { 0x0187, 0x0187 }, { 0x018b, 0x018b },
+            { 0x0191, 0x0191 }, { 0x0198, 0x0198 }, { 0x01a0, 0x01a4 }, { 0x01a7, 0x01a7 },
+            { 0x01ac, 0x01ac }, { 0x01af, 0x01af }, { 0x01b3, 0x01b5 }, { 0x01b8, 0x01b8 },
+            { 0x01bc, 0x01bc }, { 0x01cd, 0x01db }, { 0x01de, 0x01ee }, { 0x01f4, 0x01f4 },
+            { 0x01f8, 0x021e }, { 0x0222, 0x0232 }, { 0x023b, 0x023b }, { 0x0241, 0x0241 },
+            { 0x0246, 0x024e }, { 0x0370, 0x0372 }, { 0x0376, 0x0376 }, { 0x03d8, 0x03ee },
+            { 0x03f7, 0x03f7 }, { 0x03fa, 0x03fa }, { 0x0460, 0x0480 }, { 0x048a, 0x04be },
+            { 0x04c1, 0x04cd }, { 0x04d0, 0x052e }, { 0x1e00, 0x1e94 }, { 0x1ea0, 0x1efe },
+            { 0x2c60, 0x2c60 }, { 0x2c67, 0x2c6b }, { 0x2c72, 0x2c72 }, { 0x2c75, 0x2c75 },
+            { 0xa722, 0xa72e }, { 0xa732, 0xa76e }, { 0xa779, 0xa77b }, { 0xa77e, 0xa786 },
+            { 0xa78b, 0xa78b }, { 0xa790, 0xa792 }, { 0xa796, 0xa7a8 }, { 0xa7b4, 0xa7c2 },
+            { 0xa7c7, 0xa7c9 }, { 0xa7d0, 0xa7d0 }, { 0xa7d6, 0xa7d8 }, { 0xa7f5, 0xa7f5 }
+        };
+
+        const Single to_upper_singles[] = {
+            { 0x00b5, 0x039c }, { 0x0131, 0x0049 }, { 0x017f, 0x0053 }, { 0x01c5, 0x01c4 },
+            { 0x01c8, 0x01c7 }, { 0x01cb, 0x01ca }, { 0x01f2, 0x01f1 }, { 0x03c2, 0x03a3 },
+            { 0x03d0, 0x0392 }, { 0x03d1, 0x0398 }, { 0x03d5, 0x03a6 }, { 0x03d6, 0x03a0 },
+            { 0x03f0, 0x039a }, { 0x03f1, 0x03a1 }, { 0x03f5, 0x0395 }, { 0x1e9b, 0x1e60 },
+            { 0x1fbe, 0x0399 }
+        };
+
+        const Single to_lower_singles[] = {
+            { 0x0130, 0x0069 }, { 0x01c5, 0x01c6 }, { 0x01c8, 0x01c9 }, { 0x01cb, 0x01cc },
+            { 0x01f2, 0x01f3 }, { 0x03f4, 0x03b8 }, { 0x1e9e, 0x00df }, { 0x2c63, 0x1d7d },
+            { 0xa77d, 0x1d79 }, { 0xa7b3, 0xab53 }, { 0xa7c6, 0x1d8e }
+        };
+
+        // The titlecase mappings that differ from the uppercase ones
+        const Single to_title_singles[] = {
+            { 0x01c4, 0x01c5 }, { 0x01c5, 0x01c5 }, { 0x01c6, 0x01c5 }, { 0x01c7, 0x01c8 },
+            { 0x01c8, 0x01c8 }, { 0x01c9, 0x01c8 }, { 0x01ca, 0x01cb }, { 0x01cb, 0x01cb },
+            { 0x01cc, 0x01cb }, { 0x01f1, 0x01f2 }, { 0x01f2, 0x01f2 }, { 0x01f3, 0x01f2 }
+        };
+
+        // Titlecase letters, which are neither uppercase nor lowercase
+        const Pairs titlecase[] = {
+            { 0x01c5, 0x01c5 }, { 0x01c8, 0x01c8 }, { 0x01cb, 0x01cb }, { 0x01f2, 0x01f2 },
+            { 0x1f88, 0x1f8f }, { 0x1f98, 0x1f9f }, { 0x1fa8, 0x1faf }, { 0x1fbc, 0x1fbc },
+            { 0x1fcc, 0x1fcc }, { 0x1ffc, 0x1ffc }
+        };
+
+        // Lowercase and uppercase letters without a mapping to the other case
+        const Pairs caseless_lower[] = {
+            { 0x00aa, 0x00aa }, { 0x00ba, 0x00ba }, { 0x00df, 0x00df }, { 0x0138, 0x0138 },
+            { 0x0149, 0x0149 }, { 0x018d, 0x018d }, { 0x019b, 0x019b }, { 0x01aa, 0x01ab },
+            { 0x01ba, 0x01ba }, { 0x01be, 0x01be }, { 0x01f0, 0x01f0 }, { 0x0221, 0x0221 },
+            { 0x0234, 0x0239 }, { 0x0255, 0x0255 }, { 0x0258, 0x0258 }, { 0x025a, 0x025a },
+            { 0x025d, 0x025f }, { 0x0262, 0x0262 }, { 0x0264, 0x0264 }, { 0x0267, 0x0267 },
+            { 0x026d, 0x026e }, { 0x0270, 0x0270 }, { 0x0273, 0x0274 }, { 0x0276, 0x027c },
+            { 0x027e, 0x027f }, { 0x0281, 0x0281 }, { 0x0284, 0x0286 }, { 0x028d, 0x0291 },
+            { 0x0293, 0x0293 }, { 0x0295, 0x029c }, { 0x029f, 0x02af }, { 0x037a, 0x037a },
+            { 0x0390, 0x0390 }, { 0x03b0, 0x03b0 }, { 0x03fc, 0x03fc }, { 0x0560, 0x0560 },
+            { 0x0587, 0x0588 }, { 0x1e96, 0x1e9a }, { 0x1e9c, 0x1e9d }, { 0x1e9f, 0x1e9f },
+            { 0x1f50, 0x1f50 }, { 0x1f52, 0x1f52 }, { 0x1f54, 0x1f54 }, { 0x1f56, 0x1f56 },
+            { 0x1fb2, 0x1fb2 }, { 0x1fb4, 0x1fb4 }, { 0x1fb6, 0x1fb7 }, { 0x1fc2, 0x1fc2 },
+            { 0x1fc4, 0x1fc4 }, { 0x1fc6, 0x1fc7 }, { 0x1fd2, 0x1fd3 }, { 0x1fd6, 0x1fd7 },
+            { 0x1fe2, 0x1fe4 }, { 0x1fe6, 0x1fe7 }, { 0x1ff2, 0x1ff2 }, { 0x1ff4, 0x1ff4 },
+            { 0x1ff6, 0x1ff7 }, { 0x2c71, 0x2c71 }, { 0x2c74, 0x2c74 }, { 0x2c77, 0x2c7d },
+            { 0xa730, 0xa731 }, { 0xa770, 0xa778 }, { 0xa78e, 0xa78e }, { 0xa795, 0xa795 },
+            { 0xa7af, 0xa7af }, { 0xa7d3, 0xa7d3 }, { 0xa7d5, 0xa7d5 }, { 0xa7f8, 0xa7fa },
+            { 0xfb00, 0xfb06 }, { 0xfb13, 0xfb17 }
+        };
+
+        const Pairs caseless_upper[] = {
+            { 0x03d2, 0x03d4 }
+        };
+
+        // Letters, for isalpha(): those of the cased blocks, and those of the Hebrew, Arabic,
+        // kana, CJK and Hangul blocks
+        const Pairs letters[] = {
+            { 0x00aa, 0x00aa }, { 0x00b5, 0x00b5 }, { 0x00ba, 0x00ba }, { 0x00c0, 0x00d6 },
+            { 0x00d8, 0x00f6 }, { 0x00f8, 0x02af }, { 0x0370, 0x0374 }, { 0x0376, 0x0377 },
+            { 0x037a, 0x037d }, { 0x037f, 0x037f }, { 0x0386, 0x0386 }, { 0x0388, 0x038a },
+            { 0x038c, 0x038c }, { 0x038e, 0x03a1 }, { 0x03a3, 0x03f5 }, { 0x03f7, 0x0481 },
+            { 0x048a, 0x052f }, { 0x0531, 0x0556 }, { 0x0559, 0x0559 }, { 0x0560, 0x0588 },
+            { 0x05d0, 0x05ea }, { 0x0620, 0x064a }, { 0x1e00, 0x1f15 }, { 0x1f18, 0x1f1d },
+            { 0x1f20, 0x1f45 }, { 0x1f48, 0x1f4d }, { 0x1f50, 0x1f57 }, { 0x1f59, 0x1f59 },
+            { 0x1f5b, 0x1f5b }, { 0x1f5d, 0x1f5d }, { 0x1f5f, 0x1f7d }, { 0x1f80, 0x1fb4 },
+            { 0x1fb6, 0x1fbc }, { 0x1fbe, 0x1fbe }, { 0x1fc2, 0x1fc4 }, { 0x1fc6, 0x1fcc },
+            { 0x1fd0, 0x1fd3 }, { 0x1fd6, 0x1fdb }, { 0x1fe0, 0x1fec }, { 0x1ff2, 0x1ff4 },
+            { 0x1ff6, 0x1ffc }, { 0x2c60, 0x2c7f }, { 0x3041, 0x3096 }, { 0x309d, 0x309f },
+            { 0x30a1, 0x30fa }, { 0x30fc, 0x30ff }, { 0x3400, 0x4dbf }, { 0x4e00, 0x9fff },
+            { 0xa722, 0xa788 }, { 0xa78b, 0xa7ca }, { 0xa7d0, 0xa7d1 }, { 0xa7d3, 0xa7d3 },
+            { 0xa7d5, 0xa7d9 }, { 0xa7f2, 0xa7ff }, { 0xac00, 0xd7a3 }, { 0xfb00, 0xfb06 },
+            { 0xfb13, 0xfb17 }, { 0xff21, 0xff3a }, { 0xff41, 0xff5a }, { 0xff66, 0xffbe },
+            { 0xffc2, 0xffc7 }, { 0xffca, 0xffcf }, { 0xffd2, 0xffd7 }, { 0xffda, 0xffdc }
+        };
+
+        // Case foldings that differ from tolower(), as UTF-8
+        struct Folding
+        {
+            unsigned int from;
+            const char * to;
+        };
+
+        const Folding foldings[] = {
+            { 0x00b5, "\xce\xbc" }, { 0x00df, "ss" }, { 0x0130, "i\xcc\x87" },
+            { 0x0149, "\xca\xbcn" }, { 0x017f, "s" }, { 0x01f0, "j\xcc\x8c" },
+            { 0x0390, "\xce\xb9\xcc\x88\xcc\x81" }, { 0x03b0, "\xcf\x85\xcc\x88\xcc\x81" }, { 0x03c2, "\xcf\x83" },
+            { 0x03d0, "\xce\xb2" }, { 0x03d1, "\xce\xb8" }, { 0x03d5, "\xcf\x86" },
+            { 0x03d6, "\xcf\x80" }, { 0x03f0, "\xce\xba" }, { 0x03f1, "\xcf\x81" },
+            { 0x03f5, "\xce\xb5" }, { 0x0587, "\xd5\xa5\xd6\x82" }, { 0x1e96, "h\xcc\xb1" },
+            { 0x1e97, "t\xcc\x88" }, { 0x1e98, "w\xcc\x8a" }, { 0x1e99, "y\xcc\x8a" },
+            { 0x1e9a, "a\xca\xbe" }, { 0x1e9b, "\xe1\xb9\xa1" }, { 0x1e9e, "ss" },
+            { 0x1f50, "\xcf\x85\xcc\x93" }, { 0x1f52, "\xcf\x85\xcc\x93\xcc\x80" }, { 0x1f54, "\xcf\x85\xcc\x93\xcc\x81" },
+            { 0x1f56, "\xcf\x85\xcc\x93\xcd\x82" }, { 0x1f80, "\xe1\xbc\x80\xce\xb9" }, { 0x1f81, "\xe1\xbc\x81\xce\xb9" },
+            { 0x1f82, "\xe1\xbc\x82\xce\xb9" }, { 0x1f83, "\xe1\xbc\x83\xce\xb9" }, { 0x1f84, "\xe1\xbc\x84\xce\xb9" },
+            { 0x1f85, "\xe1\xbc\x85\xce\xb9" }, { 0x1f86, "\xe1\xbc\x86\xce\xb9" }, { 0x1f87, "\xe1\xbc\x87\xce\xb9" },
+            { 0x1f88, "\xe1\xbc\x80\xce\xb9" }, { 0x1f89, "\xe1\xbc\x81\xce\xb9" }, { 0x1f8a, "\xe1\xbc\x82\xce\xb9" },
+            { 0x1f8b, "\xe1\xbc\x83\xce\xb9" }, { 0x1f8c, "\xe1\xbc\x84\xce\xb9" }, { 0x1f8d, "\xe1\xbc\x85\xce\xb9" },
+            { 0x1f8e, "\xe1\xbc\x86\xce\xb9" }, { 0x1f8f, "\xe1\xbc\x87\xce\xb9" }, { 0x1f90, "\xe1\xbc\xa0\xce\xb9" },
+            { 0x1f91, "\xe1\xbc\xa1\xce\xb9" }, { 0x1f92, "\xe1\xbc\xa2\xce\xb9" }, { 0x1f93, "\xe1\xbc\xa3\xce\xb9" },
+            { 0x1f94, "\xe1\xbc\xa4\xce\xb9" }, { 0x1f95, "\xe1\xbc\xa5\xce\xb9" }, { 0x1f96, "\xe1\xbc\xa6\xce\xb9" },
+            { 0x1f97, "\xe1\xbc\xa7\xce\xb9" }, { 0x1f98, "\xe1\xbc\xa0\xce\xb9" }, { 0x1f99, "\xe1\xbc\xa1\xce\xb9" },
+            { 0x1f9a, "\xe1\xbc\xa2\xce\xb9" }, { 0x1f9b, "\xe1\xbc\xa3\xce\xb9" }, { 0x1f9c, "\xe1\xbc\xa4\xce\xb9" },
+            { 0x1f9d, "\xe1\xbc\xa5\xce\xb9" }, { 0x1f9e, "\xe1\xbc\xa6\xce\xb9" }, { 0x1f9f, "\xe1\xbc\xa7\xce\xb9" },
+            { 0x1fa0, "\xe1\xbd\xa0\xce\xb9" }, { 0x1fa1, "\xe1\xbd\xa1\xce\xb9" }, { 0x1fa2, "\xe1\xbd\xa2\xce\xb9" },
+            { 0x1fa3, "\xe1\xbd\xa3\xce\xb9" }, { 0x1fa4, "\xe1\xbd\xa4\xce\xb9" }, { 0x1fa5, "\xe1\xbd\xa5\xce\xb9" },
+            { 0x1fa6, "\xe1\xbd\xa6\xce\xb9" }, { 0x1fa7, "\xe1\xbd\xa7\xce\xb9" }, { 0x1fa8, "\xe1\xbd\xa0\xce\xb9" },
+            { 0x1fa9, "\xe1\xbd\xa1\xce\xb9" }, { 0x1faa, "\xe1\xbd\xa2\xce\xb9" }, { 0x1fab, "\xe1\xbd\xa3\xce\xb9" },
+            { 0x1fac, "\xe1\xbd\xa4\xce\xb9" }, { 0x1fad, "\xe1\xbd\xa5\xce\xb9" }, { 0x1fae, "\xe1\xbd\xa6\xce\xb9" },
+            { 0x1faf, "\xe1\xbd\xa7\xce\xb9" }, { 0x1fb2, "\xe1\xbd\xb0\xce\xb9" }, { 0x1fb3, "\xce\xb1\xce\xb9" },
+            { 0x1fb4, "\xce\xac\xce\xb9" }, { 0x1fb6, "\xce\xb1\xcd\x82" }, { 0x1fb7, "\xce\xb1\xcd\x82\xce\xb9" },
+            { 0x1fbc, "\xce\xb1\xce\xb9" }, { 0x1fbe, "\xce\xb9" }, { 0x1fc2, "\xe1\xbd\xb4\xce\xb9" },
+            { 0x1fc3, "\xce\xb7\xce\xb9" }, { 0x1fc4, "\xce\xae\xce\xb9" }, { 0x1fc6, "\xce\xb7\xcd\x82" },
+            { 0x1fc7, "\xce\xb7\xcd\x82\xce\xb9" }, { 0x1fcc, "\xce\xb7\xce\xb9" }, { 0x1fd2, "\xce\xb9\xcc\x88\xcc\x80" },
+            { 0x1fd3, "\xce\xb9\xcc\x88\xcc\x81" }, { 0x1fd6, "\xce\xb9\xcd\x82" }, { 0x1fd7, "\xce\xb9\xcc\x88\xcd\x82" },
+            { 0x1fe2, "\xcf\x85\xcc\x88\xcc\x80" }, { 0x1fe3, "\xcf\x85\xcc\x88\xcc\x81" }, { 0x1fe4, "\xcf\x81\xcc\x93" },
+            { 0x1fe6, "\xcf\x85\xcd\x82" }, { 0x1fe7, "\xcf\x85\xcc\x88\xcd\x82" }, { 0x1ff2, "\xe1\xbd\xbc\xce\xb9" },
+            { 0x1ff3, "\xcf\x89\xce\xb9" }, { 0x1ff4, "\xcf\x8e\xce\xb9" }, { 0x1ff6, "\xcf\x89\xcd\x82" },
+            { 0x1ff7, "\xcf\x89\xcd\x82\xce\xb9" }, { 0x1ffc, "\xcf\x89\xce\xb9" }, { 0xfb00, "ff" },
+            { 0xfb01, "fi" }, { 0xfb02, "fl" }, { 0xfb03, "ffi" },
+            { 0xfb04, "ffl" }, { 0xfb05, "st" }, { 0xfb06, "st" },
+            { 0xfb13, "\xd5\xb4\xd5\xb6" }, { 0xfb14, "\xd5\xb4\xd5\xa5" }, { 0xfb15, "\xd5\xb4\xd5\xab" },
+            { 0xfb16, "\xd5\xbe\xd5\xb6" }, { 0xfb17, "\xd5\xb4\xd5\xad" }
+        };
+
+        // The range of table holding c, or 0
+        template < class T, std::size_t N >
+        const T * find_range( const T ( & table )[N], unsigned int c )
+        {
+            const T * it = std::upper_bound( table, table + N, c,
+                                             []( unsigned int value, const T & range ) { return value < range.first; } );
+            return it != table && c <= ( it - 1 )->last ? it - 1 : 0;
+        }
+
+        // The entry of table for c, or 0
+        template < class T, std::size_t N >
+        const T * find_entry( const T ( & table )[N], unsigned int c )
+        {
+            const T * it = std::lower_bound( table, table + N, c,
+                                             []( const T & entry, unsigned int value ) { return entry.from < value; } );
+            return it != table + N && it->from == c ? it : 0;
+        }
+
+        bool is_title( unsigned int c )
+        {
+            return c >= 0x80 && find_range( titlecase, c ) != 0;
+        }
+
+        bool is_lower( unsigned int c )
+        {
+            if ( c < 0x80 ) return c >= 'a' && c <= 'z';
+            if ( is_title( c ) ) return false;
+            return toupper( c ) != c || find_range( caseless_lower, c ) != 0;
+        }
+
+        bool is_upper( unsigned int c )
+        {
+            if ( c < 0x80 ) return c >= 'A' && c <= 'Z';
+            if ( is_title( c ) ) return false;
+            return tolower( c ) != c || find_range( caseless_upper, c ) != 0;
+        }
+
+        unsigned int totitle( unsigned int c )
+        {
+            const Single * entry = find_entry( to_title_singles, c );
+            return entry ? entry->to : toupper( c );
+        }
+
+        bool is_alpha( unsigned int c )
+        {
+            if ( c < 0x80 ) return ( c | 0x20 ) >= 'a' && ( c | 0x20 ) <= 'z';
+            return find_range( letters, c ) != 0;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Return str with every code point passed through f. ASCII runs are copied and
+        /// converted in place by ascii_kernel when one is given.
+        ///
+        std::string transform( const std::string & str, unsigned int ( *f )( unsigned int ),
+                               void ( *ascii_kernel )( char *, std::size_t ) )
+        {
+            const simd::Kernels & k = simd::kernels();
+            const char * s = str.data();
+            std::size_t n = str.size(), i = 0;
+
+            std::string result;
+            result.reserve( n );
+
+            while ( i < n )
+            {
+                std::size_t run = ascii_kernel ? k.ascii( s + i, n - i ) : 0;
+                if ( run )
+                {
+                    std::size_t start = result.size();
+                    result.append( s + i, run );
+                    ascii_kernel( &result[start], run );
+                    i += run;
+                    continue;
+                }
+
+                std::size_t begin = i;
+                unsigned int c = decode( s, n, i );
+                if ( c == INVALID ) result.append( s + begin, i - begin );
+                else encode( f( c ), result );
+            }
+
+            return result;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        /// Return true if str is not empty and every code point satisfies test. ASCII runs are
+        /// checked with the span kernel for cls.
+        ///
+        bool all_of( const std::string & str, bool ( *test )( unsigned int ), simd::CharClass cls )
+        {
+            const simd::Kernels & k = simd::kernels();
+            const char * s = str.data();
+            std::size_t n = str.size(), i = 0;
+
+            if ( n == 0 ) return false;
+
+            while ( i < n )
+            {
+                std::size_t run = k.ascii( s + i, n - i );
+                if ( run )
+                {
+                    if ( k.span( s + i, run, cls, true ) != run ) return false;
+                    i += run;
+                    continue;
+                }
+
+                unsigned int c = decode( s, n, i );
+                if ( c == INVALID || !test( c ) ) return false;
+            }
+
+            return true;
+        }
+
+        unsigned int swap( unsigned int c )
+        {
+            if ( is_upper( c ) ) return tolower( c );
+            return is_lower( c ) ? toupper( c ) : c;
+        }
+
+    } // anonymous namespace
+
+    unsigned int toupper( unsigned int c )
+    {
+        if ( c < 0x80 ) return ( c >= 'a' && c <= 'z' ) ? c - 32 : c;
+
+        if ( const Offset * offset = find_range( upper_offsets, c ) ) return (unsigned int) ( (int) c + offset->delta );
+
+        // The lowercase letter of a pair follows its uppercase one
+        const Pairs * pair = find_range( pairs, c - 1 );
+        if ( pair && ( ( c - 1 - pair->first ) & 1 ) == 0 ) return c - 1;
+
+        const Single * single = find_entry( to_upper_singles, c );
+        return single ? single->to : c;
+    }
+
+    unsigned int tolower( unsigned int c )
+    {
+        if ( c < 0x80 ) return ( c >= 'A' && c <= 'Z' ) ? c + 32 : c;
+
+        if ( const Offset * offset = find_range( lower_offsets, c ) ) return (unsigned int) ( (int) c + offset->delta );
+
+        const Pairs * pair = find_range( pairs, c );
+        if ( pair && ( ( c - pair->first ) & 1 ) == 0 ) return c + 1;
+
+        const Single * single = find_entry( to_lower_singles, c );
+        return single ? single->to : c;
+    }
+
+    bool isascii( const std::string & str )
+    {
+        return simd::kernels().ascii( str.data(), str.size() ) == str.size();
+    }
+
+    bool isvalid( const std::string & str )
+    {
+        const simd::Kernels & k = simd::kernels();
+        const char * s = str.data();
+        std::size_t n = str.size(), i = 0;
+
+        while ( i < n )
+        {
+            i += k.ascii( s + i, n - i );
+            if ( i < n && decode( s, n, i ) == INVALID ) return false;
+        }
+        return true;
+    }
+
+    std::size_t len( const std::string & str )
+    {
+        const simd::Kernels & k = simd::kernels();
+        const char * s = str.data();
+        std::size_t n = str.size(), i = 0, count = 0;
+
+        while ( i < n )
+        {
+            std::size_t run = k.ascii( s + i, n - i );
+            i += run;
+            count += run;
+            if ( i < n )
+            {
+                decode( s, n, i );
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    std::string upper( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::upper( str );
+        return transform( str, toupper, simd::kernels().upper );
+    }
+
+    std::string lower( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::lower( str );
+        return transform( str, tolower, simd::kernels().lower );
+    }
+
+    std::string casefold( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::casefold( str );
+
+        const simd::Kernels & k = simd::kernels();
+        const char * s = str.data();
+        std::size_t n = str.size(), i = 0;
+
+        std::string result;
+        result.reserve( n );
+
+        while ( i < n )
+        {
+            std::size_t run = k.ascii( s + i, n - i );
+            if ( run )
+            {
+                std::size_t start = result.size();
+                result.append( s + i, run );
+                k.lower( &result[start], run );
+                i += run;
+                continue;
+            }
+
+            std::size_t begin = i;
+            unsigned int c = decode( s, n, i );
+            if ( c == INVALID )
+            {
+                result.append( s + begin, i - begin );
+                continue;
+            }
+
+            const Folding * folding = find_entry( foldings, c );
+            if ( folding ) result += folding->to;
+            else encode( tolower( c ), result );
+        }
+
+        return result;
+    }
+
+    std::string swapcase( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::swapcase( str );
+        return transform( str, swap, 0 );
+    }
+
+    std::string capitalize( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::capitalize( str );
+
+        std::size_t i = 0;
+        unsigned int c = decode( str.data(), str.size(), i );
+
+        std::string result;
+        result.reserve( str.size() );
+        if ( c == INVALID ) result.append( str, 0, i );
+        else encode( totitle( c ), result );
+
+        return result + transform( str.substr( i ), tolower, simd::kernels().lower );
+    }
+
+    std::string title( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::title( str );
+
+        const char * s = str.data();
+        std::size_t n = str.size(), i = 0;
+        bool previous_is_cased = false;
+
+        std::string result;
+        result.reserve( n );
+
+        while ( i < n )
+        {
+            std::size_t begin = i;
+            unsigned int c = decode( s, n, i );
+            if ( c == INVALID )
+            {
+                result.append( s + begin, i - begin );
+                previous_is_cased = false;
+            }
+            else
+            {
+                encode( previous_is_cased ? tolower( c ) : totitle( c ), result );
+                previous_is_cased = is_lower( c ) || is_upper( c ) || is_title( c );
+            }
+        }
+
+        return result;
+    }
+
+    bool isalpha( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::isalpha( str );
+        return all_of( str, is_alpha, simd::ALPHA );
+    }
+
+    bool islower( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::islower( str );
+        return all_of( str, is_lower, simd::LOWER );
+    }
+
+    bool isupper( const std::string & str )
+    {
+        if ( isascii( str ) ) return pystring::isupper( str );
+        return all_of( str, is_upper, simd::UPPER );
+    }
+
+    std::string center( const std::string & str, int width )
+    {
+        if ( isascii( str ) ) return pystring::center( str, width );
+
+        int length = (int) len( str );
+        if ( length >= width ) return str;
+
+        int marg = width - length;
+        int left = marg / 2 + ( marg & width & 1 );
+        return std::string( left, ' ' ) + str + std::string( marg - left, ' ' );
+    }
+
+    std::string ljust( const std::string & str, int width )
+    {
+        if ( isascii( str ) ) return pystring::ljust( str, width );
+
+        int length = (int) len( str );
+        if ( length >= width ) return str;
+        return str + std::string( width - length, ' ' );
+    }
+
+    std::string rjust( const std::string & str, int width )
+    {
+        if ( isascii( str ) ) return pystring::rjust( str, width );
+
+        int length = (int) len( str );
+        if ( length >= width ) return str;
+        return std::string( width - length, ' ' ) + str;
+    }
+
+} // namespace utf8
+} // namespace pystring
@@ -0,0 +1,123 @@
+// Copyright Contributors to the Pystring project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/imageworks/pystring/blob/master/LICENSE
+
+
+#ifndef INCLUDED_PYSTRING_UTF8_H
+#define INCLUDED_PYSTRING_UTF8_H
+
+#include <cstddef>
+#include <string>
+
+namespace pystring
+{
+namespace utf8
+{
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @defgroup utf8 pystring::utf8
+    /// @{
+    ///
+    /// UTF-8 aware versions of the pystring functions that depend on what a character is. The
+    /// functions in pystring itself work on bytes; these decode the string into code points, so
+    /// that "é".upper() is "É" and a two byte character counts once towards a width.
+    ///
+    /// Every function first checks whether the string is pure ASCII, using the vectorized
+    /// kernels of pystring::simd, and if so hands it to the byte version unchanged. Otherwise
+    /// runs of ASCII are still handled by the byte kernels and only the rest is decoded.
+    ///
+    /// Case mapping is the simple one to one mapping of Unicode 14 (no "ß" to "SS") and covers
+    /// the Latin-1 Supplement, Latin Extended-A to D, IPA Extensions, Latin Extended Additional,
+    /// Greek and Coptic, Greek Extended, Cyrillic, Cyrillic Supplement and Armenian blocks, the
+    /// Latin and Armenian ligatures and the fullwidth Latin letters; title() and capitalize()
+    /// map "ǆ" to the titlecase "ǅ".
+    /// isalpha() also knows the Hebrew, Arabic, kana, CJK and Hangul letters. Bytes that are
+    /// not valid UTF-8 are copied through unchanged and count as one character each.
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if every byte of the string is below 0x80. This is true of the empty
+    /// string.
+    ///
+    bool isascii( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if the string is well formed UTF-8: no overlong forms, surrogates,
+    /// code points above U+10FFFF or truncated sequences.
+    ///
+    bool isvalid( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the number of characters (code points) in the string.
+    ///
+    std::size_t len( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a copy of the string converted to uppercase.
+    ///
+    std::string upper( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a copy of the string converted to lowercase.
+    ///
+    std::string lower( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a casefolded copy of the string, for caseless matching. This is lower()
+    /// plus the full foldings Python applies on top of it, such as "ß" to "ss" and final sigma
+    /// to sigma, so the result can be longer than the input.
+    ///
+    std::string casefold( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a copy of the string with uppercase characters converted to lowercase and
+    /// vice versa.
+    ///
+    std::string swapcase( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a copy of the string with only its first character capitalized.
+    ///
+    std::string capitalize( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return a titlecased version of the string: words start with uppercase characters,
+    /// all remaining cased characters are lowercase.
+    ///
+    std::string title( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if all characters in the string are letters and there is at least one
+    /// character, false otherwise.
+    ///
+    bool isalpha( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return true if all characters in the string are lowercase (uppercase) and there is
+    /// at least one character, false otherwise.
+    ///
+    bool islower( const std::string & str );
+    bool isupper( const std::string & str );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the string centered, left justified or right justified in a string of
+    /// width characters. Padding is done using spaces.
+    ///
+    std::string center( const std::string & str, int width );
+    std::string ljust( const std::string & str, int width );
+    std::string rjust( const std::string & str, int width );
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    /// @brief Return the simple uppercase and lowercase mapping of a code point, or the code
+    /// point itself if it has none.
+    ///
+    unsigned int toupper( unsigned int c );
+    unsigned int tolower( unsigned int c );
+
+    ///
+    /// @ }
+    ///
+
+} // namespace utf8
+} // namespace pystring
+
+#endif
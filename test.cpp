@@ -2,9 +2,35 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // https://github.com/imageworks/pystring/blob/master/LICENSE
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "pystring.h"
+#include "pystring_fnmatch.h"
+#include "pystring_fs.h"
+#include "pystring_interner.h"
+#include "pystring_io.h"
+#include "pystring_normcache.h"
+#include "pystring_pathref.h"
+#include "pystring_pathtable.h"
+#include "pystring_pathtrie.h"
+#include "pystring_realpath.h"
+#include "pystring_simd.h"
+#include "pystring_statcache.h"
+#include "pystring_stats.h"
+#include "pystring_utf8.h"
 #include "unittest.h"
 
 PYSTRING_TEST_APP(PyStringUnitTests)
@@ -98,6 +124,72 @@ PYSTRING_ADD_TEST(pystring, rfind)
     PYSTRING_CHECK_EQUAL(pystring::rfind("abcabcabc", "abc", 6, 8), -1);
 }
 
+PYSTRING_ADD_TEST(pystring, partition)
+{
+    std::vector< std::string > result;
+    pystring::partition("key=value=more", "=", result);
+    PYSTRING_CHECK_EQUAL(result.size(), 3);
+    PYSTRING_CHECK_EQUAL(result[0], "key");
+    PYSTRING_CHECK_EQUAL(result[1], "=");
+    PYSTRING_CHECK_EQUAL(result[2], "value=more");
+    pystring::rpartition("key=value=more", "=", result);
+    PYSTRING_CHECK_EQUAL(result[0], "key=value");
+    PYSTRING_CHECK_EQUAL(result[2], "more");
+    pystring::partition("novalue", "=", result);
+    PYSTRING_CHECK_EQUAL(result[0], "novalue");
+    PYSTRING_CHECK_EQUAL(result[1], "");
+    PYSTRING_CHECK_EQUAL(result[2], "");
+    pystring::rpartition("novalue", "=", result);
+    PYSTRING_CHECK_EQUAL(result[0], "");
+    PYSTRING_CHECK_EQUAL(result[2], "novalue");
+
+#ifdef PYSTRING_HAVE_CXX17
+    const std::string line = "key := value := more";
+    auto [key, eq, value] = pystring::partition_view(line, " := ");
+    PYSTRING_CHECK_EQUAL(key, "key");
+    PYSTRING_CHECK_EQUAL(eq, " := ");
+    PYSTRING_CHECK_EQUAL(value, "value := more");
+    PYSTRING_CHECK_ASSERT(value.data() == line.data() + 7);
+
+    pystring::Partition last = pystring::rpartition_view(line, " := ");
+    PYSTRING_CHECK_EQUAL(last.head, "key := value");
+    PYSTRING_CHECK_EQUAL(last.sep, " := ");
+    PYSTRING_CHECK_EQUAL(last.tail, "more");
+
+    pystring::Partition none = pystring::partition_view(line, "#");
+    PYSTRING_CHECK_EQUAL(none.head, line);
+    PYSTRING_CHECK_EQUAL(none.sep, "");
+    PYSTRING_CHECK_EQUAL(none.tail, "");
+    PYSTRING_CHECK_ASSERT(none.tail.data() == line.data() + line.size());
+    none = pystring::rpartition_view(line, "#");
+    PYSTRING_CHECK_EQUAL(none.head, "");
+    PYSTRING_CHECK_EQUAL(none.tail, line);
+    none = pystring::partition_view("ab", "abc");
+    PYSTRING_CHECK_EQUAL(none.head, "ab");
+    none = pystring::partition_view("", "=");
+    PYSTRING_CHECK_EQUAL(none.head, "");
+    PYSTRING_CHECK_EQUAL(none.tail, "");
+
+    const char * const cases[] = { "a=b", "=b", "a=", "=", "", "a", "a==b" };
+    for (const char * c : cases)
+    {
+        for (const char * sep : { "=", "==", "" })
+        {
+            pystring::partition(c, sep, result);
+            pystring::Partition p = pystring::partition_view(c, sep);
+            PYSTRING_CHECK_EQUAL(p.head, result[0]);
+            PYSTRING_CHECK_EQUAL(p.sep, result[1]);
+            PYSTRING_CHECK_EQUAL(p.tail, result[2]);
+            pystring::rpartition(c, sep, result);
+            p = pystring::rpartition_view(c, sep);
+            PYSTRING_CHECK_EQUAL(p.head, result[0]);
+            PYSTRING_CHECK_EQUAL(p.sep, result[1]);
+            PYSTRING_CHECK_EQUAL(p.tail, result[2]);
+        }
+    }
+#endif
+}
+
 PYSTRING_ADD_TEST(pystring, removeprefix)
 {
     PYSTRING_CHECK_EQUAL(pystring::removeprefix("abcdef", "abc"), "def");
@@ -546,6 +638,16 @@ PYSTRING_ADD_TEST(pystring_os_path, splitdrive)
     splitdrive_posix(drivespec, pathspec, "/Users/test"); PYSTRING_CHECK_EQUAL(drivespec, ""); PYSTRING_CHECK_EQUAL(pathspec, "/Users/test");
     splitdrive_nt(drivespec, pathspec, "C:\\Users\\test"); PYSTRING_CHECK_EQUAL(drivespec, "C:" ); PYSTRING_CHECK_EQUAL(pathspec, "\\Users\\test" );
     splitdrive_nt(drivespec, pathspec, "\\Users\\test"); PYSTRING_CHECK_EQUAL(drivespec, "" ); PYSTRING_CHECK_EQUAL(pathspec, "\\Users\\test" );
+
+    std::string path = "D:\\Users";
+    splitdrive_nt(path, pathspec, path); PYSTRING_CHECK_EQUAL(path, "D:" ); PYSTRING_CHECK_EQUAL(pathspec, "\\Users" );
+
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view drive, rest;
+    splitdrive_view_nt(drive, rest, "C:\\Users\\test"); PYSTRING_CHECK_EQUAL(drive, "C:" ); PYSTRING_CHECK_EQUAL(rest, "\\Users\\test" );
+    splitdrive_view_nt(drive, rest, "\\Users"); PYSTRING_CHECK_EQUAL(drive, "" ); PYSTRING_CHECK_EQUAL(rest, "\\Users" );
+    splitdrive_view_posix(drive, rest, "C:/Users"); PYSTRING_CHECK_EQUAL(drive, "" ); PYSTRING_CHECK_EQUAL(rest, "C:/Users" );
+#endif
 }
 
 PYSTRING_ADD_TEST(pystring_os_path, isabs)
@@ -562,6 +664,8 @@ PYSTRING_ADD_TEST(pystring_os_path, isabs)
     PYSTRING_CHECK_EQUAL(isabs_nt("/Users"), true);
     PYSTRING_CHECK_EQUAL(isabs_nt("../Users"), false);
     PYSTRING_CHECK_EQUAL(isabs_nt("..\\Users"), false);
+    PYSTRING_CHECK_EQUAL(isabs_nt("C:"), false);
+    PYSTRING_CHECK_EQUAL(isabs_nt(""), false);
 }
 
 PYSTRING_ADD_TEST(pystring_os_path, join)
@@ -600,6 +704,47 @@ PYSTRING_ADD_TEST(pystring_os_path, join)
     PYSTRING_CHECK_EQUAL(join_nt("c:\\a","b"), "c:\\a\\b" );
     PYSTRING_CHECK_EQUAL(join_nt("c:\\a","c:\\b"), "c:\\b" );
     PYSTRING_CHECK_EQUAL(join_nt("..\\a","b"), "..\\a\\b" );
+
+    // Any number of components, of any string type
+    const std::string show = "/show";
+    PYSTRING_CHECK_EQUAL(join_posix(show, "seq", std::string("shot/"), "file.exr"), "/show/seq/shot/file.exr" );
+    PYSTRING_CHECK_EQUAL(join_posix("a", "/b", "", "c", "/d", "e"), "/d/e" );
+    PYSTRING_CHECK_EQUAL(join_posix("", "", "a", ""), "a/" );
+    PYSTRING_CHECK_EQUAL(join_nt("c:", "/a", "b", "c"), "c:/a\\b\\c" );
+    PYSTRING_CHECK_EQUAL(join_nt("c:", "a", "/b", "c"), "/b\\c" );
+    PYSTRING_CHECK_EQUAL(join_nt("c:/a", "d:\\", "\\c", ""), "d:\\c\\" );
+    PYSTRING_CHECK_EQUAL(join_nt("a", "c:/", "/b"), "c:/b" );
+    PYSTRING_CHECK_EQUAL(join_nt("c:\\a", "/b", "c"), "/b\\c" );
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view view = "shot";
+    PYSTRING_CHECK_EQUAL(join_posix(show, view), "/show/shot" );
+#endif
+
+    // join_append() leaves what the buffer held alone
+    std::string buffer = "path: ";
+    join_append_posix(buffer, "a", "b");
+    PYSTRING_CHECK_EQUAL(buffer, "path: a/b" );
+    join_append_nt(buffer, "/c");
+    PYSTRING_CHECK_EQUAL(buffer, "path: a/b/c" );
+    join_append_nt(buffer, "\\d", "c:\\e", "f");
+    PYSTRING_CHECK_EQUAL(buffer, "path: a/b/cc:\\e\\f" );
+    buffer.clear();
+    const JoinPart parts[] = { "c:", "d:/" };
+    join_append_nt(buffer, parts, 0);
+    PYSTRING_CHECK_EQUAL(buffer, "" );
+    join_append_nt(buffer, parts, 2);
+    PYSTRING_CHECK_EQUAL(buffer, "d:/" );
+
+    // The same as the vector versions
+    const char * atoms[] = { "", "a", "/", "\\", "c:", "b/", "\\x", "c:\\", "//" };
+    for(int i = 0; i < 9 * 9 * 9; ++i)
+    {
+        const char * a = atoms[i % 9], * b = atoms[i / 9 % 9], * c = atoms[i / 81];
+        std::vector< std::string > v;
+        v.push_back(a); v.push_back(b); v.push_back(c);
+        PYSTRING_CHECK_EQUAL(join_posix(a, b, c), join_posix(v));
+        PYSTRING_CHECK_EQUAL(join_nt(a, b, c), join_nt(v));
+    }
 }
 
 PYSTRING_ADD_TEST(pystring_os_path, normpath)
@@ -615,6 +760,23 @@ PYSTRING_ADD_TEST(pystring_os_path, normpath)
     PYSTRING_CHECK_EQUAL(normpath_posix("../A"), "../A" );
     PYSTRING_CHECK_EQUAL(normpath_posix("../A../"), "../A.." );
     PYSTRING_CHECK_EQUAL(normpath_posix("FOO/../A../././B"), "A../B" );
+    PYSTRING_CHECK_EQUAL(normpath_posix(""), "." );
+    PYSTRING_CHECK_EQUAL(normpath_posix("/"), "/" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("//"), "//" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("////"), "/" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("./"), "." );
+    PYSTRING_CHECK_EQUAL(normpath_posix("A/.."), "." );
+    PYSTRING_CHECK_EQUAL(normpath_posix("/.."), "/" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("//../A/"), "//A" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("A/../../B/../../C"), "../../C" );
+    PYSTRING_CHECK_EQUAL(normpath_posix("A/B/C/../../D/./E/.."), "A/D" );
+    PYSTRING_CHECK_EQUAL(normpath_posix(".../..A/A.."), ".../..A/A.." );
+
+    std::string temp = "/A//B/./C/../D/";
+    temp = normpath_posix(std::move(temp));
+    PYSTRING_CHECK_EQUAL(temp, "/A/B/D" );
+    PYSTRING_CHECK_EQUAL(normpath_posix(std::string("A/..")), "." );
+    PYSTRING_CHECK_EQUAL(normpath_posix(std::string()), "." );
     
     PYSTRING_CHECK_EQUAL(normpath_nt(""), "." );
     PYSTRING_CHECK_EQUAL(normpath_nt("A"), "A" );
@@ -626,6 +788,103 @@ PYSTRING_ADD_TEST(pystring_os_path, normpath)
     PYSTRING_CHECK_EQUAL(normpath_nt("C:/A..\\..\\"), "C:\\" );
     PYSTRING_CHECK_EQUAL(normpath_nt("C:\\\\A"), "C:\\A" );
     PYSTRING_CHECK_EQUAL(normpath_nt("C:\\\\\\A\\\\B"), "C:\\A\\B" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("C:"), "C:" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("C:..\\A"), "C:..\\A" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("C:\\..\\A"), "C:\\A" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("\\\\server\\mount\\..\\A"), "\\\\server\\A" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("//server/mount/./A/"), "\\\\server\\mount\\A" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("\\..\\A"), "\\A" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("A\\..\\..\\B/..\\..\\C"), "..\\..\\C" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("A/B\\C/../..\\D/./E/.."), "A\\D" );
+    PYSTRING_CHECK_EQUAL(normpath_nt("A/.."), "." );
+
+    temp = "C:/A//B/./C/../D/";
+    temp = normpath_nt(std::move(temp));
+    PYSTRING_CHECK_EQUAL(temp, "C:\\A\\B\\D" );
+    PYSTRING_CHECK_EQUAL(normpath_nt(std::string("\\\\")), "\\\\" );
+    PYSTRING_CHECK_EQUAL(normpath_nt(std::string()), "." );
+}
+
+PYSTRING_ADD_TEST(pystring_os_path, relpath)
+{
+    using namespace pystring::os::path;
+
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a/b/c", "/a", "/"), "b/c" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a", "/a/b/c", "/"), "../.." );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a/x/y", "/a/b/c", "/"), "../../x/y" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a/b", "/a/b", "/"), "." );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a//b/./c/", "/a/b/../b", "/"), "c" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/", "/a/b", "/"), "../.." );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/ab", "/a", "/"), "../ab" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/a/B", "/a/b", "/"), "../B" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("c", "a/b", "/home/user"), "../../c" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("/home/user/c", "", "/home/user"), "c" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("../x", "y", "/home/user"), "../../x" );
+    PYSTRING_CHECK_EQUAL(relpath_posix("", "/a", "/"), "" );
+
+    PYSTRING_CHECK_EQUAL(relpath_nt("c:\\a\\b\\c", "C:/A", "c:\\"), "b\\c" );
+    PYSTRING_CHECK_EQUAL(relpath_nt("c:\\a\\x", "c:\\a\\b\\c", "c:\\"), "..\\..\\x" );
+    PYSTRING_CHECK_EQUAL(relpath_nt("c:\\a", "c:\\A", "c:\\"), "." );
+    PYSTRING_CHECK_EQUAL(relpath_nt("b", "a", "d:\\cwd"), "..\\b" );
+    PYSTRING_CHECK_EQUAL(relpath_nt("\\\\server\\share\\a", "\\\\server\\share\\b", "c:\\"), "..\\a" );
+    PYSTRING_CHECK_EQUAL(relpath_nt("c:\\a", "d:\\a", "c:\\"), "" );
+    PYSTRING_CHECK_EQUAL(relpath_nt("\\\\server\\share\\a", "\\share\\a", "c:\\"), "" );
+}
+
+PYSTRING_ADD_TEST(pystring_os_path, commonpath)
+{
+    using namespace pystring::os::path;
+
+    std::vector< std::string > paths;
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "" );
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), "" );
+
+    paths.push_back("/usr/lib/");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "/usr/lib" );
+    paths.push_back("/usr/local//lib");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "/usr" );
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), "/usr/l" );
+    paths.push_back("/usr/l");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "/usr" );
+    paths.push_back("/");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "/" );
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), "/" );
+    paths.push_back("usr");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "" );
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), "" );
+
+    paths.clear();
+    paths.push_back("./a/./b/../c");
+    paths.push_back("a//b/../d");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "a/b/.." );
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), "" );
+    paths.push_back("b");
+    PYSTRING_CHECK_EQUAL(commonpath_posix(paths), "" );
+
+    paths.clear();
+    paths.push_back("C:/Program Files/a");
+    paths.push_back("c:\\program files\\b\\..");
+    PYSTRING_CHECK_EQUAL(commonpath_nt(paths), "C:\\Program Files" );
+    PYSTRING_CHECK_EQUAL(commonprefix_nt(paths), "" );
+    paths.push_back("c:program files");
+    PYSTRING_CHECK_EQUAL(commonpath_nt(paths), "" );
+    paths.back() = "d:\\program files";
+    PYSTRING_CHECK_EQUAL(commonpath_nt(paths), "" );
+    paths.back() = "\\\\server\\share";
+    PYSTRING_CHECK_EQUAL(commonpath_nt(paths), "" );
+
+    paths.clear();
+    paths.push_back("\\\\server\\share\\a\\b");
+    paths.push_back("//server/share/a/c");
+    PYSTRING_CHECK_EQUAL(commonpath_nt(paths), "\\\\server\\share\\a" );
+
+    // Long prefixes go through the vector mismatch search
+    paths.clear();
+    paths.push_back(std::string(100, 'x') + "/abc");
+    paths.push_back(std::string(100, 'x') + "/abd");
+    paths.push_back(std::string(100, 'x') + "/ab");
+    PYSTRING_CHECK_EQUAL(commonprefix(paths), std::string(100, 'x') + "/ab" );
+    PYSTRING_CHECK_EQUAL(commonpath(paths), std::string(100, 'x') );
 }
 
 PYSTRING_ADD_TEST(pystring_os_path, split)
@@ -652,7 +911,38 @@ PYSTRING_ADD_TEST(pystring_os_path, split)
     split_nt(head, tail, "c:\\a\\b");  PYSTRING_CHECK_EQUAL(head, "c:\\a" );  PYSTRING_CHECK_EQUAL(tail, "b" );
     split_nt(head, tail, "c:\\a\\b\\");  PYSTRING_CHECK_EQUAL(head, "c:\\a\\b" );  PYSTRING_CHECK_EQUAL(tail, "" );
     split_nt(head, tail, "D:\\dir\\\\");  PYSTRING_CHECK_EQUAL(head, "D:\\dir" );  PYSTRING_CHECK_EQUAL(tail, "" );
+    split_nt(head, tail, "c:/a/b");  PYSTRING_CHECK_EQUAL(head, "c:/a" );  PYSTRING_CHECK_EQUAL(tail, "b" );
+    split_nt(head, tail, "c:\\\\a");  PYSTRING_CHECK_EQUAL(head, "c:\\\\" );  PYSTRING_CHECK_EQUAL(tail, "a" );
+    split_nt(head, tail, "c:a");  PYSTRING_CHECK_EQUAL(head, "c:" );  PYSTRING_CHECK_EQUAL(tail, "a" );
+
+    // The path may also be one of the outputs
+    std::string path = "/a/b/c";
+    split_posix(path, tail, path);  PYSTRING_CHECK_EQUAL(path, "/a/b" );  PYSTRING_CHECK_EQUAL(tail, "c" );
+    split_posix(head, path, path);  PYSTRING_CHECK_EQUAL(head, "/a" );  PYSTRING_CHECK_EQUAL(path, "b" );
 
+#ifdef PYSTRING_HAVE_CXX17
+    const char * paths[] = { "", "/", "a", "a/", "/a", "/a/b/", "/a/b", "//a//b//", "c:\\a", "c:\\a\\b\\", "c:", "\\\\a\\b" };
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i)
+    {
+        std::string_view h, t;
+        split_view_posix(h, t, paths[i]);
+        split_posix(head, tail, paths[i]);
+        PYSTRING_CHECK_EQUAL(h, head);  PYSTRING_CHECK_EQUAL(t, tail);
+        PYSTRING_CHECK_EQUAL(basename_view_posix(paths[i]), basename_posix(paths[i]));
+        PYSTRING_CHECK_EQUAL(dirname_view_posix(paths[i]), dirname_posix(paths[i]));
+
+        split_view_nt(h, t, paths[i]);
+        split_nt(head, tail, paths[i]);
+        PYSTRING_CHECK_EQUAL(h, head);  PYSTRING_CHECK_EQUAL(t, tail);
+        PYSTRING_CHECK_EQUAL(basename_view_nt(paths[i]), basename_nt(paths[i]));
+        PYSTRING_CHECK_EQUAL(dirname_view_nt(paths[i]), dirname_nt(paths[i]));
+    }
+
+    // The views point into the path
+    std::string_view view = "/show/seq/shot.exr", h, t;
+    split_view(h, t, view);
+    PYSTRING_CHECK_ASSERT(h.data() == view.data() && t.data() == view.data() + 10);
+#endif
 }
 
 PYSTRING_ADD_TEST(pystring_os_path, splitext)
@@ -669,4 +959,1621 @@ PYSTRING_ADD_TEST(pystring_os_path, splitext)
     splitext_nt(root, ext, "a_b.c"); PYSTRING_CHECK_EQUAL(root, "a_b"); PYSTRING_CHECK_EQUAL(ext, ".c");
     splitext_nt(root, ext, "c:\\a.b.c"); PYSTRING_CHECK_EQUAL(root, "c:\\a.b"); PYSTRING_CHECK_EQUAL(ext, ".c");
     splitext_nt(root, ext, "c:\\a_b.c"); PYSTRING_CHECK_EQUAL(root, "c:\\a_b"); PYSTRING_CHECK_EQUAL(ext, ".c");
+    splitext_nt(root, ext, "c:\\a.b/c"); PYSTRING_CHECK_EQUAL(root, "c:\\a.b/c"); PYSTRING_CHECK_EQUAL(ext, "");
+
+    // Every leading dot of the file name is skipped, as in python
+    splitext_posix(root, ext, "..foo"); PYSTRING_CHECK_EQUAL(root, "..foo"); PYSTRING_CHECK_EQUAL(ext, "");
+    splitext_posix(root, ext, "a/..."); PYSTRING_CHECK_EQUAL(root, "a/..."); PYSTRING_CHECK_EQUAL(ext, "");
+    splitext_posix(root, ext, "a/..b.c"); PYSTRING_CHECK_EQUAL(root, "a/..b"); PYSTRING_CHECK_EQUAL(ext, ".c");
+    splitext_posix(root, ext, "a.b\\c"); PYSTRING_CHECK_EQUAL(root, "a"); PYSTRING_CHECK_EQUAL(ext, ".b\\c");
+    splitext_posix(root, ext, "a.b/c"); PYSTRING_CHECK_EQUAL(root, "a.b/c"); PYSTRING_CHECK_EQUAL(ext, "");
+
+    std::string path = "shot.0001.exr";
+    splitext_posix(path, ext, path); PYSTRING_CHECK_EQUAL(path, "shot.0001"); PYSTRING_CHECK_EQUAL(ext, ".exr");
+
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view r, e;
+    splitext_view_posix(r, e, "/show/shot.0001.exr"); PYSTRING_CHECK_EQUAL(r, "/show/shot.0001"); PYSTRING_CHECK_EQUAL(e, ".exr");
+    splitext_view_nt(r, e, "c:\\show.v1\\..shot"); PYSTRING_CHECK_EQUAL(r, "c:\\show.v1\\..shot"); PYSTRING_CHECK_EQUAL(e, "");
+    splitext_view(r, e, "shot."); PYSTRING_CHECK_EQUAL(r, "shot"); PYSTRING_CHECK_EQUAL(e, ".");
+#endif
+}
+
+PYSTRING_ADD_TEST(pystring, caseless)
+{
+    const std::string path = "C:\\Program Files\\Studio\\Assets\\Characters\\Hero\\HERO_diffuse.TIF";
+
+    PYSTRING_CHECK_EQUAL(pystring::iequals("", ""), true);
+    PYSTRING_CHECK_EQUAL(pystring::iequals("abc", "ABC"), true);
+    PYSTRING_CHECK_EQUAL(pystring::iequals("abc", "ABCD"), false);
+    PYSTRING_CHECK_EQUAL(pystring::iequals("a@c", "A`C"), false);
+    PYSTRING_CHECK_EQUAL(pystring::iequals(path, pystring::lower(path)), true);
+    PYSTRING_CHECK_EQUAL(pystring::iequals(path, pystring::upper(path)), true);
+    PYSTRING_CHECK_EQUAL(pystring::iequals(path, pystring::replace(pystring::upper(path), "\\", "/")), false);
+    PYSTRING_CHECK_EQUAL(pystring::iequals("caf\xc3\xa9", "CAF\xc3\xa9"), true);
+    PYSTRING_CHECK_EQUAL(pystring::iequals("caf\xc3\xa9", "CAF\xc3\x89"), false);
+
+    PYSTRING_CHECK_EQUAL(pystring::istartswith(path, "c:\\program files"), true);
+    PYSTRING_CHECK_EQUAL(pystring::istartswith(path, "d:\\"), false);
+    PYSTRING_CHECK_EQUAL(pystring::istartswith(path, "program", 3), true);
+    PYSTRING_CHECK_EQUAL(pystring::iendswith(path, ".tif"), true);
+    PYSTRING_CHECK_EQUAL(pystring::iendswith(path, ".tiff"), false);
+    PYSTRING_CHECK_EQUAL(pystring::iendswith(path, "DIFFUSE", 0, -4), true);
+    PYSTRING_CHECK_EQUAL(pystring::iendswith("", ""), true);
+
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "hero"), 42);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "hero", 43), 47);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "HERO", 0, 45), -1);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "h"), 32);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "villain"), -1);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, ""), 0);
+    PYSTRING_CHECK_EQUAL(pystring::ifind(path, "", 5), 5);
+    PYSTRING_CHECK_EQUAL(pystring::ifind("", "a"), -1);
+
+    PYSTRING_CHECK_EQUAL(pystring::icount(path, "hero"), 2);
+    PYSTRING_CHECK_EQUAL(pystring::icount(path, "\\"), 6);
+    PYSTRING_CHECK_EQUAL(pystring::icount(path, "hero", 43), 1);
+    PYSTRING_CHECK_EQUAL(pystring::icount("aAaA", "aa"), 2);
+    PYSTRING_CHECK_EQUAL(pystring::icount("abc", ""), 4);
+    PYSTRING_CHECK_EQUAL(pystring::icount("abc", "", 1), 3);
+    PYSTRING_CHECK_EQUAL(pystring::icount("", "a"), 0);
+
+    PYSTRING_CHECK_EQUAL(pystring::casefold(""), "");
+    PYSTRING_CHECK_EQUAL(pystring::casefold("Hero_DIFFUSE.tif"), "hero_diffuse.tif");
+}
+
+PYSTRING_ADD_TEST(pystring, allocations)
+{
+    const std::string text = "the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog";
+    const std::string word = "lazy", prefix = "the quick", space = " ";
+    const std::string path = "/a_directory_name/longer_than/the_small_string/buffer_of_std_string";
+
+    // Warm up first; with PYSTRING_STATS the first call of a function allocates its counters
+    std::vector< std::string > words;
+    pystring::find(text, word); pystring::rfind(text, word); pystring::count(text, word);
+    pystring::startswith(text, prefix); pystring::endswith(text, word);
+    pystring::ifind(text, word); pystring::icount(text, word); pystring::iequals(text, text);
+    pystring::istartswith(text, prefix); pystring::iendswith(text, word);
+    pystring::split(path, words, "/");
+    pystring::split(text, words, space);
+
+    PYSTRING_CHECK_ALLOCS(pystring::find(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::rfind(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::count(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::startswith(text, prefix), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::endswith(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::ifind(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::icount(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::iequals(text, text), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::istartswith(text, prefix), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::iendswith(text, word), 0);
+
+    // Splitting again into the same vector reuses its strings
+    PYSTRING_CHECK_ALLOCS(pystring::split(text, words, space), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::split(text, words), 0);
+    PYSTRING_CHECK_EQUAL(words.size(), 18);
+    PYSTRING_CHECK_EQUAL(words[17], "dog");
+
+    const std::string sep = "/";
+    pystring::split(path, words, sep);
+    PYSTRING_CHECK_ALLOCS(pystring::split(path, words, sep), 0);
+    PYSTRING_CHECK_EQUAL(words.size(), 5);
+    PYSTRING_CHECK_EQUAL(words[4], "buffer_of_std_string");
+
+#ifdef PYSTRING_HAVE_CXX17
+    std::vector< std::string_view > views;
+    pystring::split(text, views);
+    PYSTRING_CHECK_ALLOCS(pystring::split(path, views, "/"), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::split(text, views), 0);
+    PYSTRING_CHECK_EQUAL(views.size(), 18);
+    PYSTRING_CHECK_EQUAL(views[1], "quick");
+    PYSTRING_CHECK_EQUAL(views[17], "dog");
+
+    pystring::partition_view(text, word); pystring::rpartition_view(text, word);
+    PYSTRING_CHECK_ALLOCS(pystring::partition_view(text, word), 0);
+    PYSTRING_CHECK_ALLOCS(pystring::rpartition_view(path, "/"), 0);
+#endif
+}
+
+PYSTRING_ADD_TEST(pystring_os_path, allocations)
+{
+    using namespace pystring::os::path;
+
+    const std::string posix = "/usr/local/lib/libpystring_with_a_long_name.so";
+    const std::string nt = "C:\\Program Files\\pystring\\pystring_with_a_long_name.dll";
+    const std::string relative = "relative/path/to/a/file/with/a/long/name.txt";
+
+    isabs_posix(posix); isabs_nt(nt); isabs(relative);
+
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(isabs_posix(posix), true), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(isabs_nt(nt), true), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(isabs(relative), false), 0);
+
+    // One allocation for the result, or none when normalizing a temporary in place
+    std::string temp = posix + "/.././/lib.so";
+    normpath_posix(posix);
+    PYSTRING_CHECK_ALLOCS(normpath_posix(posix), 1);
+    PYSTRING_CHECK_ALLOCS(temp = normpath_posix(std::move(temp)), 0);
+    PYSTRING_CHECK_EQUAL(temp, "/usr/local/lib/lib.so");
+
+    temp = nt + "\\..\\.\\/pystring.dll";
+    normpath_nt(nt);
+    PYSTRING_CHECK_ALLOCS(normpath_nt(nt), 1);
+    PYSTRING_CHECK_ALLOCS(temp = normpath_nt(std::move(temp)), 0);
+    PYSTRING_CHECK_EQUAL(temp, "C:\\Program Files\\pystring\\pystring.dll");
+
+    // The relative path is built in one allocation
+    const std::string cwd = "/home/user/a/long/working/directory", start = "c:\\Program Files\\other\\dir";
+    relpath_posix(posix, relative, cwd);
+    PYSTRING_CHECK_ALLOCS(relpath_posix(posix, relative, cwd), 1);
+    relpath_nt(nt, start, cwd);
+    PYSTRING_CHECK_ALLOCS(relpath_nt(nt, start, cwd), 1);
+
+    std::vector< std::string > paths;
+    paths.push_back(posix);
+    paths.push_back(posix + "/../other_library_with_a_long_name.so");
+    PYSTRING_CHECK_ALLOCS(commonpath_posix(paths), 1);
+    PYSTRING_CHECK_ALLOCS(commonprefix(paths), 1);
+
+    // Joins allocate their result once, or not at all into a buffer with room
+    PYSTRING_CHECK_ALLOCS(join_posix(posix, relative), 1);
+    PYSTRING_CHECK_ALLOCS(join_nt(nt, "..", relative, "file.txt"), 1);
+    std::string buffer;
+    join_append_posix(buffer, posix, "..", relative);
+    buffer.clear();
+    PYSTRING_CHECK_ALLOCS(join_append_posix(buffer, posix, "..", relative), 0);
+    buffer.clear();
+    PYSTRING_CHECK_ALLOCS(join_append_nt(buffer, "c:", nt, "file.txt"), 0);
+
+    // Splitting into strings that are big enough already does not allocate
+    std::string head, tail;
+    split_posix(head, tail, posix); splitdrive_nt(head, tail, nt); splitext_posix(head, tail, relative);
+    PYSTRING_CHECK_ALLOCS(split_posix(head, tail, posix), 0);
+    PYSTRING_CHECK_ALLOCS(split_nt(head, tail, nt), 0);
+    PYSTRING_CHECK_ALLOCS(splitext_posix(head, tail, relative), 0);
+    PYSTRING_CHECK_ALLOCS(splitdrive_nt(head, tail, nt), 0);
+
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view h, t;
+    PYSTRING_CHECK_ALLOCS(split_view_nt(h, t, nt), 0);
+    PYSTRING_CHECK_ALLOCS(splitext_view_posix(h, t, relative), 0);
+    PYSTRING_CHECK_ALLOCS(splitdrive_view_nt(h, t, nt), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(basename_view_posix(posix), "libpystring_with_a_long_name.so"), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(dirname_view_nt(nt), "C:\\Program Files\\pystring"), 0);
+#endif
+}
+
+PYSTRING_ADD_TEST(pystring_normcache, results)
+{
+    using namespace pystring::os::path;
+
+    const char * paths[] = { "", ".", "/", "a/./b", "/a/../b/", "a/b/c", "../a//b", "/a/b/../../..", "a" };
+    NormCache cache;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i)
+        {
+            PYSTRING_CHECK_EQUAL(cache.normpath(paths[i]), normpath(paths[i]));
+            PYSTRING_CHECK_EQUAL(cache.dirname(paths[i]), dirname(paths[i]));
+            PYSTRING_CHECK_EQUAL(cache.abspath(paths[i], "/cwd/x"), abspath(paths[i], "/cwd/x"));
+            PYSTRING_CHECK_EQUAL(cache.abspath(paths[i], "/cwd/y"), abspath(paths[i], "/cwd/y"));
+        }
+    }
+
+    // abspath() of an absolute path hits the entry normpath() added
+    NormCache::Stats stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.misses, 30);
+    PYSTRING_CHECK_EQUAL(stats.hits, 42);
+    PYSTRING_CHECK_EQUAL(stats.entries, 30);
+    PYSTRING_CHECK_EQUAL(stats.evictions, 0);
+
+    const std::string hit = "a/./b";
+    PYSTRING_CHECK_ALLOCS(cache.normpath(hit), 0);
+
+    cache.clear();
+    stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.entries, 0);
+    PYSTRING_CHECK_EQUAL(stats.bytes, 0);
+    PYSTRING_CHECK_EQUAL(stats.hits, 0);
+}
+
+PYSTRING_ADD_TEST(pystring_normcache, eviction)
+{
+    using namespace pystring::os::path;
+
+    // Room for three entries of the same size in a single shard
+    NormCache probe;
+    probe.normpath("a/./0");
+    NormCache cache(3 * probe.stats().bytes, 1);
+
+    cache.normpath("a/./0"); cache.normpath("a/./1"); cache.normpath("a/./2");
+    cache.normpath("a/./0");
+    cache.normpath("a/./3");
+
+    // 0 was used since it was added, so 1 goes first
+    NormCache::Stats stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.evictions, 1);
+    PYSTRING_CHECK_EQUAL(stats.entries, 3);
+    PYSTRING_CHECK_EQUAL(stats.bytes, 3 * probe.stats().bytes);
+
+    cache.normpath("a/./0");
+    PYSTRING_CHECK_EQUAL(cache.stats().hits, 2);
+    cache.normpath("a/./1");
+    PYSTRING_CHECK_EQUAL(cache.stats().misses, 5);
+
+    // Results that do not fit are still returned
+    NormCache tiny(16, 1);
+    PYSTRING_CHECK_EQUAL(tiny.normpath("a//b"), "a/b");
+    PYSTRING_CHECK_EQUAL(tiny.stats().entries, 0);
+}
+
+PYSTRING_ADD_TEST(pystring_normcache, threads)
+{
+    using namespace pystring::os::path;
+
+    NormCache cache(4096, 4);
+    std::vector< std::string > paths;
+    for (int i = 0; i < 200; ++i) paths.push_back("/show/seq" + pystring::zfill(std::to_string(i % 50), 3) + "/../shot/./" + std::to_string(i));
+
+    std::vector< int > failures(4, 0);
+    std::vector< std::thread > threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            for (int round = 0; round < 50; ++round)
+            {
+                for (size_t i = 0; i < paths.size(); ++i)
+                {
+                    const std::string & path = paths[(i * 7 + t * 13) % paths.size()];
+                    if (cache.normpath(path) != normpath(path) || cache.dirname(path) != dirname(path)) ++failures[t];
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+
+    for (int t = 0; t < 4; ++t) PYSTRING_CHECK_EQUAL(failures[t], 0);
+    NormCache::Stats stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.hits + stats.misses, 4 * 50 * 200 * 2);
+    PYSTRING_CHECK_ASSERT(stats.evictions > 0);
+    PYSTRING_CHECK_ASSERT(stats.bytes <= 4096);
+}
+
+PYSTRING_ADD_TEST(pystring_interner, intern)
+{
+    pystring::Interner interner;
+
+    pystring::Interner::Id a = interner.intern("shot010");
+    pystring::Interner::Id b = interner.intern(std::string("shot020"));
+    pystring::Interner::Id empty = interner.intern("");
+    pystring::Interner::Id nul = interner.intern(std::string("a\0b", 3));
+
+    PYSTRING_CHECK_ASSERT(a != b && a != empty && b != empty && nul != a);
+    PYSTRING_CHECK_EQUAL(interner.intern(std::string("shot") + "010"), a);
+    PYSTRING_CHECK_EQUAL(interner.find("shot020"), b);
+    PYSTRING_CHECK_EQUAL(interner.find("shot030"), pystring::Interner::NONE);
+    PYSTRING_CHECK_EQUAL(interner.size(), 4);
+
+    PYSTRING_CHECK_EQUAL(std::string(interner.c_str(a)), "shot010");
+    PYSTRING_CHECK_EQUAL(interner.length(b), 7);
+    PYSTRING_CHECK_EQUAL(interner.str(empty), "");
+    PYSTRING_CHECK_EQUAL(interner.str(nul), std::string("a\0b", 3));
+
+    // Strings stay where they are while the table grows
+    const char * where = interner.c_str(a);
+    std::vector< pystring::Interner::Id > ids;
+    for (int i = 0; i < 100000; ++i) ids.push_back(interner.intern("token" + std::to_string(i)));
+    PYSTRING_CHECK_EQUAL(interner.size(), 100004);
+    PYSTRING_CHECK_ASSERT(interner.c_str(a) == where);
+
+    bool same = true;
+    for (int i = 0; i < 100000; ++i)
+    {
+        same = same && interner.str(ids[i]) == "token" + std::to_string(i);
+        same = same && interner.find("token" + std::to_string(i)) == ids[i];
+    }
+    PYSTRING_CHECK_ASSERT(same);
+
+    std::string longer(100000, 'x');
+    pystring::Interner::Id big = interner.intern(longer);
+    PYSTRING_CHECK_EQUAL(interner.intern(longer), big);
+    PYSTRING_CHECK_EQUAL(interner.length(big), 100000);
+    PYSTRING_CHECK_ASSERT(interner.bytes() > 100000);
+
+    PYSTRING_CHECK_ALLOCS(interner.intern(longer), 0);
+    PYSTRING_CHECK_ALLOCS(interner.find("token99999"), 0);
+
+#ifdef PYSTRING_HAVE_CXX17
+    std::string_view view = "shot010 and more";
+    PYSTRING_CHECK_EQUAL(interner.intern(view.substr(0, 7)), a);
+    PYSTRING_CHECK_EQUAL(interner.view(b), "shot020");
+#endif
+}
+
+PYSTRING_ADD_TEST(pystring_interner, split)
+{
+    pystring::Interner interner;
+    std::vector< pystring::Interner::Id > ids;
+
+    pystring::split(interner, "/show/seq010/sh0100/seq010", ids, "/");
+    PYSTRING_CHECK_EQUAL(ids.size(), 5);
+    PYSTRING_CHECK_EQUAL(interner.str(ids[0]), "");
+    PYSTRING_CHECK_EQUAL(interner.str(ids[3]), "sh0100");
+    PYSTRING_CHECK_EQUAL(ids[2], ids[4]);
+    PYSTRING_CHECK_EQUAL(interner.size(), 4);
+
+    pystring::split(interner, "  a b  a ", ids);
+    PYSTRING_CHECK_EQUAL(ids.size(), 3);
+    PYSTRING_CHECK_EQUAL(ids[0], ids[2]);
+    PYSTRING_CHECK_EQUAL(interner.str(ids[1]), "b");
+
+    pystring::split(interner, "a,b,c,d", ids, ",", 2);
+    PYSTRING_CHECK_EQUAL(ids.size(), 3);
+    PYSTRING_CHECK_EQUAL(interner.str(ids[2]), "c,d");
+
+    pystring::Interner::Id head, tail;
+    pystring::os::path::split(interner, head, tail, "/show/seq010/sh0100");
+    PYSTRING_CHECK_EQUAL(interner.str(head), "/show/seq010");
+    PYSTRING_CHECK_EQUAL(tail, interner.find("sh0100"));
+    PYSTRING_CHECK_EQUAL(interner.str(tail), "sh0100");
+
+    // Splitting again reuses the scratch words and the result
+    const std::string path = "/show/a_sequence_name/a_shot_name/a_task_name/file.exr";
+    pystring::split(interner, path, ids, "/");
+    PYSTRING_CHECK_ALLOCS(pystring::split(interner, path, ids, "/"), 0);
+
+#ifdef PYSTRING_HAVE_CXX17
+    pystring::os::path::split(interner, head, tail, path);
+    PYSTRING_CHECK_ALLOCS(pystring::os::path::split(interner, head, tail, path), 0);
+#endif
+}
+
+PYSTRING_ADD_TEST(pystring_interner, threads)
+{
+    pystring::Interner interner;
+    const int THREADS = 4, STRINGS = 20000;
+
+    // Every thread interns the same strings in a different order
+    std::vector< std::vector< pystring::Interner::Id > > ids(THREADS, std::vector< pystring::Interner::Id >(STRINGS));
+    std::vector< std::thread > threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            for (int i = 0; i < STRINGS; ++i)
+            {
+                int k = (i * 7919 + t * 104729) % STRINGS;
+                ids[t][k] = interner.intern("/show/seq" + std::to_string(k % 100) + "/shot" + std::to_string(k));
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+
+    bool same = true;
+    for (int t = 1; t < THREADS; ++t) same = same && ids[t] == ids[0];
+    PYSTRING_CHECK_ASSERT(same);
+    PYSTRING_CHECK_EQUAL(interner.size(), STRINGS);
+    PYSTRING_CHECK_EQUAL(interner.str(ids[0][1234]), "/show/seq34/shot1234");
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+namespace
+{
+    std::string joined(const pystring::os::path::PathRef & path)
+    {
+        std::vector< std::string_view > parts;
+        path.parts(parts);
+        std::string out;
+        for(size_t i = 0; i < parts.size(); ++i) out.append(i ? "|" : "").append(parts[i]);
+        return out;
+    }
+}
+
+PYSTRING_ADD_TEST(pystring_pathref, parts)
+{
+    using pystring::os::path::PathRef;
+
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("")), "");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix(".")), "");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("/")), "/");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("a/b")), "a|b");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("/a//b/./c/")), "/|a|b|c");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("//a/../b")), "//|a|..|b");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("///a")), "/|a");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::posix("c:\\a\\b")), "c:\\a\\b");
+
+    PYSTRING_CHECK_EQUAL(joined(PathRef::nt("c:\\a\\b")), "c:\\|a|b");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::nt("c:a/b")), "c:|a|b");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::nt("\\a/.\\b")), "\\|a|b");
+    PYSTRING_CHECK_EQUAL(joined(PathRef::nt("c:")), "c:");
+
+    PathRef path = PathRef::nt("C:/show\\seq");
+    PYSTRING_CHECK_EQUAL(path.size(), 3);
+    PYSTRING_CHECK_EQUAL(path[0], "C:/");
+    PYSTRING_CHECK_EQUAL(path[2], "seq");
+    PYSTRING_CHECK_EQUAL(path.drive(), "C:");
+    PYSTRING_CHECK_EQUAL(path.root(), "/");
+    PYSTRING_CHECK_ASSERT(path.isabs());
+    PYSTRING_CHECK_ASSERT(!PathRef::nt("c:a").isabs());
+    PYSTRING_CHECK_ASSERT(PathRef::posix("/a").isabs());
+    PYSTRING_CHECK_EQUAL(PathRef::posix("/a").drive(), "");
+
+    // Paths deeper than the inline names
+    std::string deep;
+    for(int i = 0; i < 40; ++i) deep += "/d" + pystring::mul("x", i);
+    PathRef d = PathRef::posix(deep);
+    PYSTRING_CHECK_EQUAL(d.size(), 41);
+    PYSTRING_CHECK_EQUAL(d[40], "d" + pystring::mul("x", 39));
+    PYSTRING_CHECK_EQUAL(d.parent(20), deep.substr(0, deep.find("/dxxxxxxxxxxxxxxxxxxx")));
+
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(PathRef::posix("/show/seq/shot/task/file.exr").name(), "file.exr"), 0);
+}
+
+PYSTRING_ADD_TEST(pystring_pathref, queries)
+{
+    using pystring::os::path::PathRef;
+
+    PathRef path = PathRef::posix("/show/seq/shot.v001.tar.gz");
+    PYSTRING_CHECK_EQUAL(path.name(), "shot.v001.tar.gz");
+    PYSTRING_CHECK_EQUAL(path.stem(), "shot.v001.tar");
+    PYSTRING_CHECK_EQUAL(path.suffix(), ".gz");
+    std::vector< std::string_view > suffixes;
+    path.suffixes(suffixes);
+    PYSTRING_CHECK_EQUAL(suffixes.size(), 3);
+    PYSTRING_CHECK_EQUAL(suffixes[0], ".v001");
+    PYSTRING_CHECK_EQUAL(suffixes[2], ".gz");
+
+    PYSTRING_CHECK_EQUAL(path.parent(), "/show/seq");
+    PYSTRING_CHECK_EQUAL(path.parent(1), "/show");
+    PYSTRING_CHECK_EQUAL(path.parent(2), "/");
+    PYSTRING_CHECK_EQUAL(path.parent(5), "/");
+    PYSTRING_CHECK_EQUAL(PathRef::posix("a").parent(), ".");
+    PYSTRING_CHECK_EQUAL(PathRef::posix("a/./b//c").parent(), "a/./b");
+    PYSTRING_CHECK_EQUAL(PathRef::nt("c:a").parent(), "c:");
+
+    // Dots at either end of the name
+    PathRef dots = PathRef::posix(".bashrc");
+    PYSTRING_CHECK_EQUAL(dots.stem(), ".bashrc");
+    PYSTRING_CHECK_EQUAL(dots.suffix(), "");
+    dots.suffixes(suffixes);
+    PYSTRING_CHECK_EQUAL(suffixes.size(), 0);
+    PYSTRING_CHECK_EQUAL(PathRef::posix("a.").suffix(), "");
+    PYSTRING_CHECK_EQUAL(PathRef::posix("a.").stem(), "a.");
+    PathRef::posix("..a..b").suffixes(suffixes);
+    PYSTRING_CHECK_EQUAL(suffixes.size(), 2);
+    PYSTRING_CHECK_EQUAL(suffixes[0], ".");
+    PYSTRING_CHECK_EQUAL(suffixes[1], ".b");
+    PYSTRING_CHECK_EQUAL(PathRef::posix("/").name(), "");
+
+    PathRef base = PathRef::posix("/show//seq/");
+    PYSTRING_CHECK_ASSERT(path.is_relative_to(base));
+    PYSTRING_CHECK_EQUAL(path.relative_to(base), "shot.v001.tar.gz");
+    PYSTRING_CHECK_EQUAL(path.relative_to(PathRef::posix("/")), "show/seq/shot.v001.tar.gz");
+    PYSTRING_CHECK_EQUAL(base.relative_to(PathRef::posix("/show/./seq")), ".");
+    PYSTRING_CHECK_ASSERT(!path.is_relative_to(PathRef::posix("show/seq")));
+    PYSTRING_CHECK_ASSERT(!path.is_relative_to(PathRef::posix("/show/se")));
+    PYSTRING_CHECK_ASSERT(!base.is_relative_to(path));
+    PYSTRING_CHECK_EQUAL(path.relative_to(PathRef::posix("/other")), "");
+
+    PathRef nt = PathRef::nt("C:\\Show\\Seq\\shot.exr");
+    PYSTRING_CHECK_EQUAL(nt.relative_to(PathRef::nt("c:/show")), "Seq\\shot.exr");
+    PYSTRING_CHECK_ASSERT(!nt.is_relative_to(PathRef::nt("d:/show")));
+    PYSTRING_CHECK_ASSERT(!nt.is_relative_to(PathRef::nt("c:show")));
+    PYSTRING_CHECK_ASSERT(!PathRef::posix("/Show/a").is_relative_to(PathRef::posix("/show")));
+}
+#endif
+
+PYSTRING_ADD_TEST(pystring_fnmatch, fnmatchcase)
+{
+    using pystring::fnmatch::fnmatchcase;
+
+    PYSTRING_CHECK_ASSERT(fnmatchcase("", ""));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("", "*"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("", "?"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "abc"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("abcd", "abc"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "?*?"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "???*"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "*???"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("abc", "????*"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "*abc"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "ab[cd]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abc", "ab[!de]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("abc", "ab[de]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("a", "??"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("a", "b"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("Abc", "abc"));
+
+    // Stars, "?" and sets all match "/" and newlines
+    PYSTRING_CHECK_ASSERT(fnmatchcase("a/b/c.exr", "a*.exr"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("a/b", "a?b"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("a/b", "a[/]b"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("foo\nbar", "foo*"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("\nfoo", "*foo"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("\n", "?"));
+
+    // The segments between stars are found in order, and must not overlap
+    PYSTRING_CHECK_ASSERT(fnmatchcase("/show/publish/shot.usd", "*/publish/*.usd"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("/show/publish.usd", "*/publish/*.usd"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("abab", "a*b*ab"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("aba", "a*ba*ba"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("xaxbxaxb", "*a?b*a?b"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("xaxbxaxc", "*a?b*a?b"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("shot_010/anim/v003", "shot_[0-9]?[0-9]/*/v[0-9][0-9][0-9]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("shot_01a/anim/v003", "shot_[0-9]?[0-9]/*/v[0-9][0-9][0-9]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase(std::string(1000, 'a') + "b", "*a*a*a*b"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase(std::string(1000, 'a'), "*a*a*a*b"));
+
+    // Brackets the way python reads them
+    PYSTRING_CHECK_ASSERT(fnmatchcase("[", "["));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("[!", "[!"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("[]", "[]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("]", "[]]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("a", "[!]]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("]", "[!]]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("*", "[*]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("a", "[*]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("\\", "[\\]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("\\a", "\\a"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("-", "[-a]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("-", "[a-]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("-", "[!a]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("b", "[a-c]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("-", "[a-c]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("-", "[--]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("-", "[!-a-]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("b", "[a-c-e]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("-", "[a-c-e]"));
+
+    // A range going backwards is dropped with its hyphen, and an empty set matches nothing
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("b", "[z-a]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("-", "[z-a]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("b", "[!z-a]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("c", "[a-cz-a]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("z", "[a-cz-a]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("x", "[ax-z-a]"));
+    PYSTRING_CHECK_ASSERT(!fnmatchcase("c", "[!z-ab-c]"));
+    PYSTRING_CHECK_ASSERT(fnmatchcase("z", "[!z-ab-c]"));
+
+    pystring::fnmatch::Pattern pattern("*.EXR", true);
+    PYSTRING_CHECK_ASSERT(pattern.match(std::string("C:/show/a.exr")));
+    PYSTRING_CHECK_ASSERT(pystring::fnmatch::Pattern("c:/show/*", true).match(std::string("C:\\Show\\a")));
+    PYSTRING_CHECK_ASSERT(!pystring::fnmatch::Pattern("[A-Z]", true).match(std::string("_")));
+    PYSTRING_CHECK_ASSERT(!pystring::fnmatch::Pattern("*.EXR").match(std::string("a.exr")));
+#ifdef PYSTRING_HAVE_CXX17
+    PYSTRING_CHECK_ASSERT(pattern.match(std::string_view("b.Exr")));
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+    PYSTRING_CHECK_ASSERT(pystring::fnmatch::fnmatch("A/B.txt", "a\\*.TXT"));
+#else
+    PYSTRING_CHECK_ASSERT(!pystring::fnmatch::fnmatch("A/B.txt", "a\\*.TXT"));
+    PYSTRING_CHECK_ASSERT(pystring::fnmatch::fnmatch("a/b.txt", "a/*.txt"));
+#endif
+
+    const std::string name = "/show/seq/shot/render/beauty.0101.exr", pat = "*/render/*.[0-9][0-9][0-9][0-9].exr";
+    PYSTRING_CHECK_ASSERT(fnmatchcase(name, pat));
+    PYSTRING_CHECK_ASSERT(pattern.match(name));
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_ASSERT(fnmatchcase(name, pat)), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_ASSERT(pattern.match(name)), 0);
+}
+
+PYSTRING_ADD_TEST(pystring_fnmatch, filter)
+{
+    std::vector< std::string > names = { "a.py", "b.PY", "c.txt", "d/e.py", ".py" };
+    std::vector< std::string > result = pystring::fnmatch::filter(names, "*.py");
+#if defined(_WIN32) || defined(_WIN64)
+    PYSTRING_CHECK_EQUAL(result.size(), 4);
+#else
+    PYSTRING_CHECK_EQUAL(result.size(), 3);
+    PYSTRING_CHECK_EQUAL(result[1], "d/e.py");
+#endif
+    PYSTRING_CHECK_EQUAL(result[0], "a.py");
+    PYSTRING_CHECK_EQUAL(pystring::fnmatch::filter(names, "?").size(), 0);
+
+    // Big enough to be shared between threads, which must give the serial result
+    std::vector< std::string > many;
+    for(int i = 0; i < 100000; ++i) many.push_back("/show/shot_" + std::to_string(i % 997) + "/v" + std::to_string(i) + ".exr");
+
+    pystring::fnmatch::Pattern pattern("*/shot_1[0-9]/*[13579].exr");
+    std::vector< size_t > serial, parallel;
+    pystring::fnmatch::filter(many, pattern, serial, 1);
+    PYSTRING_CHECK_EQUAL(serial.size(), 505);
+    for(size_t threads : { 0, 2, 3, 8 })
+    {
+        pystring::fnmatch::filter(many, pattern, parallel, (unsigned int) threads);
+        PYSTRING_CHECK_ASSERT(parallel == serial);
+    }
+    for(size_t i : serial) PYSTRING_CHECK_ASSERT(pattern.match(many[i]));
+}
+
+namespace
+{
+    std::string joined(const pystring::os::path::PathTrie & trie, const std::string & path)
+    {
+        std::vector< std::string > paths;
+        trie.subtree(path, paths);
+        return pystring::join("|", paths);
+    }
+}
+
+PYSTRING_ADD_TEST(pystring_pathtrie, posix)
+{
+    using pystring::os::path::PathTrie;
+
+    PathTrie trie = PathTrie::posix();
+    PYSTRING_CHECK_EQUAL(trie.size(), 0);
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("/show"), PathTrie::NONE);
+
+    PathTrie::Node shot = trie.insert("/show/seq/shot");
+    PYSTRING_CHECK_EQUAL(trie.insert("/show//seq/./shot/"), shot);
+    PYSTRING_CHECK_EQUAL(trie.insert("/show/seq/x/../shot"), shot);
+    PYSTRING_CHECK_EQUAL(trie.size(), 1);
+    PYSTRING_CHECK_EQUAL(trie.path(shot), "/show/seq/shot");
+
+    trie.insert("/show/seq/shot2");
+    trie.insert("/show/seq/shot/anim/v001");
+    trie.insert("/show/seq/shot/comp");
+    trie.insert("/show");
+    trie.insert("show/seq");
+    trie.insert("//net/show");
+    PYSTRING_CHECK_EQUAL(trie.size(), 7);
+
+    PYSTRING_CHECK_EQUAL(trie.find("/show/seq/shot"), shot);
+    PYSTRING_CHECK_ASSERT(trie.contains("/show"));
+    PYSTRING_CHECK_ASSERT(!trie.contains("/show/seq"));
+    PYSTRING_CHECK_ASSERT(!trie.contains("/show/seq/sho"));
+    PYSTRING_CHECK_ASSERT(!trie.contains("/show/seq/shot/anim"));
+    PYSTRING_CHECK_ASSERT(!trie.contains("/net/show"));
+    PYSTRING_CHECK_ASSERT(trie.contains("show/seq"));
+    PYSTRING_CHECK_ASSERT(trie.contains("./show/seq"));
+
+    // Prefixes are whole components
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("/show/seq/shot/anim/v002/a.exr"), shot);
+    PYSTRING_CHECK_EQUAL(trie.path(trie.longest_prefix("/show/seq/shot2/a.exr")), "/show/seq/shot2");
+    PYSTRING_CHECK_EQUAL(trie.path(trie.longest_prefix("/show/seq/shot3")), "/show");
+    PYSTRING_CHECK_EQUAL(trie.path(trie.longest_prefix("/show/other/../seq/shot/comp")), "/show/seq/shot/comp");
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("/other"), PathTrie::NONE);
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("show"), PathTrie::NONE);
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("//net"), PathTrie::NONE);
+
+    PYSTRING_CHECK_EQUAL(trie.count("/"), 5);
+    PYSTRING_CHECK_EQUAL(trie.count("/show"), 5);
+    PYSTRING_CHECK_EQUAL(trie.count("/show/seq"), 4);
+    PYSTRING_CHECK_EQUAL(trie.count("/show/seq/shot"), 3);
+    PYSTRING_CHECK_EQUAL(trie.count("/show/seq/shot/anim/v001/a"), 0);
+    PYSTRING_CHECK_EQUAL(trie.count("."), 1);
+    PYSTRING_CHECK_EQUAL(trie.count("//"), 1);
+
+    PYSTRING_CHECK_EQUAL(joined(trie, "/show/seq"), "/show/seq/shot|/show/seq/shot/anim/v001|/show/seq/shot/comp|/show/seq/shot2");
+    PYSTRING_CHECK_EQUAL(joined(trie, "/show/seq/shot/comp"), "/show/seq/shot/comp");
+    PYSTRING_CHECK_EQUAL(joined(trie, ""), "show/seq");
+    PYSTRING_CHECK_EQUAL(joined(trie, "//net"), "//net/show");
+    PYSTRING_CHECK_EQUAL(joined(trie, "/nothing"), "");
+
+    PathTrie relative = PathTrie::posix();
+    PYSTRING_CHECK_EQUAL(relative.path(relative.insert("")), ".");
+    PYSTRING_CHECK_EQUAL(relative.path(relative.insert("../a")), "../a");
+    PYSTRING_CHECK_EQUAL(relative.path(relative.longest_prefix("b")), ".");
+    PYSTRING_CHECK_EQUAL(relative.longest_prefix("/b"), PathTrie::NONE);
+
+    const std::string path = "/show/seq/shot/anim/v001/a.exr", dir = "/show/seq/shot/anim/v001";
+    trie.longest_prefix(path);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(trie.longest_prefix(path), trie.find(dir)), 0);
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(trie.count(dir), 1), 0);
+}
+
+PYSTRING_ADD_TEST(pystring_pathtrie, nt)
+{
+    using pystring::os::path::PathTrie;
+
+    PathTrie trie = PathTrie::nt();
+    PathTrie::Node show = trie.insert("C:/Show/Seq");
+    PYSTRING_CHECK_EQUAL(trie.insert("c:\\show\\seq\\"), show);
+    PYSTRING_CHECK_EQUAL(trie.path(show), "C:\\Show\\Seq");
+    trie.insert("c:\\show\\seq\\shot");
+    trie.insert("c:relative");
+    trie.insert("D:\\show");
+
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("C:\\SHOW\\SEQ\\SHOT\\a.exr"), trie.find("c:/show/seq/shot"));
+    PYSTRING_CHECK_EQUAL(trie.longest_prefix("c:show\\seq"), PathTrie::NONE);
+    PYSTRING_CHECK_EQUAL(trie.count("c:/"), 2);
+    PYSTRING_CHECK_EQUAL(trie.count("c:"), 1);
+    PYSTRING_CHECK_EQUAL(joined(trie, "C:\\show"), "C:\\Show\\Seq|C:\\Show\\Seq\\shot");
+    PYSTRING_CHECK_EQUAL(joined(trie, "c:"), "c:relative");
+    PYSTRING_CHECK_ASSERT(!trie.contains("e:\\show"));
+}
+
+PYSTRING_ADD_TEST(pystring_pathtrie, many)
+{
+    using pystring::os::path::PathTrie;
+
+    // Enough nodes to grow the table many times, checked against the paths themselves
+    PathTrie trie = PathTrie::posix();
+    std::vector< std::string > paths;
+    for(int i = 0; i < 20000; ++i)
+    {
+        paths.push_back("/show/seq" + std::to_string(i % 7) + "/shot" + std::to_string(i % 131) + "/v" + std::to_string(i));
+        PYSTRING_CHECK_EQUAL(trie.path(trie.insert(paths.back())), paths.back());
+    }
+    PYSTRING_CHECK_EQUAL(trie.size(), 20000);
+    PYSTRING_CHECK_EQUAL(trie.count("/show"), 20000);
+
+    size_t under = 0;
+    for(const std::string & path : paths) under += pystring::startswith(path, "/show/seq3/shot45/") ? 1 : 0;
+    PYSTRING_CHECK_EQUAL(trie.count("/show/seq3/shot45"), under);
+
+    std::vector< PathTrie::Node > nodes;
+    trie.subtree("/show/seq3/shot45", nodes);
+    PYSTRING_CHECK_EQUAL(nodes.size(), under);
+    for(PathTrie::Node node : nodes) PYSTRING_CHECK_ASSERT(pystring::startswith(trie.path(node), "/show/seq3/shot45/"));
+    for(size_t i = 0; i < paths.size(); i += 97) PYSTRING_CHECK_EQUAL(trie.path(trie.find(paths[i])), paths[i]);
+    PYSTRING_CHECK_ASSERT(trie.bytes() > 0);
+}
+
+#ifndef _WIN32
+namespace
+{
+    // top/{a/{a1.txt, b/c.txt}, skip_me/x.txt, f.txt, link -> a, broken -> nowhere}
+    std::string make_tree()
+    {
+        const std::string top = "pystring_test_walk";
+        ::mkdir(top.c_str(), 0755);
+        ::mkdir((top + "/a").c_str(), 0755);
+        ::mkdir((top + "/a/b").c_str(), 0755);
+        ::mkdir((top + "/skip_me").c_str(), 0755);
+        const char * files[] = { "/a/a1.txt", "/a/b/c.txt", "/skip_me/x.txt", "/f.txt" };
+        for(const char * file : files) std::ofstream((top + file).c_str()) << "x";
+        PYSTRING_CHECK_EQUAL(::symlink("a", (top + "/link").c_str()), 0);
+        PYSTRING_CHECK_EQUAL(::symlink("nowhere", (top + "/broken").c_str()), 0);
+        return top;
+    }
+
+    void remove_tree(const std::string & top)
+    {
+        const char * files[] = { "/a/a1.txt", "/a/b/c.txt", "/skip_me/x.txt", "/f.txt", "/link", "/broken" };
+        for(const char * file : files) ::unlink((top + file).c_str());
+        const char * dirs[] = { "/a/b", "/a", "/skip_me", "" };
+        for(const char * dir : dirs) ::rmdir((top + dir).c_str());
+    }
+
+    // Each directory walk() gives as "path: dirs | files", with the names sorted
+    std::vector< std::string > walked(const std::string & top, pystring::os::WalkOptions options, size_t & errors)
+    {
+        std::vector< std::string > result;
+        std::mutex mutex;
+        errors = pystring::os::walk(top,
+            [&](const std::string & dirpath, std::vector< std::string > & dirnames, std::vector< std::string > & filenames)
+            {
+                std::vector< std::string > dirs = dirnames, files = filenames;
+                std::sort(dirs.begin(), dirs.end());
+                std::sort(files.begin(), files.end());
+                std::lock_guard< std::mutex > lock(mutex);
+                result.push_back(dirpath + ": " + pystring::join(" ", dirs) + " | " + pystring::join(" ", files));
+            }, options);
+        return result;
+    }
+}
+
+PYSTRING_ADD_TEST(pystring_fs, scandir)
+{
+    const std::string top = make_tree();
+
+    std::vector< pystring::os::DirEntry > entries;
+    PYSTRING_CHECK_ASSERT(pystring::os::scandir(top, entries));
+    PYSTRING_CHECK_EQUAL(entries.size(), 5);
+    std::map< std::string, pystring::os::DirEntry > byname;
+    for(const pystring::os::DirEntry & entry : entries) byname[entry.name] = entry;
+
+    PYSTRING_CHECK_EQUAL(byname["a"].path, top + "/a");
+    PYSTRING_CHECK_ASSERT(byname["a"].is_dir());
+    PYSTRING_CHECK_ASSERT(!byname["a"].is_file());
+    PYSTRING_CHECK_ASSERT(byname["f.txt"].is_file());
+    PYSTRING_CHECK_EQUAL(byname["f.txt"].type, pystring::os::DirEntry::REGULAR);
+    PYSTRING_CHECK_ASSERT(byname["link"].is_symlink());
+    PYSTRING_CHECK_ASSERT(byname["link"].is_dir());
+    PYSTRING_CHECK_ASSERT(!byname["link"].is_dir(false));
+    PYSTRING_CHECK_ASSERT(byname["broken"].is_symlink());
+    PYSTRING_CHECK_ASSERT(!byname["broken"].is_dir());
+    PYSTRING_CHECK_ASSERT(!byname["broken"].is_file());
+    PYSTRING_CHECK_ASSERT(byname["a"].inode != 0);
+
+    PYSTRING_CHECK_ASSERT(!pystring::os::scandir(top + "/f.txt", entries));
+    PYSTRING_CHECK_ASSERT(!pystring::os::scandir(top + "/missing", entries));
+    PYSTRING_CHECK_EQUAL(entries.size(), 0);
+
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_fs, walk)
+{
+    const std::string top = make_tree();
+    size_t errors = 0;
+
+    // One thread walks in the order of os.walk(): each directory before the ones it holds
+    pystring::os::WalkOptions options;
+    options.threads = 1;
+    std::vector< std::string > result = walked(top, options, errors);
+    PYSTRING_CHECK_EQUAL(errors, 0);
+    PYSTRING_CHECK_EQUAL(result.size(), 4);
+    PYSTRING_CHECK_EQUAL(result[0], top + ": a link skip_me | broken f.txt");
+    std::vector< std::string > sorted = result;
+    std::sort(sorted.begin(), sorted.end());
+    PYSTRING_CHECK_EQUAL(pystring::join(",", sorted), top + "/a/b:  | c.txt," + top + "/a: b | a1.txt," + top + "/skip_me:  | x.txt," +
+                         top + ": a link skip_me | broken f.txt");
+    size_t a = std::find(result.begin(), result.end(), top + "/a: b | a1.txt") - result.begin();
+    PYSTRING_CHECK_EQUAL(result[a + 1], top + "/a/b:  | c.txt");
+
+    // Many threads find the same directories
+    options.threads = 8;
+    std::vector< std::string > parallel = walked(top, options, errors);
+    std::sort(parallel.begin(), parallel.end());
+    PYSTRING_CHECK_ASSERT(parallel == sorted);
+
+    // Bottom up, each directory after the ones it holds
+    options.topdown = false;
+    for(unsigned int threads : { 1, 4 })
+    {
+        options.threads = threads;
+        result = walked(top, options, errors);
+        PYSTRING_CHECK_EQUAL(result.size(), 4);
+        PYSTRING_CHECK_EQUAL(result.back(), top + ": a link skip_me | broken f.txt");
+        a = std::find(result.begin(), result.end(), top + "/a: b | a1.txt") - result.begin();
+        PYSTRING_CHECK_EQUAL(result[a - 1], top + "/a/b:  | c.txt");
+    }
+
+    options.topdown = true;
+    options.followlinks = true;
+    result = walked(top, options, errors);
+    PYSTRING_CHECK_EQUAL(result.size(), 6);
+    PYSTRING_CHECK_ASSERT(std::find(result.begin(), result.end(), top + "/link/b:  | c.txt") != result.end());
+
+    options.followlinks = false;
+    options.prune.push_back("skip_*");
+    options.prune.push_back("nothing");
+    result = walked(top, options, errors);
+    PYSTRING_CHECK_EQUAL(result.size(), 3);
+    PYSTRING_CHECK_EQUAL(result[0], top + ": a link | broken f.txt");
+
+    // Topdown, removing a name from dirnames keeps walk() out of it
+    std::vector< std::string > dirpaths;
+    options.prune.clear();
+    pystring::os::walk(top, [&](const std::string & dirpath, std::vector< std::string > & dirnames, std::vector< std::string > &)
+    {
+        dirpaths.push_back(dirpath);
+        dirnames.erase(std::remove(dirnames.begin(), dirnames.end(), "a"), dirnames.end());
+    }, options);
+    PYSTRING_CHECK_EQUAL(dirpaths.size(), 2);
+
+    // A top that cannot be read is an error, and nothing is walked
+    result = walked(top + "/missing", options, errors);
+    PYSTRING_CHECK_EQUAL(errors, 1);
+    PYSTRING_CHECK_EQUAL(result.size(), 0);
+
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_fs, stat)
+{
+    const std::string top = make_tree();
+    std::ofstream((top + "/f.txt").c_str()) << "hello";
+
+    pystring::os::StatResult result;
+    PYSTRING_CHECK_ASSERT(pystring::os::stat(top + "/f.txt", result));
+    PYSTRING_CHECK_ASSERT(result.exists);
+    PYSTRING_CHECK_EQUAL(result.type, pystring::os::DirEntry::REGULAR);
+    PYSTRING_CHECK_EQUAL(result.size, 5);
+    PYSTRING_CHECK_ASSERT(result.mtime > 1e9);
+    double mtime = result.mtime;
+    PYSTRING_CHECK_ASSERT(pystring::os::stat(top + "/link", result, pystring::os::StatResult::TYPE));
+    PYSTRING_CHECK_EQUAL(result.type, pystring::os::DirEntry::DIRECTORY);
+    PYSTRING_CHECK_ASSERT(!pystring::os::stat(top + "/broken", result));
+    PYSTRING_CHECK_ASSERT(!result.exists);
+    PYSTRING_CHECK_EQUAL(result.size, 0);
+
+    using namespace pystring::os;
+    PYSTRING_CHECK_ASSERT(path::exists(top));
+    PYSTRING_CHECK_ASSERT(path::isdir(top + "/a"));
+    PYSTRING_CHECK_ASSERT(path::isdir(top + "/link"));
+    PYSTRING_CHECK_ASSERT(!path::isfile(top + "/a"));
+    PYSTRING_CHECK_ASSERT(path::isfile(top + "/a/b/c.txt"));
+    PYSTRING_CHECK_ASSERT(!path::exists(top + "/broken"));
+    PYSTRING_CHECK_ASSERT(!path::exists(top + "/missing"));
+    PYSTRING_CHECK_ASSERT(!path::isdir(top + "/missing"));
+    PYSTRING_CHECK_EQUAL(path::getsize(top + "/f.txt"), 5);
+    PYSTRING_CHECK_EQUAL(path::getsize(top + "/missing"), -1);
+    PYSTRING_CHECK_EQUAL(path::getmtime(top + "/f.txt"), mtime);
+    PYSTRING_CHECK_EQUAL(path::getmtime(top + "/missing"), -1.0);
+
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_statcache, lookup)
+{
+    using pystring::os::path::StatCache;
+    const std::string top = make_tree();
+
+    StatCache cache;
+    PYSTRING_CHECK_ASSERT(cache.isfile(top + "/f.txt"));
+    PYSTRING_CHECK_EQUAL(cache.getsize(top + "/f.txt"), 1);
+    PYSTRING_CHECK_ASSERT(cache.isfile(top + "/./f.txt"));
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/missing"));
+    PYSTRING_CHECK_EQUAL(cache.getmtime(top + "/f.txt"), pystring::os::path::getmtime(top + "/f.txt"));
+
+    // Paths that normpath() would change the meaning of are looked up as they are, every time
+    PYSTRING_CHECK_ASSERT(cache.exists(top + "/a/../f.txt"));
+    PYSTRING_CHECK_ASSERT(cache.isdir(top + "//a/./"));
+    PYSTRING_CHECK_ASSERT(!cache.isfile(top + "/f.txt/"));
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/f.txt/."));
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/f.txt/.."));
+    PYSTRING_CHECK_ASSERT(!cache.exists(""));
+
+    // Normalized paths share an entry, and so do paths that do not exist
+    StatCache::Stats stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.misses, 2);
+    PYSTRING_CHECK_EQUAL(stats.hits, 3);
+    PYSTRING_CHECK_EQUAL(stats.entries, 2);
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/missing"));
+    PYSTRING_CHECK_EQUAL(cache.stats().hits, 4);
+
+    // The cache does not see changes until the entries are invalidated
+    std::ofstream((top + "/f.txt").c_str()) << "hello";
+    std::ofstream((top + "/missing").c_str()) << "x";
+    PYSTRING_CHECK_EQUAL(cache.getsize(top + "/f.txt"), 1);
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/missing"));
+    cache.invalidate(top + "/./f.txt");
+    PYSTRING_CHECK_EQUAL(cache.getsize(top + "/f.txt"), 5);
+    PYSTRING_CHECK_ASSERT(!cache.exists(top + "/missing"));
+    cache.invalidate_tree(top);
+    PYSTRING_CHECK_ASSERT(cache.exists(top + "/missing"));
+    PYSTRING_CHECK_EQUAL(cache.stats().entries, 1);
+    ::unlink((top + "/missing").c_str());
+
+    cache.clear();
+    stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.hits + stats.misses + stats.entries, 0);
+
+    // With a ttl, entries are looked up again once they are older than it
+    StatCache expiring(0.05);
+    PYSTRING_CHECK_ASSERT(!expiring.exists(top + "/later"));
+    std::ofstream((top + "/later").c_str()) << "x";
+    PYSTRING_CHECK_ASSERT(!expiring.exists(top + "/later"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    PYSTRING_CHECK_ASSERT(expiring.exists(top + "/later"));
+    PYSTRING_CHECK_EQUAL(expiring.stats().expired, 1);
+    PYSTRING_CHECK_EQUAL(expiring.stats().entries, 1);
+    ::unlink((top + "/later").c_str());
+
+    // Entries beyond max_entries are evicted
+    StatCache small(0.0, 4, 1);
+    const char * names[] = { "", "/a", "/a/b", "/f.txt", "/skip_me", "/link" };
+    for(const char * name : names) PYSTRING_CHECK_ASSERT(small.isdir(top + name) || small.isfile(top + name));
+    PYSTRING_CHECK_EQUAL(small.stats().entries, 4);
+    PYSTRING_CHECK_EQUAL(small.stats().evictions, 2);
+
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_statcache, batch)
+{
+    using pystring::os::path::StatCache;
+    const std::string top = make_tree();
+
+    // Enough misses for several threads, with hits and duplicates among them
+    std::vector< std::string > paths;
+    const char * names[] = { "", "/a", "/a/b", "/a/a1.txt", "/a/b/c.txt", "/f.txt", "/link", "/broken", "/f.txt/", "/a/../f.txt" };
+    for(int i = 0; i < 200; ++i) paths.push_back(top + "/missing" + std::to_string(i));
+    for(int i = 0; i < 3; ++i)
+        for(const char * name : names) paths.push_back(top + name);
+
+    StatCache cache;
+    PYSTRING_CHECK_ASSERT(cache.isdir(top + "/a"));
+    std::vector< pystring::os::StatResult > results;
+    for(unsigned int threads : { 1, 8, 0 })
+    {
+        cache.clear();
+        PYSTRING_CHECK_EQUAL(cache.stat(paths, results, threads), 24);
+        PYSTRING_CHECK_EQUAL(results.size(), paths.size());
+        for(size_t i = 0; i < paths.size(); ++i)
+        {
+            pystring::os::StatResult expected;
+            pystring::os::stat(paths[i], expected);
+            PYSTRING_CHECK_EQUAL(results[i].exists, expected.exists);
+            PYSTRING_CHECK_EQUAL(results[i].type, expected.type);
+            PYSTRING_CHECK_EQUAL(results[i].size, expected.size);
+        }
+        PYSTRING_CHECK_ASSERT(cache.stats().entries <= 208);
+    }
+
+    // A second batch is all hits, but for the paths looked up without the cache
+    StatCache::Stats before = cache.stats();
+    PYSTRING_CHECK_EQUAL(cache.stat(paths, results), 24);
+    PYSTRING_CHECK_EQUAL(cache.stats().hits - before.hits, paths.size() - 6);
+    PYSTRING_CHECK_EQUAL(cache.stats().misses, before.misses);
+
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_realpath, realpath)
+{
+    using pystring::os::path::realpath;
+    const std::string top = make_tree();
+    PYSTRING_CHECK_EQUAL(::symlink("loop2", (top + "/loop1").c_str()), 0);
+    PYSTRING_CHECK_EQUAL(::symlink("loop1", (top + "/loop2").c_str()), 0);
+    PYSTRING_CHECK_EQUAL(::symlink("../..", (top + "/a/b/up").c_str()), 0);
+
+    char buffer[4096];
+    const std::string cwd = ::getcwd(buffer, sizeof(buffer));
+    const std::string abs = cwd + "/" + top;
+    PYSTRING_CHECK_EQUAL(realpath(""), cwd);
+    PYSTRING_CHECK_EQUAL(realpath("."), cwd);
+    PYSTRING_CHECK_EQUAL(realpath("/"), "/");
+    PYSTRING_CHECK_EQUAL(realpath(top), abs);
+    PYSTRING_CHECK_EQUAL(realpath(top + "/link/b/c.txt"), abs + "/a/b/c.txt");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/link/b/c.txt"), ::realpath((top + "/link/b/c.txt").c_str(), buffer));
+    PYSTRING_CHECK_EQUAL(realpath(abs + "//./link/"), abs + "/a");
+
+    // ".." goes up from where the link leads, not from the link
+    PYSTRING_CHECK_EQUAL(realpath(top + "/link/b/up/f.txt"), abs + "/f.txt");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/link/b/up/link/b/../a1.txt"), abs + "/a/a1.txt");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/missing/../f.txt"), abs + "/f.txt");
+
+    // What does not exist is kept, and a loop stops at the link that closes it
+    PYSTRING_CHECK_EQUAL(realpath(top + "/broken/x"), abs + "/nowhere/x");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/f.txt/x"), abs + "/f.txt/x");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/loop1"), abs + "/loop1");
+    PYSTRING_CHECK_EQUAL(realpath(top + "/loop1/x/../y"), abs + "/loop1/y");
+
+    ::unlink((top + "/loop1").c_str());
+    ::unlink((top + "/loop2").c_str());
+    ::unlink((top + "/a/b/up").c_str());
+    remove_tree(top);
+}
+
+PYSTRING_ADD_TEST(pystring_realpath, cache)
+{
+    using pystring::os::path::RealpathCache;
+    const std::string top = make_tree();
+
+    // The files of a directory share the resolution of their parents
+    RealpathCache cache;
+    const char * names[] = { "/link/b/c.txt", "/link/b/d.txt", "/link/a1.txt", "/link/b/../f.txt", "/broken/x", "/f.txt/x" };
+    for(int i = 0; i < 2; ++i)
+        for(const char * name : names) PYSTRING_CHECK_EQUAL(cache.realpath(top + name), pystring::os::path::realpath(top + name));
+    RealpathCache::Stats stats = cache.stats();
+    PYSTRING_CHECK_ASSERT(stats.hits >= 6);
+    PYSTRING_CHECK_ASSERT(stats.entries > 0);
+
+    // The cache does not see a link change until the paths through it are invalidated
+    const std::string a1 = cache.realpath(top + "/link/a1.txt");
+    ::unlink((top + "/link").c_str());
+    PYSTRING_CHECK_EQUAL(::symlink("skip_me", (top + "/link").c_str()), 0);
+    PYSTRING_CHECK_EQUAL(cache.realpath(top + "/link/a1.txt"), a1);
+    cache.invalidate_tree(top + "/link");
+    PYSTRING_CHECK_EQUAL(cache.realpath(top + "/link/a1.txt"), pystring::os::path::realpath(top + "/skip_me/a1.txt"));
+
+    cache.clear();
+    stats = cache.stats();
+    PYSTRING_CHECK_EQUAL(stats.hits + stats.misses + stats.entries, 0);
+
+    // With a ttl, directories are resolved again once they are older than it
+    RealpathCache expiring(0.05);
+    expiring.realpath(top + "/link/x");
+    expiring.realpath(top + "/link/x");
+    PYSTRING_CHECK_EQUAL(expiring.stats().expired, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    expiring.realpath(top + "/link/x");
+    PYSTRING_CHECK_ASSERT(expiring.stats().expired > 0);
+
+    remove_tree(top);
+}
+#endif
+
+#ifdef PYSTRING_HAVE_CXX17
+PYSTRING_ADD_TEST(pystring_pathtable, lookup)
+{
+    using pystring::os::path::PathTable;
+
+    PathTable empty;
+    PYSTRING_CHECK_EQUAL(empty.size(), 0);
+    PYSTRING_CHECK_EQUAL(empty.find("a"), PathTable::npos);
+    PYSTRING_CHECK_EQUAL(empty.lower_bound("a"), 0);
+    PYSTRING_CHECK_EQUAL(empty[0], "");
+
+    // Unsorted, with duplicates, an empty path and a block and a bit
+    std::vector< std::string > paths = { "/show/b", "/show/a/2", "", "/show/a/1", "/show/b", "/show/a",
+                                         "/show/ab", "/show/a/10", "/shop", "/show/a\xff", "/show/a\xff\xff/x",
+                                         "/show/c", "/show/c/d", "/show/c/e", "/show/d", "/show/e", "/show/f", "/z" };
+    PathTable table(paths);
+
+    std::vector< std::string > sorted = paths;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    PYSTRING_CHECK_EQUAL(table.size(), sorted.size());
+    for(size_t i = 0; i < sorted.size(); ++i)
+    {
+        PYSTRING_CHECK_EQUAL(table[i], sorted[i]);
+        PYSTRING_CHECK_EQUAL(table.find(sorted[i]), i);
+        PYSTRING_CHECK_EQUAL(table.lower_bound(sorted[i]), i);
+    }
+    PYSTRING_CHECK_EQUAL(table[sorted.size()], "");
+
+    std::vector< std::string > all;
+    table.get(0, table.size(), all);
+    PYSTRING_CHECK_ASSERT(all == sorted);
+    table.get(3, 100, all);
+    PYSTRING_CHECK_ASSERT(all == std::vector< std::string >(sorted.begin() + 3, sorted.end()));
+    table.get(5, 5, all);
+    PYSTRING_CHECK_EQUAL(all.size(), 0);
+
+    PYSTRING_CHECK_EQUAL(table.find("/show/a/3"), PathTable::npos);
+    PYSTRING_CHECK_EQUAL(table.find("/zz"), PathTable::npos);
+    PYSTRING_CHECK_EQUAL(table.lower_bound("/show/a/3"), table.find("/show/ab"));
+    PYSTRING_CHECK_EQUAL(table.lower_bound("/zz"), table.size());
+    PYSTRING_CHECK_EQUAL(table.lower_bound(""), 0);
+
+    std::pair< size_t, size_t > range = table.prefix_range("/show/a/");
+    PYSTRING_CHECK_EQUAL(range.first, table.find("/show/a/1"));
+    PYSTRING_CHECK_EQUAL(range.second - range.first, 3);
+    range = table.prefix_range("/show/a");
+    PYSTRING_CHECK_EQUAL(range.second - range.first, 7);
+    range = table.prefix_range("/show/a\xff");
+    PYSTRING_CHECK_EQUAL(range.second - range.first, 2);
+    PYSTRING_CHECK_EQUAL(range.second, table.find("/show/b"));
+    range = table.prefix_range("/show/x");
+    PYSTRING_CHECK_EQUAL(range.first, range.second);
+    range = table.prefix_range("");
+    PYSTRING_CHECK_EQUAL(range.second - range.first, table.size());
+
+    // Moving keeps the image of a built table working
+    PathTable moved(std::move(table));
+    PYSTRING_CHECK_EQUAL(table.size(), 0);
+    PYSTRING_CHECK_EQUAL(moved.find("/show/c/e"), 12);
+
+    PYSTRING_CHECK_ALLOCS(PYSTRING_CHECK_EQUAL(moved.find("/show/c/e"), 12), 0);
+}
+
+PYSTRING_ADD_TEST(pystring_pathtable, file)
+{
+    using pystring::os::path::PathTable;
+
+    // Enough to compress, in many blocks
+    std::vector< std::string > paths;
+    size_t total = 0;
+    for(int i = 0; i < 20000; ++i)
+    {
+        paths.push_back("/show/project/seq" + std::to_string(i / 1000) + "/shot" + std::to_string(i / 10 % 100) + "/render/beauty." + std::to_string(i % 10) + ".exr");
+        total += paths.back().size();
+    }
+    PathTable built(paths);
+    PYSTRING_CHECK_EQUAL(built.size(), paths.size());
+    PYSTRING_CHECK_ASSERT(built.bytes() * 3 < total);
+
+    const std::string filename = "pystring_test_pathtable.bin";
+    PYSTRING_CHECK_ASSERT(built.save(filename));
+
+    PathTable table;
+    PYSTRING_CHECK_ASSERT(table.open(filename));
+    PYSTRING_CHECK_EQUAL(table.size(), paths.size());
+    PYSTRING_CHECK_EQUAL(table.image(), built.image());
+    for(size_t i = 0; i < paths.size(); i += 37) PYSTRING_CHECK_EQUAL(table[table.find(paths[i])], paths[i]);
+
+    std::pair< size_t, size_t > range = table.prefix_range("/show/project/seq7/shot42/");
+    PYSTRING_CHECK_EQUAL(range.second - range.first, 10);
+    PYSTRING_CHECK_EQUAL(table[range.first], "/show/project/seq7/shot42/render/beauty.0.exr");
+
+    PathTable moved;
+    moved = std::move(table);
+    PYSTRING_CHECK_EQUAL(moved[range.first + 1], "/show/project/seq7/shot42/render/beauty.1.exr");
+
+    PathTable attached;
+    PYSTRING_CHECK_ASSERT(attached.attach(built.image().data(), built.image().size()));
+    PYSTRING_CHECK_EQUAL(attached.find(paths[12345]), built.find(paths[12345]));
+
+    // Not tables: too short, another version, a size that does not match the header
+    std::string image(built.image());
+    PYSTRING_CHECK_ASSERT(!attached.attach(image.data(), 20));
+    PYSTRING_CHECK_EQUAL(attached.size(), 0);
+    PYSTRING_CHECK_ASSERT(!attached.attach(image.data(), image.size() - 1));
+    image[8] = 2;
+    PYSTRING_CHECK_ASSERT(!attached.attach(image.data(), image.size()));
+
+    PathTable empty;
+    PYSTRING_CHECK_ASSERT(empty.save(filename));
+    PYSTRING_CHECK_ASSERT(table.open(filename));
+    PYSTRING_CHECK_EQUAL(table.size(), 0);
+
+    moved.close();
+    table.close();
+    std::remove(filename.c_str());
+    PYSTRING_CHECK_ASSERT(!table.open(filename));
+}
+#endif
+
+namespace
+{
+    // Push str through filter in chunks of chunksize bytes
+    std::string run_filter(pystring::StreamFilter & filter, const std::string & str, size_t chunksize)
+    {
+        std::string out;
+        for(size_t i = 0; i < str.size(); i += chunksize)
+        {
+            filter.write(str.data() + i, std::min(chunksize, str.size() - i), out);
+        }
+        filter.finish(out);
+        return out;
+    }
+}
+
+PYSTRING_ADD_TEST(pystring_io, replacefilter)
+{
+    const char * inputs[] = { "", "a", "aaaaa", "abcabcab", "xaabaabaaby", "ab ab  abab a b" };
+    const char * olds[] = { "", "a", "aa", "ab", "aab", "abab", "zz" };
+
+    for(const char * input : inputs)
+    {
+        for(const char * oldstr : olds)
+        {
+            for(int count = -1; count < 3; ++count)
+            {
+                std::string expected = pystring::replace(input, oldstr, "<>", count);
+                for(size_t chunksize = 1; chunksize < 6; ++chunksize)
+                {
+                    pystring::ReplaceFilter filter(oldstr, "<>", count);
+                    PYSTRING_CHECK_EQUAL(run_filter(filter, input, chunksize), expected);
+                }
+            }
+        }
+    }
+}
+
+PYSTRING_ADD_TEST(pystring_io, filters)
+{
+    const std::string text = "ab\tcD\t\tE\nf\tGhi\r\t\tjk";
+
+    for(size_t chunksize = 1; chunksize < 5; ++chunksize)
+    {
+        pystring::ExpandTabsFilter expand(4), remove(0);
+        PYSTRING_CHECK_EQUAL(run_filter(expand, text, chunksize), pystring::expandtabs(text, 4));
+        PYSTRING_CHECK_EQUAL(run_filter(remove, text, chunksize), pystring::expandtabs(text, 0));
+
+        pystring::UpperFilter upper;
+        pystring::LowerFilter lower;
+        PYSTRING_CHECK_EQUAL(run_filter(upper, text, chunksize), pystring::upper(text));
+        PYSTRING_CHECK_EQUAL(run_filter(lower, text, chunksize), pystring::lower(text));
+    }
+
+    char tdata[256];
+    for(int i=0; i<256; ++i) tdata[i] = (char)i;
+    tdata[101] = 111; // Map e -> o
+    std::string table(tdata, 256);
+
+    pystring::TranslateFilter translate(table, "h");
+    PYSTRING_CHECK_EQUAL(run_filter(translate, "cheese", 2), pystring::translate("cheese", table, "h"));
+
+    pystring::TranslateFilter invalid("abc");
+    PYSTRING_CHECK_EQUAL(run_filter(invalid, "cheese", 2), "cheese");
+}
+
+PYSTRING_ADD_TEST(pystring_io, filterpipeline)
+{
+    const std::string text = "foo\tbar foo\nbaz\tfoo";
+
+    pystring::ReplaceFilter replace("foo", "qux");
+    pystring::ExpandTabsFilter expand(4);
+    pystring::UpperFilter upper;
+
+    std::ostringstream out;
+    pystring::FilterPipeline pipeline(out);
+    pipeline.add(replace).add(expand).add(upper);
+
+    std::istringstream in(text);
+    PYSTRING_CHECK_ASSERT(pipeline.run(in, 2));
+    PYSTRING_CHECK_EQUAL(out.str(), pystring::upper(pystring::expandtabs(pystring::replace(text, "foo", "qux"), 4)));
+
+    std::ostringstream passthrough;
+    pystring::FilterPipeline empty(passthrough);
+    PYSTRING_CHECK_ASSERT(empty.write(text));
+    PYSTRING_CHECK_ASSERT(empty.finish());
+    PYSTRING_CHECK_EQUAL(passthrough.str(), text);
+}
+
+#ifdef PYSTRING_HAVE_CXX17
+
+PYSTRING_ADD_TEST(pystring_io, linerange)
+{
+    const std::string text = "one\ntwo\r\nthree\rfour\n\nfive";
+    std::vector< std::string > expected;
+
+    for(bool keepends : { false, true })
+    {
+        pystring::splitlines(text, expected, keepends);
+        std::vector< std::string > lines;
+        for(std::string_view line : pystring::LineRange(text, keepends)) lines.push_back(std::string(line));
+        PYSTRING_CHECK_EQUAL(lines.size(), expected.size());
+        PYSTRING_CHECK_ASSERT(lines == expected);
+    }
+
+    PYSTRING_CHECK_ASSERT(pystring::LineRange("").begin() == pystring::LineRange("").end());
+
+    // Iterators of the same range compare by position
+    pystring::LineRange range(text);
+    pystring::LineRange::iterator first = range.begin(), second = range.begin();
+    PYSTRING_CHECK_ASSERT(first == second);
+    ++second;
+    PYSTRING_CHECK_ASSERT(first != second);
+    PYSTRING_CHECK_ASSERT(second != range.end());
+    ++first;
+    PYSTRING_CHECK_ASSERT(first == second);
+    PYSTRING_CHECK_EQUAL(std::distance(range.begin(), range.end()), 6);
+}
+
+PYSTRING_ADD_TEST(pystring_io, splitrange)
+{
+    const char * inputs[] = { "", " ", "a", "a/", "/a//b/", "  one two\tthree  ", "//as//rew//gdf" };
+    const char * seps[] = { "", "/", "//", " " };
+
+    for(const char * input : inputs)
+    {
+        for(const char * sep : seps)
+        {
+            for(int maxsplit = -1; maxsplit < 3; ++maxsplit)
+            {
+                std::vector< std::string > expected, words;
+                pystring::split(input, expected, sep, maxsplit);
+                for(std::string_view word : pystring::SplitRange(input, sep, maxsplit)) words.push_back(std::string(word));
+                PYSTRING_CHECK_ASSERT(words == expected);
+            }
+        }
+    }
+
+    pystring::SplitRange range("a/b/c", "/");
+    pystring::SplitRange::iterator first = range.begin(), second = range.begin();
+    ++second;
+    PYSTRING_CHECK_ASSERT(first != second);
+    ++first;
+    PYSTRING_CHECK_ASSERT(first == second);
+    PYSTRING_CHECK_EQUAL(*first, "b");
+    PYSTRING_CHECK_EQUAL(std::distance(range.begin(), range.end()), 3);
+}
+
+PYSTRING_ADD_TEST(pystring_io, mappedfile)
+{
+    const std::string filename = "pystring_test_mappedfile.txt";
+    const std::string text = "a b c\nd e\r\nf\n";
+    {
+        std::ofstream out(filename.c_str(), std::ios::binary);
+        out << text;
+    }
+
+    {
+        pystring::MappedFile file(filename, pystring::MappedFile::PREFETCH);
+        PYSTRING_CHECK_ASSERT(file.is_open());
+        PYSTRING_CHECK_EQUAL(file.size(), text.size());
+        PYSTRING_CHECK_EQUAL(file.view(), text);
+
+        std::vector< std::string > lines;
+        for(std::string_view line : file.lines()) lines.push_back(std::string(line));
+        PYSTRING_CHECK_ASSERT(lines == pystring::splitlines(text));
+
+        std::vector< std::string > words;
+        for(std::string_view word : file.split()) words.push_back(std::string(word));
+        PYSTRING_CHECK_ASSERT(words == pystring::split(text));
+
+        pystring::MappedFile moved(std::move(file));
+        PYSTRING_CHECK_ASSERT(!file.is_open());
+        PYSTRING_CHECK_EQUAL(moved.view(), text);
+    }
+
+    {
+        std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    }
+
+    {
+        pystring::MappedFile file(filename);
+        PYSTRING_CHECK_ASSERT(file.is_open());
+        PYSTRING_CHECK_EQUAL(file.size(), 0);
+        PYSTRING_CHECK_ASSERT(file.lines().begin() == file.lines().end());
+    }
+
+    std::remove(filename.c_str());
+
+    pystring::MappedFile missing;
+    PYSTRING_CHECK_ASSERT(!missing.open("pystring_test_does_not_exist.txt"));
+    PYSTRING_CHECK_ASSERT(!missing.is_open());
+}
+
+#endif
+
+PYSTRING_ADD_TEST(pystring_stats, counters)
+{
+    pystring::stats::reset();
+
+    std::vector< std::string > words;
+    pystring::split("a b c", words);
+    pystring::lower("ABC");
+    pystring::lower("DEF");
+    pystring::os::path::normpath_posix("a/./b");
+    pystring::os::path::abspath_posix("b", "/a/.");
+
+    std::vector< pystring::stats::FunctionStats > stats = pystring::stats::snapshot();
+    if (!pystring::stats::enabled())
+    {
+        PYSTRING_CHECK_ASSERT(stats.empty());
+        return;
+    }
+
+    std::map< std::string, pystring::stats::FunctionStats > byname;
+    for (size_t i = 0; i < stats.size(); ++i) byname[stats[i].name] = stats[i];
+
+    PYSTRING_CHECK_EQUAL(stats[0].name, "lower");
+    PYSTRING_CHECK_EQUAL(byname["lower"].calls, 2);
+    PYSTRING_CHECK_EQUAL(byname["lower"].bytes_in, 6);
+    PYSTRING_CHECK_EQUAL(byname["lower"].bytes_out, 6);
+    PYSTRING_CHECK_EQUAL(byname["lower"].allocations, 2);
+    PYSTRING_CHECK_EQUAL(byname["lower"].sampled, 1);
+
+    // The join and normpath done inside abspath_posix are not counted
+    PYSTRING_CHECK_EQUAL(byname["split"].calls, 1);
+    PYSTRING_CHECK_EQUAL(byname["split"].bytes_out, 3);
+    PYSTRING_CHECK_EQUAL(byname["split"].allocations, 4);
+    PYSTRING_CHECK_EQUAL(byname["os.path.normpath_posix"].calls, 1);
+    PYSTRING_CHECK_EQUAL(byname["os.path.abspath_posix"].calls, 1);
+    PYSTRING_CHECK_EQUAL(byname.count("os.path.join_posix"), 0);
+
+    std::ostringstream out;
+    pystring::stats::dump(out);
+    PYSTRING_CHECK_ASSERT(out.str().find("os.path.normpath_posix") != std::string::npos);
+
+    pystring::stats::reset();
+    PYSTRING_CHECK_ASSERT(pystring::stats::snapshot().empty());
+}
+
+PYSTRING_ADD_TEST(pystring_simd, dispatch)
+{
+    using namespace pystring::simd;
+
+    const std::string text = "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog!";
+    const std::string digits = "012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+
+    ISA previous = active();
+    PYSTRING_CHECK_ASSERT(previous <= detect());
+
+    for (int isa = SCALAR; isa <= detect(); ++isa)
+    {
+        PYSTRING_CHECK_ASSERT(crosscheck((ISA) isa));
+        PYSTRING_CHECK_EQUAL(select((ISA) isa), isa);
+        PYSTRING_CHECK_EQUAL(active(), isa);
+
+        PYSTRING_CHECK_EQUAL(pystring::find(text, "dog!"), 85);
+        PYSTRING_CHECK_EQUAL(pystring::find(text, "dog", 41), 85);
+        PYSTRING_CHECK_EQUAL(pystring::find(text, "dog", 0, 87), 40);
+        PYSTRING_CHECK_EQUAL(pystring::count(text, "the"), 2);
+        PYSTRING_CHECK_EQUAL(pystring::rfind(text, "dog"), 85);
+        PYSTRING_CHECK_EQUAL(pystring::rfind(text, "dog", 0, 87), 40);
+        PYSTRING_CHECK_EQUAL(pystring::rsplit(text, "fox", 1)[0].size(), 61);
+        PYSTRING_CHECK_EQUAL(pystring::split(text).size(), 18);
+        PYSTRING_CHECK_EQUAL(pystring::split(text, "fox").size(), 3);
+        PYSTRING_CHECK_EQUAL(pystring::isdigit(digits), true);
+        PYSTRING_CHECK_EQUAL(pystring::isdigit(digits + "x"), false);
+        PYSTRING_CHECK_EQUAL(pystring::isalnum(digits + "abcXYZ"), true);
+        PYSTRING_CHECK_EQUAL(pystring::upper(text), "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG. THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG!");
+        PYSTRING_CHECK_EQUAL(pystring::lower(text), "the quick brown fox jumps over the lazy dog. the quick brown fox jumps over the lazy dog!");
+    }
+
+    // Asking for more than the machine has falls back to what it does have
+    PYSTRING_CHECK_EQUAL(select(AVX512), detect());
+    PYSTRING_CHECK_EQUAL(std::string(name(SCALAR)), "scalar");
+
+    select(previous);
+}
+
+PYSTRING_ADD_TEST(pystring_utf8, validation)
+{
+    using namespace pystring::utf8;
+
+    PYSTRING_CHECK_EQUAL(isascii(""), true);
+    PYSTRING_CHECK_EQUAL(isascii("plain ascii text that is longer than one vector register........"), true);
+    PYSTRING_CHECK_EQUAL(isascii("plain ascii text that is longer than one vector register.......\xc3\xa9"), false);
+
+    PYSTRING_CHECK_EQUAL(isvalid(""), true);
+    PYSTRING_CHECK_EQUAL(isvalid("caf\xc3\xa9"), true);
+    PYSTRING_CHECK_EQUAL(isvalid("\xe2\x82\xac \xf0\x9f\x8e\xac"), true);
+    PYSTRING_CHECK_EQUAL(isvalid("caf\xc3"), false);         // truncated
+    PYSTRING_CHECK_EQUAL(isvalid("\xc0\xaf"), false);        // overlong
+    PYSTRING_CHECK_EQUAL(isvalid("\xed\xa0\x80"), false);    // surrogate
+    PYSTRING_CHECK_EQUAL(isvalid("\xf4\x90\x80\x80"), false); // above U+10FFFF
+    PYSTRING_CHECK_EQUAL(isvalid("\x80"), false);
+
+    PYSTRING_CHECK_EQUAL(len(""), 0);
+    PYSTRING_CHECK_EQUAL(len("abc"), 3);
+    PYSTRING_CHECK_EQUAL(len("Bj\xc3\xb6rk"), 5);
+    PYSTRING_CHECK_EQUAL(len("\xe6\x9d\xb1\xe4\xba\xac"), 2);
+    PYSTRING_CHECK_EQUAL(len("a\xff" "b"), 3);
+}
+
+PYSTRING_ADD_TEST(pystring_utf8, case)
+{
+    using namespace pystring::utf8;
+
+    PYSTRING_CHECK_EQUAL(upper("hello"), "HELLO");
+    PYSTRING_CHECK_EQUAL(upper("bj\xc3\xb6rk gu\xc3\xb0mundsd\xc3\xb3ttir"), "BJ\xc3\x96RK GU\xc3\x90MUNDSD\xc3\x93TTIR");
+    PYSTRING_CHECK_EQUAL(lower("\xc3\x89MILE ZOLA"), "\xc3\xa9mile zola");
+    PYSTRING_CHECK_EQUAL(upper("\xce\xb1\xce\xb2\xce\xb3"), "\xce\x91\xce\x92\xce\x93");
+    PYSTRING_CHECK_EQUAL(lower("\xd0\x9c\xd0\x9e\xd0\xa1\xd0\x9a\xd0\x92\xd0\x90"), "\xd0\xbc\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0");
+    PYSTRING_CHECK_EQUAL(upper("\xc5\x82\xc3\xb3\xc5\xba"), "\xc5\x81\xc3\x93\xc5\xb9");
+    PYSTRING_CHECK_EQUAL(upper("stra\xc3\x9f" "e"), "STRA\xc3\x9f" "E");
+    PYSTRING_CHECK_EQUAL(upper("bad \xff byte"), "BAD \xff BYTE");
+    PYSTRING_CHECK_EQUAL(swapcase("\xc3\x89t\xc3\xa9"), "\xc3\xa9T\xc3\x89");
+    PYSTRING_CHECK_EQUAL(capitalize("\xc3\xa9" "COLE"), "\xc3\x89" "cole");
+    PYSTRING_CHECK_EQUAL(title("\xc3\xa9mile zola"), "\xc3\x89mile Zola");
+    PYSTRING_CHECK_EQUAL(title("\xc3\x89MILE-\xc3\xa9mile"), "\xc3\x89mile-\xc3\x89mile");
+    PYSTRING_CHECK_EQUAL(casefold("Stra\xc3\x9f" "E"), "strasse");
+    PYSTRING_CHECK_EQUAL(casefold("\xce\xa3\xce\xaf\xcf\x83\xcf\x85\xcf\x86\xce\xbf\xcf\x82"), "\xcf\x83\xce\xaf\xcf\x83\xcf\x85\xcf\x86\xce\xbf\xcf\x83");
+    PYSTRING_CHECK_EQUAL(casefold("\xef\xac\x81le"), "file");
+    PYSTRING_CHECK_EQUAL(casefold("\xc3\x89MILE"), "\xc3\xa9mile");
+
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0xff), 0x178u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x178), 0xffu);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x3c2), 0x3a3u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x139), 0x13au);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x13a), 0x139u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x4e00), 0x4e00u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x181), 0x253u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x253), 0x181u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x187), 0x188u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x188), 0x187u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x1c4), 0x1c6u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x1c5), 0x1c6u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x1c6), 0x1c4u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x246), 0x247u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x24f), 0x24eu);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x1e9e), 0xdfu);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0xdf), 0xdfu);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x1f08), 0x1f00u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x1f00), 0x1f08u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x1f80), 0x1f88u);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::toupper(0x23f), 0x2c7eu);
+    PYSTRING_CHECK_EQUAL(pystring::utf8::tolower(0x2c7e), 0x23fu);
+    PYSTRING_CHECK_EQUAL(lower("\xe1\xbc\x88\xce\x98\xce\x97\xce\x9d\xce\x91"), "\xe1\xbc\x80\xce\xb8\xce\xb7\xce\xbd\xce\xb1");
+    PYSTRING_CHECK_EQUAL(title("\xc7\x86" "emal"), "\xc7\x85" "emal");
+    PYSTRING_CHECK_EQUAL(capitalize("\xc7\x84" "EMAL"), "\xc7\x85" "emal");
+    PYSTRING_CHECK_EQUAL(swapcase("\xc7\x85" "a"), "\xc7\x85" "A");
+
+    PYSTRING_CHECK_EQUAL(isalpha("Bj\xc3\xb6rk"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xe6\x9d\xb1\xe4\xba\xac"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("Bj\xc3\xb6rk 2"), false);
+    PYSTRING_CHECK_EQUAL(isalpha("\xc3\x97"), false);
+    PYSTRING_CHECK_EQUAL(isalpha("\xc2\xb5"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xe3\x81\x95\xe3\x82\x9d"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xe3\x83\xa9\xe3\x83\xbc\xe3\x83\xa1\xe3\x83\xb3"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xef\xac\x81sh"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xe1\xbe\xb3\xc6\x81"), true);
+    PYSTRING_CHECK_EQUAL(isalpha("\xce\x87"), false);
+    PYSTRING_CHECK_EQUAL(isalpha(""), false);
+    PYSTRING_CHECK_EQUAL(islower("stra\xc3\x9f" "e"), true);
+    PYSTRING_CHECK_EQUAL(islower("Stra\xc3\x9f" "e"), false);
+    PYSTRING_CHECK_EQUAL(isupper("\xc3\x89T\xc3\x89"), true);
+    PYSTRING_CHECK_EQUAL(isupper("\xc3\x89t\xc3\x89"), false);
+    PYSTRING_CHECK_EQUAL(islower("\xc9\x90\xc9\x99"), true);
+    PYSTRING_CHECK_EQUAL(islower("\xef\xac\x80"), true);
+    PYSTRING_CHECK_EQUAL(islower("\xef\xac\x93"), true);
+    PYSTRING_CHECK_EQUAL(islower("\xc7\x85"), false);
+    PYSTRING_CHECK_EQUAL(isupper("\xc7\x85"), false);
+    PYSTRING_CHECK_EQUAL(isupper("\xcf\x92"), true);
+}
+
+PYSTRING_ADD_TEST(pystring_utf8, width)
+{
+    using namespace pystring::utf8;
+
+    PYSTRING_CHECK_EQUAL(ljust("abc", 5), "abc  ");
+    PYSTRING_CHECK_EQUAL(ljust("Bj\xc3\xb6rk", 7), "Bj\xc3\xb6rk  ");
+    PYSTRING_CHECK_EQUAL(rjust("Bj\xc3\xb6rk", 7), "  Bj\xc3\xb6rk");
+    PYSTRING_CHECK_EQUAL(center("Bj\xc3\xb6rk", 7), " Bj\xc3\xb6rk ");
+    PYSTRING_CHECK_EQUAL(center("\xc3\xa9", 4), " \xc3\xa9  ");
+    PYSTRING_CHECK_EQUAL(center("\xc3\xa9", 4), pystring::center("e", 4).replace(1, 1, "\xc3\xa9"));
+    PYSTRING_CHECK_EQUAL(ljust("Bj\xc3\xb6rk", 3), "Bj\xc3\xb6rk");
 }
@@ -6,7 +6,15 @@
 #define INCLUDED_PYSTRING_UNITTEST_H
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
 #include <vector>
 
 extern int unit_test_failures;
@@ -100,6 +108,22 @@ struct AddTest { AddTest(PYSTRINGTest* test); };
         << "FAILED: exception thrown from " << #S <<"\n";               \
         ++unit_test_failures; }
 
+/// PYSTRING_CHECK_ALLOCS evaluates x once and checks that it made at most max
+/// heap allocations. Allocations made inside a shared library are only seen on
+/// platforms where the replaced operator new is global to the process, which is
+/// not the case for DLLs on Windows.
+#define PYSTRING_CHECK_ALLOCS(x, max)                                       \
+    do {                                                                    \
+        size_t _allocs = pystring_allocations.load(std::memory_order_relaxed); \
+        x;                                                                  \
+        _allocs = pystring_allocations.load(std::memory_order_relaxed) - _allocs; \
+        if (_allocs > (size_t)(max)) {                                      \
+            std::cout << __FILE__ << ":" << __LINE__ << ":\n"              \
+                      << "FAILED: " << #x << " allocates at most " << #max << "\n" \
+                      << "\tallocations were '" << _allocs << "'\n";     \
+            ++unit_test_failures; }                                         \
+    } while (0)
+
 #define PYSTRING_ADD_TEST(group, name)                                      \
     static void pystringtest_##group##_##name();                            \
     AddTest pystringaddtest_##group##_##name(new PYSTRINGTest(#group, #name, pystringtest_##group##_##name)); \
@@ -113,6 +137,7 @@ struct AddTest { AddTest(PYSTRINGTest* test); };
         static std::vector<PYSTRINGTest*> pystring_unit_tests;                  \
         return pystring_unit_tests; }                                       \
     AddTest::AddTest(PYSTRINGTest* test){GetUnitTests().push_back(test);};  \
+    PYSTRING_TRACK_ALLOCATIONS()                                            \
     PYSTRING_TEST_SETUP(); \
     int main(int, char **) { std::cerr << "\n" << #app <<"\n\n";        \
         for(size_t i = 0; i < GetUnitTests().size(); ++i) {             \
@@ -122,4 +147,442 @@ struct AddTest { AddTest(PYSTRINGTest* test); };
         std::cerr << "\n" << unit_test_failures << " tests failed\n\n";   \
         return unit_test_failures; }
 
+/// PYSTRING_TRACK_ALLOCATIONS replaces the global operator new and delete with
+/// versions that count every allocation in pystring_allocations. Expand it once,
+/// at file scope, in the application that wants the counts.
+
+/// The operators are kept out of line: once inlined, gcc pairs the malloc() of
+/// one with the free() of the other and warns about mismatched new and delete.
+
+extern std::atomic<size_t> pystring_allocations;
+
+#if defined(__GNUC__)
+#define PYSTRING_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define PYSTRING_NOINLINE __declspec(noinline)
+#else
+#define PYSTRING_NOINLINE
+#endif
+
+#if defined(__cpp_sized_deallocation)
+#define PYSTRING_SIZED_DELETE                                               \
+    PYSTRING_NOINLINE void operator delete(void * p, std::size_t) noexcept { std::free(p); } \
+    PYSTRING_NOINLINE void operator delete[](void * p, std::size_t) noexcept { std::free(p); }
+#else
+#define PYSTRING_SIZED_DELETE
+#endif
+
+#define PYSTRING_TRACK_ALLOCATIONS()                                        \
+    std::atomic<size_t> pystring_allocations(0);                            \
+    PYSTRING_NOINLINE void * operator new(std::size_t size) {               \
+        pystring_allocations.fetch_add(1, std::memory_order_relaxed);       \
+        if (void * p = std::malloc(size ? size : 1)) return p;              \
+        throw std::bad_alloc(); }                                           \
+    PYSTRING_NOINLINE void * operator new[](std::size_t size) { return operator new(size); } \
+    PYSTRING_NOINLINE void operator delete(void * p) noexcept { std::free(p); } \
+    PYSTRING_NOINLINE void operator delete[](void * p) noexcept { std::free(p); } \
+    PYSTRING_SIZED_DELETE
+
+/// PYSTRING_ADD_BENCH registers a micro benchmark, run by the app created with
+/// PYSTRING_BENCH_APP. The body is handed a PYSTRINGBench named bench, which
+/// holds the input for the current shape and size. Only the statements inside
+/// PYSTRING_BENCH_LOOP are timed, so any setup can go before it. Results that
+/// would otherwise be optimized away should be passed to PYSTRING_BENCH_KEEP.
+///
+///   PYSTRING_ADD_BENCH(pystring, find)
+///   {
+///       PYSTRING_BENCH_LOOP { PYSTRING_BENCH_KEEP(pystring::find(bench.input, bench.needle)); }
+///   }
+
+struct PYSTRINGBench
+{
+    PYSTRINGBench(const std::string & benchshape, const std::string & benchinput) :
+        shape(benchshape), input(benchinput), needle("/"), iterations(1), elapsed(0.0), allocations(0), skipped(false) { };
+    const std::string & shape;
+    const std::string & input;
+    const std::string needle;   // separator / substring used by every input shape
+    size_t iterations;          // number of times PYSTRING_BENCH_LOOP runs its body
+    double elapsed;             // nanoseconds spent inside PYSTRING_BENCH_LOOP
+    size_t allocations;         // heap allocations made inside PYSTRING_BENCH_LOOP
+    bool skipped;
+
+    /// Call instead of running the loop when an input is not meaningful for the function
+    void skip() { skipped = true; }
+};
+
+typedef void (*PYSTRINGBenchFunc)(PYSTRINGBench &);
+
+struct PYSTRINGBenchmark
+{
+    PYSTRINGBenchmark(std::string benchgroup, std::string benchname, PYSTRINGBenchFunc bench) :
+        group(benchgroup), name(benchname), function(bench) { };
+    std::string group, name;
+    PYSTRINGBenchFunc function;
+};
+
+typedef std::vector<PYSTRINGBenchmark*> Benchmarks;
+
+Benchmarks& GetBenchmarks();
+
+struct AddBench { AddBench(PYSTRINGBenchmark* bench); };
+
+struct PYSTRINGBenchTimer
+{
+    typedef std::chrono::steady_clock clock;
+    PYSTRINGBenchTimer(PYSTRINGBench & benchstate) : bench(benchstate), i(0),
+        allocations(pystring_allocations.load(std::memory_order_relaxed)), start(clock::now()) { };
+    bool running()
+    {
+        if (i < bench.iterations) return true;
+        bench.elapsed = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        bench.allocations = pystring_allocations.load(std::memory_order_relaxed) - allocations;
+        return false;
+    }
+    PYSTRINGBench & bench;
+    size_t i, allocations;
+    clock::time_point start;
+};
+
+template <class T>
+inline void PYSTRINGBenchKeep(const T & value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void * volatile sink;
+    sink = &value;
+#endif
+}
+
+#define PYSTRING_BENCH_KEEP(x) PYSTRINGBenchKeep(x)
+
+#define PYSTRING_BENCH_LOOP                                                 \
+    for (PYSTRINGBenchTimer pystring_bench_timer(bench); pystring_bench_timer.running(); ++pystring_bench_timer.i)
+
+#define PYSTRING_ADD_BENCH(group, name)                                     \
+    static void pystringbench_##group##_##name(PYSTRINGBench & bench);      \
+    AddBench pystringaddbench_##group##_##name(new PYSTRINGBenchmark(#group, #name, pystringbench_##group##_##name)); \
+    static void pystringbench_##group##_##name(PYSTRINGBench & bench)
+
+/// Build a benchmark input of the given shape and size:
+///   ascii   - words of lowercase text with a rare '/' and '.'
+///   matches - the needle every other character
+///   nomatch - lowercase text without the needle or any whitespace
+///   path    - a long posix path with '.', '..' and '//' components
+inline std::string PYSTRINGBenchInput(const std::string & shape, size_t size)
+{
+    std::string s;
+    s.reserve(size);
+    unsigned int seed = 12345;
+    while (s.size() < size)
+    {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = (seed >> 16) & 0x7fff;
+        if (shape == "ascii")
+        {
+            s += (r % 7 == 0) ? ' ' : (r % 61 == 0) ? '/' : (r % 67 == 0) ? '.' : (char)('a' + r % 26);
+        }
+        else if (shape == "matches")
+        {
+            s += (s.size() % 2) ? '/' : (char)('a' + r % 26);
+        }
+        else if (shape == "nomatch")
+        {
+            s += (char)('a' + r % 26);
+        }
+        else
+        {
+            static const char * comps[] = { "/show", "/seq010", "/sh0100", "/.", "/..", "/", "/publish", "/v001", "/a.b.exr" };
+            s += comps[r % 9];
+        }
+    }
+    s.resize(size);
+    return s;
+}
+
+/// One measurement, as printed and as stored in the JSON result files
+struct PYSTRINGBenchResult
+{
+    std::string name, shape;
+    size_t size;
+    double median, p99, fastest, allocs;
+};
+
+/// Best effort description of the processor the results were measured on
+inline std::string PYSTRINGBenchCPU()
+{
+    std::FILE * f = std::fopen("/proc/cpuinfo", "r");
+    if (f)
+    {
+        char line[512];
+        while (std::fgets(line, sizeof(line), f))
+        {
+            std::string s(line);
+            if (s.compare(0, 10, "model name") == 0 && s.find(':') != std::string::npos)
+            {
+                std::fclose(f);
+                s = s.substr(s.find(':') + 1);
+                s.erase(0, s.find_first_not_of(" \t"));
+                s.erase(s.find_last_not_of(" \t\r\n") + 1);
+                return s;
+            }
+        }
+        std::fclose(f);
+    }
+    return "unknown";
+}
+
+inline std::string PYSTRINGBenchEscape(const std::string & s)
+{
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        if (s[i] == '"' || s[i] == '\\') out += '\\';
+        if ((unsigned char) s[i] >= 0x20) out += s[i];
+    }
+    return out;
+}
+
+/// Results are written one per line, which is all PYSTRINGBenchRead relies on.
+/// Reading fails on a file without any result, so that a baseline that is not
+/// one is not taken for an empty one.
+inline bool PYSTRINGBenchWrite(const std::string & filename, const char * app, const std::vector<PYSTRINGBenchResult> & results)
+{
+    std::FILE * f = std::fopen(filename.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\n  \"app\": \"%s\",\n  \"cpu\": \"%s\",\n  \"results\": [\n",
+                 PYSTRINGBenchEscape(app).c_str(), PYSTRINGBenchEscape(PYSTRINGBenchCPU()).c_str());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const PYSTRINGBenchResult & r = results[i];
+        std::fprintf(f, "    {\"function\": \"%s\", \"shape\": \"%s\", \"size\": %lu, \"ns_per_op\": %.3f, "
+                        "\"p99_ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"allocs_per_op\": %.3f}%s\n",
+                     PYSTRINGBenchEscape(r.name).c_str(), PYSTRINGBenchEscape(r.shape).c_str(), (unsigned long) r.size,
+                     r.median, r.p99, r.fastest, r.allocs, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    return std::fclose(f) == 0;
+}
+
+inline std::string PYSTRINGBenchField(const std::string & line, const std::string & key)
+{
+    std::string::size_type pos = line.find("\"" + key + "\":");
+    if (pos == std::string::npos) return "";
+    pos = line.find_first_not_of(" ", pos + key.size() + 3);
+    if (pos == std::string::npos) return "";
+    if (line[pos] == '"') return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+    return line.substr(pos, line.find_first_of(",}", pos) - pos);
+}
+
+inline bool PYSTRINGBenchRead(const std::string & filename, std::vector<PYSTRINGBenchResult> & results)
+{
+    std::FILE * f = std::fopen(filename.c_str(), "r");
+    if (!f) return false;
+    char buffer[1024];
+    size_t records = 0;
+    while (std::fgets(buffer, sizeof(buffer), f))
+    {
+        std::string line(buffer);
+        if (line.find("\"function\":") == std::string::npos) continue;
+        PYSTRINGBenchResult r;
+        r.name = PYSTRINGBenchField(line, "function");
+        r.shape = PYSTRINGBenchField(line, "shape");
+        r.size = (size_t) std::strtoull(PYSTRINGBenchField(line, "size").c_str(), 0, 10);
+        r.median = std::atof(PYSTRINGBenchField(line, "ns_per_op").c_str());
+        r.p99 = std::atof(PYSTRINGBenchField(line, "p99_ns_per_op").c_str());
+        r.fastest = std::atof(PYSTRINGBenchField(line, "min_ns_per_op").c_str());
+        r.allocs = std::atof(PYSTRINGBenchField(line, "allocs_per_op").c_str());
+        results.push_back(r);
+        ++records;
+    }
+    std::fclose(f);
+    return records > 0;
+}
+
+/// Compare current against baseline and print every significant change. A
+/// measurement regresses when its median is more than threshold percent slower
+/// and its fastest repetition is still slower than the slowest (p99) baseline
+/// repetition, so that overlapping, noisy timings are not reported. Any
+/// increase in allocations per op is a regression too. Returns the number of
+/// regressions.
+inline int PYSTRINGBenchCompare(const std::vector<PYSTRINGBenchResult> & baseline,
+                                const std::vector<PYSTRINGBenchResult> & current, double threshold)
+{
+    int regressions = 0, compared = 0;
+    for (size_t i = 0; i < current.size(); ++i)
+    {
+        const PYSTRINGBenchResult & cur = current[i];
+        for (size_t j = 0; j < baseline.size(); ++j)
+        {
+            const PYSTRINGBenchResult & base = baseline[j];
+            if (base.name != cur.name || base.shape != cur.shape || base.size != cur.size) continue;
+            ++compared;
+
+            double change = base.median > 0.0 ? 100.0 * (cur.median - base.median) / base.median : 0.0;
+            bool slower = change > threshold && cur.fastest > base.p99;
+            bool faster = change < -threshold && cur.p99 < base.fastest;
+            bool allocs = cur.allocs > base.allocs + 0.5;
+
+            if (slower || allocs) ++regressions;
+            if (slower || faster || allocs)
+            {
+                std::printf("%-10s %-36s %-8s %10lu %12.1f -> %12.1f ns/op (%+.1f%%) %8.1f -> %8.1f allocs/op\n",
+                            (slower || allocs) ? "REGRESSED" : "improved", cur.name.c_str(), cur.shape.c_str(),
+                            (unsigned long) cur.size, base.median, cur.median, change, base.allocs, cur.allocs);
+            }
+            break;
+        }
+    }
+    std::printf("\n%d measurements compared, %d regressions beyond %.1f%%\n", compared, regressions, threshold);
+    return regressions;
+}
+
+/// Runs every registered benchmark over each input shape and size, printing
+/// the median and 99th percentile ns/op, the throughput and the heap
+/// allocations per op. Options:
+///   --filter=text      only run benchmarks whose group/name contains text
+///   --shape=name       only use one input shape
+///   --min-size=n       smallest input in bytes (default 16)
+///   --max-size=n       largest input in bytes (default 64MB)
+///   --reps=n           timed repetitions per measurement (default 10)
+///   --quick            shorthand for --max-size=65536 --reps=3 with shorter runs
+///   --json=file        also write the results to file
+///   --baseline=file    compare the results with a previous --json file, and
+///                      exit with 1 if anything regressed
+///   --diff=old,new     only compare two existing --json files
+///   --threshold=pct    slowdown tolerated by --baseline and --diff (default 10)
+inline int PYSTRINGBenchMain(int argc, char ** argv, const char * app)
+{
+    std::string filter, onlyshape, jsonfile, baselinefile, difffiles;
+    size_t minsize = 16, maxsize = 64u << 20, reps = 10;
+    double target = 5e6; // ns per repetition
+    double threshold = 10.0;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        std::string arg(argv[a]);
+        std::string value = arg.find('=') == std::string::npos ? "" : arg.substr(arg.find('=') + 1);
+        if (arg.compare(0, 9, "--filter=") == 0) filter = value;
+        else if (arg.compare(0, 8, "--shape=") == 0) onlyshape = value;
+        else if (arg.compare(0, 11, "--min-size=") == 0) minsize = (size_t) std::strtoull(value.c_str(), 0, 10);
+        else if (arg.compare(0, 11, "--max-size=") == 0) maxsize = (size_t) std::strtoull(value.c_str(), 0, 10);
+        else if (arg.compare(0, 7, "--reps=") == 0) reps = std::max((size_t) 1, (size_t) std::strtoull(value.c_str(), 0, 10));
+        else if (arg == "--quick") { maxsize = 1 << 16; reps = 3; target = 5e5; }
+        else if (arg.compare(0, 7, "--json=") == 0) jsonfile = value;
+        else if (arg.compare(0, 11, "--baseline=") == 0) baselinefile = value;
+        else if (arg.compare(0, 7, "--diff=") == 0) difffiles = value;
+        else if (arg.compare(0, 12, "--threshold=") == 0) threshold = std::atof(value.c_str());
+        else { std::cerr << "unknown option " << arg << "\n"; return 2; }
+    }
+
+    std::cout << "\n" << app << "\n\n";
+
+    if (!difffiles.empty())
+    {
+        std::vector<PYSTRINGBenchResult> baseline, current;
+        std::string::size_type comma = difffiles.find(',');
+        if (comma == std::string::npos ||
+            !PYSTRINGBenchRead(difffiles.substr(0, comma), baseline) ||
+            !PYSTRINGBenchRead(difffiles.substr(comma + 1), current))
+        {
+            std::cerr << "could not read --diff=" << difffiles << "\n";
+            return 2;
+        }
+        return PYSTRINGBenchCompare(baseline, current, threshold) ? 1 : 0;
+    }
+
+    std::vector<PYSTRINGBenchResult> baseline;
+    if (!baselinefile.empty() && !PYSTRINGBenchRead(baselinefile, baseline))
+    {
+        std::cerr << "could not read --baseline=" << baselinefile << "\n";
+        return 2;
+    }
+
+    static const char * shapes[] = { "ascii", "matches", "nomatch", "path" };
+    std::vector<PYSTRINGBenchResult> results;
+
+    std::printf("%-36s %-8s %10s %14s %14s %12s %10s\n", "benchmark", "shape", "size", "median ns/op", "p99 ns/op", "MB/s", "allocs/op");
+
+    for (size_t size = minsize; size <= maxsize; size *= 4)
+    {
+        for (size_t sh = 0; sh < sizeof(shapes) / sizeof(shapes[0]); ++sh)
+        {
+            if (!onlyshape.empty() && onlyshape != shapes[sh]) continue;
+            const std::string shape(shapes[sh]);
+            const std::string input = PYSTRINGBenchInput(shape, size);
+
+            for (size_t b = 0; b < GetBenchmarks().size(); ++b)
+            {
+                const PYSTRINGBenchmark & benchmark = *GetBenchmarks()[b];
+                const std::string fullname = benchmark.group + "/" + benchmark.name;
+                if (!filter.empty() && fullname.find(filter) == std::string::npos) continue;
+
+                // Calibrate, so that a repetition lasts roughly the target time
+                PYSTRINGBench bench(shape, input);
+                benchmark.function(bench);
+                if (bench.skipped) continue;
+                double once = std::max(bench.elapsed, 1.0);
+                bench.iterations = std::max((size_t) 1, (size_t) (target / once));
+
+                // Warm up, then time the repetitions
+                benchmark.function(bench);
+                std::vector<double> nsperop;
+                for (size_t r = 0; r < reps; ++r)
+                {
+                    benchmark.function(bench);
+                    nsperop.push_back(bench.elapsed / (double) bench.iterations);
+                }
+
+                // Count the allocations of one extra iteration, which leaves out the one off
+                // growth of any containers the benchmark reuses between iterations
+                bench.iterations = 1;
+                benchmark.function(bench);
+                size_t first = bench.allocations;
+                bench.iterations = 2;
+                benchmark.function(bench);
+                size_t allocations = bench.allocations > first ? bench.allocations - first : 0;
+
+                std::sort(nsperop.begin(), nsperop.end());
+                size_t n = nsperop.size();
+                PYSTRINGBenchResult result;
+                result.name = fullname;
+                result.shape = shape;
+                result.size = size;
+                result.median = (n % 2) ? nsperop[n / 2] : 0.5 * (nsperop[n / 2 - 1] + nsperop[n / 2]);
+                result.p99 = nsperop[(size_t) std::ceil(0.99 * (double) n) - 1];
+                result.fastest = nsperop[0];
+                result.allocs = (double) allocations;
+                results.push_back(result);
+
+                double mbps = result.median > 0.0 ? (double) size * 1e3 / result.median : 0.0;
+                std::printf("%-36s %-8s %10lu %14.1f %14.1f %12.1f %10.1f\n", fullname.c_str(), shape.c_str(),
+                            (unsigned long) size, result.median, result.p99, mbps, result.allocs);
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    if (!jsonfile.empty() && !PYSTRINGBenchWrite(jsonfile, app, results))
+    {
+        std::cerr << "could not write --json=" << jsonfile << "\n";
+        return 2;
+    }
+
+    if (!baselinefile.empty())
+    {
+        std::printf("\n");
+        return PYSTRINGBenchCompare(baseline, results, threshold) ? 1 : 0;
+    }
+
+    return 0;
+}
+
+#define PYSTRING_BENCH_APP(app)                                             \
+    PYSTRING_TRACK_ALLOCATIONS()                                            \
+    std::vector<PYSTRINGBenchmark*>& GetBenchmarks() {                      \
+        static std::vector<PYSTRINGBenchmark*> pystring_benchmarks;         \
+        return pystring_benchmarks; }                                       \
+    AddBench::AddBench(PYSTRINGBenchmark* bench){GetBenchmarks().push_back(bench);}; \
+    int main(int argc, char ** argv) { return PYSTRINGBenchMain(argc, argv, #app); }
+
 #endif